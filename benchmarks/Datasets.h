@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <QByteArray>
+#include <QGeoCoordinate>
+#include <QGeoPolygon>
+#include <QGeoRectangle>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "App/Models/BaseModel.h"
+
+// Synthetic, seeded city-scale datasets shaped like PastVu responses
+namespace Datasets {
+
+enum class Shape
+{
+	// Evenly spread over a 20 km box in Moscow
+	Uniform,
+	// Dense blobs around landmarks, the worst case for clustering
+	Clustered,
+	// Fiji, half of the items on each side of the antimeridian
+	Antimeridian,
+};
+
+// What BaseModel holds at most, so model benchmarks run at full capacity
+constexpr auto CITY_ITEMS = MAX_ITEMS;
+
+constexpr auto HALF_SPAN_DEGREES = 0.1;
+
+inline QGeoCoordinate Center(Shape shape)
+{
+	return shape == Shape::Antimeridian ? QGeoCoordinate(-16.5, 180.0) : QGeoCoordinate(55.75, 37.62);
+}
+
+inline double WrapLongitude(double lon)
+{
+	return lon >= 180.0 ? lon - 360.0 : lon < -180.0 ? lon + 360.0 : lon;
+}
+
+inline std::vector<Item> Generate(Shape shape, int count, unsigned seed = 42)
+{
+	static constexpr std::array directions { "n", "ne", "e", "se", "s", "sw", "w", "nw" };
+	static constexpr auto BLOBS = 20;
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> offset(-HALF_SPAN_DEGREES, HALF_SPAN_DEGREES);
+	std::normal_distribution<double> blobOffset(0.0, 0.005);
+	std::uniform_int_distribution<int> year(1840, 2020);
+	std::uniform_int_distribution<int> blob(0, BLOBS - 1);
+
+	std::vector<QGeoCoordinate> blobCenters;
+	for (int i = 0; i < BLOBS; ++i)
+		blobCenters.emplace_back(Center(shape).latitude() + offset(rng), Center(shape).longitude() + offset(rng));
+
+	std::vector<Item> items;
+	items.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		const auto center = shape == Shape::Clustered ? blobCenters[blob(rng)] : Center(shape);
+		const auto lat = center.latitude() + (shape == Shape::Clustered ? blobOffset(rng) : offset(rng));
+		const auto lon = WrapLongitude(center.longitude() + (shape == Shape::Clustered ? blobOffset(rng) : offset(rng)));
+
+		Item item;
+		item.cid = i + 1;
+		item.coord = { lat, lon };
+		item.file = QString("a/b/c/%1.jpg").arg(item.cid);
+		item.title = QString("Photo %1").arg(item.cid);
+		item.bearing = (i % directions.size()) * 45;
+		item.year = year(rng);
+		items.push_back(item);
+	}
+	return items;
+}
+
+// The box the items are spread over, as the map would report it
+inline QGeoRectangle Viewport(Shape shape)
+{
+	const auto center = Center(shape);
+	return {
+		QGeoCoordinate(center.latitude() + HALF_SPAN_DEGREES, WrapLongitude(center.longitude() - HALF_SPAN_DEGREES)),
+		QGeoCoordinate(center.latitude() - HALF_SPAN_DEGREES, WrapLongitude(center.longitude() + HALF_SPAN_DEGREES)),
+	};
+}
+
+inline QGeoPolygon Area(Shape shape)
+{
+	const auto viewport = Viewport(shape);
+	return QGeoPolygon({ viewport.topLeft(), viewport.bottomLeft(), viewport.bottomRight(), viewport.topRight() });
+}
+
+// Body of a photo.getByBounds reply holding the items
+inline QByteArray ToJson(const std::vector<Item> & items)
+{
+	static constexpr std::array directions { "n", "ne", "e", "se", "s", "sw", "w", "nw" };
+
+	QJsonArray photos;
+	for (const auto & item : items)
+	{
+		photos.append(QJsonObject {
+			{ "cid", item.cid },
+			{ "geo", QJsonArray { item.coord.latitude(), item.coord.longitude() } },
+			{ "file", item.file },
+			{ "title", item.title },
+			{ "dir", directions[(item.bearing / 45) % directions.size()] },
+			{ "year", item.year },
+		});
+	}
+	return QJsonDocument(QJsonObject { { "result", QJsonObject { { "photos", photos } } } }).toJson(QJsonDocument::Compact);
+}
+
+} // namespace Datasets
@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+
+#include <QDate>
+#include <QJsonDocument>
+
+#include "App/Models/BaseModel.h"
+#include "App/Models/ClusterModel.h"
+#include "App/Models/Clustering.h"
+#include "App/Models/FusedClusterModel.h"
+#include "App/Models/NearestObjectsModel.h"
+#include "App/Models/ScreenObjectsModel.h"
+
+#include "Datasets.h"
+#include "ModelFixtures.h"
+
+using Datasets::Shape;
+
+namespace {
+
+const Range FULL_TIMELINE { 1800, QDate::currentDate().year() };
+const Range NARROW_TIMELINE { 1900, 1950 };
+
+// Zoom the datasets' viewport is shown at on a phone
+constexpr auto ZOOM_LEVEL = 13;
+
+void BM_UniqueCircularBufferPush(benchmark::State & state)
+{
+	const auto items = Datasets::Generate(Shape::Uniform, static_cast<int>(state.range(0)));
+	for (auto _ : state)
+	{
+		Items buffer { &Item::cid };
+		for (const auto & item : items)
+			buffer.Push(item);
+		benchmark::DoNotOptimize(buffer.Size());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_BuildClusters(benchmark::State & state, Shape shape)
+{
+	const auto items = Datasets::Generate(shape, static_cast<int>(state.range(0)));
+	const auto viewport = Datasets::Viewport(shape);
+
+	std::vector<Clustering::Item> clusterItems;
+	for (int i = 0; i < static_cast<int>(items.size()); ++i)
+		clusterItems.push_back(Clustering::MakeItem(i, items[i].coord, viewport, ZOOM_LEVEL));
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(Clustering::BuildClusters(clusterItems));
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ClusterModelOnViewportChanged(benchmark::State & state, Shape shape)
+{
+	const auto baseModel = LoadBaseModel(shape, Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS)));
+	ScreenObjectsModel screenObjectsModel(baseModel.get());
+	screenObjectsModel.OnUserSelectedTimelineRangeChanged(FULL_TIMELINE);
+	ClusterModel clusterModel(&screenObjectsModel);
+
+	const auto viewport = Datasets::Viewport(shape);
+	for (auto _ : state)
+		clusterModel.OnViewportChanged(viewport);
+	state.counters["nodes"] = clusterModel.rowCount();
+}
+
+void BM_FusedClusterModelOnViewportChanged(benchmark::State & state, Shape shape)
+{
+	const auto baseModel = LoadBaseModel(shape, Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS)));
+	FakePositionSource positionSource;
+	FusedClusterModel fusedClusterModel(baseModel.get(), &positionSource);
+	fusedClusterModel.OnUserSelectedTimelineRangeChanged(FULL_TIMELINE);
+
+	const auto viewport = Datasets::Viewport(shape);
+	for (auto _ : state)
+		fusedClusterModel.OnViewportChanged(viewport);
+	state.counters["nodes"] = fusedClusterModel.rowCount();
+}
+
+void BM_ScreenObjectsModelTimelineFilter(benchmark::State & state, Shape shape)
+{
+	const auto baseModel = LoadBaseModel(shape, Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS)));
+	ScreenObjectsModel screenObjectsModel(baseModel.get());
+
+	auto narrow = false;
+	for (auto _ : state)
+	{
+		screenObjectsModel.OnUserSelectedTimelineRangeChanged((narrow = !narrow) ? NARROW_TIMELINE : FULL_TIMELINE);
+		benchmark::DoNotOptimize(screenObjectsModel.rowCount());
+	}
+}
+
+void BM_NearestObjectsModelWalk(benchmark::State & state, Shape shape)
+{
+	FakePositionSource positionSource;
+	const auto baseModel = LoadBaseModel(shape, Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS)), &positionSource);
+	ScreenObjectsModel screenObjectsModel(baseModel.get());
+	screenObjectsModel.OnUserSelectedTimelineRangeChanged(FULL_TIMELINE);
+	NearestObjectsModel nearestObjectsModel(&screenObjectsModel, &positionSource);
+
+	// Every step is past the recompute distance, so each one moves the circle
+	const auto step = NearestObjectsModel::RECOMPUTE_DISTANCE_METERS * 1.5;
+	auto position = Datasets::Center(shape);
+	auto azimuth = 0.0;
+	for (auto _ : state)
+	{
+		position = position.atDistanceAndAzimuth(step, azimuth += 7.0);
+		positionSource.MoveTo(position);
+	}
+	state.counters["nearest"] = nearestObjectsModel.rowCount();
+}
+
+void BM_JsonParse(benchmark::State & state)
+{
+	const auto json = Datasets::ToJson(Datasets::Generate(Shape::Uniform, static_cast<int>(state.range(0))));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(QJsonDocument::fromJson(json));
+	state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+// Request to items in the model, through the fixture stand-in with no latency
+void BM_JsonIngestion(benchmark::State & state, Shape shape)
+{
+	const auto json = Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(LoadBaseModel(shape, json)->rowCount());
+	state.SetBytesProcessed(state.iterations() * json.size());
+}
+
+}
+
+BENCHMARK(BM_UniqueCircularBufferPush)->Arg(Datasets::CITY_ITEMS)->Arg(10 * Datasets::CITY_ITEMS);
+
+BENCHMARK_CAPTURE(BM_BuildClusters, uniform, Shape::Uniform)->Arg(Datasets::CITY_ITEMS)->Arg(10 * Datasets::CITY_ITEMS);
+BENCHMARK_CAPTURE(BM_BuildClusters, clustered, Shape::Clustered)->Arg(Datasets::CITY_ITEMS)->Arg(10 * Datasets::CITY_ITEMS);
+BENCHMARK_CAPTURE(BM_BuildClusters, antimeridian, Shape::Antimeridian)->Arg(Datasets::CITY_ITEMS)->Arg(10 * Datasets::CITY_ITEMS);
+
+BENCHMARK_CAPTURE(BM_ClusterModelOnViewportChanged, uniform, Shape::Uniform);
+BENCHMARK_CAPTURE(BM_ClusterModelOnViewportChanged, clustered, Shape::Clustered);
+BENCHMARK_CAPTURE(BM_ClusterModelOnViewportChanged, antimeridian, Shape::Antimeridian);
+
+BENCHMARK_CAPTURE(BM_FusedClusterModelOnViewportChanged, uniform, Shape::Uniform);
+BENCHMARK_CAPTURE(BM_FusedClusterModelOnViewportChanged, clustered, Shape::Clustered);
+BENCHMARK_CAPTURE(BM_FusedClusterModelOnViewportChanged, antimeridian, Shape::Antimeridian);
+
+BENCHMARK_CAPTURE(BM_ScreenObjectsModelTimelineFilter, uniform, Shape::Uniform);
+BENCHMARK_CAPTURE(BM_ScreenObjectsModelTimelineFilter, clustered, Shape::Clustered);
+
+BENCHMARK_CAPTURE(BM_NearestObjectsModelWalk, uniform, Shape::Uniform);
+BENCHMARK_CAPTURE(BM_NearestObjectsModelWalk, clustered, Shape::Clustered);
+BENCHMARK_CAPTURE(BM_NearestObjectsModelWalk, antimeridian, Shape::Antimeridian);
+
+BENCHMARK(BM_JsonParse)->Arg(Datasets::CITY_ITEMS);
+
+BENCHMARK_CAPTURE(BM_JsonIngestion, uniform, Shape::Uniform)->UseRealTime()->Unit(benchmark::kMillisecond);
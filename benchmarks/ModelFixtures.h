@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include <QEventLoop>
+#include <QGeoPositionInfoSource>
+#include <QTimer>
+#include <QUrl>
+
+#include "App/Models/BaseModel.h"
+#include "Support/FakePositionSource.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+#include "Datasets.h"
+
+// BaseModel answering every tile request with the whole dataset through the fixture
+// stand-in; returns once all tiles covering the dataset's area are loaded
+inline std::unique_ptr<BaseModel> LoadBaseModel(Datasets::Shape shape, const QByteArray & json, QGeoPositionInfoSource * positionSource = nullptr)
+{
+	auto model = std::make_unique<BaseModel>(positionSource, QUrl("http://fixture/api2"), std::make_unique<FixtureNetworkAccessManager>([json](const QUrl &) { return json; }));
+
+	const auto area = Datasets::Area(shape);
+	QEventLoop loop;
+	// A tile counts as loaded once its items are in, right after ItemsLoaded
+	QObject::connect(model.get(), &BaseModel::ItemsLoaded, &loop, [&] {
+		QTimer::singleShot(0, &loop, [&] {
+			if (model->IsAreaLoaded(area))
+				loop.quit();
+		});
+	});
+	QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+	emit model->UpdateCoords(area);
+	loop.exec();
+	return model;
+}
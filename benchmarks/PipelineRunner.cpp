@@ -0,0 +1,350 @@
+// Replays a scripted map session through PastVuModelController's models without the GUI,
+// so the model stack can be run under perf, heaptrack or valgrind directly
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <numbers>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QSettings>
+#include <QTimer>
+
+#include "App/Controllers/ModelController/PastViewModelController.h"
+#include "App/Models/BaseModel.h"
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/Trace.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+#include "Datasets.h"
+#include "ModelFixtures.h"
+
+using Datasets::Shape;
+
+namespace {
+
+// Zoom Datasets::Viewport is shown at
+constexpr auto BASE_ZOOM = 13;
+constexpr auto MIN_ZOOM = BASE_ZOOM - 2;
+constexpr auto MAX_ZOOM = BASE_ZOOM + 4;
+// The map redraws at 60 fps while panning, rotating or zooming
+constexpr auto FRAME_MS = 16;
+// Past the controller's fetch debounce, so requests of the last viewport go out
+constexpr auto SETTLE_MS = 300;
+constexpr auto LOAD_TIMEOUT_MS = 10000;
+
+constexpr auto PAN_FRAMES = 120;
+constexpr auto ROTATE_FRAMES = 36;
+constexpr auto WALK_STEPS = 60;
+constexpr auto TIMELINE_STEPS = 20;
+constexpr auto WALK_STEP_METERS = 25.0;
+
+struct PhaseResult
+{
+	QString name;
+	int steps;
+	double wallMs;
+	double cpuMs;
+	std::uint64_t allocations;
+	std::uint64_t allocatedBytes;
+	std::uint64_t peakBytes;
+};
+
+void RunFor(int ms)
+{
+	QEventLoop loop;
+	QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+	loop.exec();
+}
+
+// Viewport of the map centred on center at zoom, rotated clockwise by bearing
+QGeoPolygon ViewportArea(const QGeoCoordinate & center, int zoom, double bearing = 0.0)
+{
+	const auto halfSpan = Datasets::HALF_SPAN_DEGREES * std::pow(2.0, BASE_ZOOM - zoom);
+	const auto halfDiagonal = center.distanceTo(QGeoCoordinate(center.latitude() + halfSpan, center.longitude() + halfSpan));
+
+	// TL, BL, BR, TR as the map reports them
+	QGeoPolygon area;
+	for (const auto azimuth : { 315.0, 225.0, 135.0, 45.0 })
+		area.addCoordinate(center.atDistanceAndAzimuth(halfDiagonal, azimuth + bearing));
+	return area;
+}
+
+// What a MapItemView does with the clustered model: reads every role of the rows it is told about
+class ViewStandIn
+{
+public:
+	explicit ViewStandIn(QAbstractItemModel & model)
+		: m_model(model)
+		, m_roles(model.roleNames().keys())
+	{
+		QObject::connect(&model, &QAbstractItemModel::modelReset, [this] { ReadRows(0, m_model.rowCount() - 1); });
+		QObject::connect(&model, &QAbstractItemModel::rowsInserted, [this](const QModelIndex &, int first, int last) { ReadRows(first, last); });
+		QObject::connect(&model, &QAbstractItemModel::dataChanged, [this](const QModelIndex & topLeft, const QModelIndex & bottomRight) {
+			ReadRows(topLeft.row(), bottomRight.row());
+		});
+	}
+
+private:
+	void ReadRows(int first, int last)
+	{
+		for (int row = first; row <= last; ++row)
+			for (const auto role : m_roles)
+				m_model.data(m_model.index(row, 0), role);
+	}
+
+private:
+	QAbstractItemModel & m_model;
+	const QList<int> m_roles;
+};
+
+class Session
+{
+public:
+	Session(Shape shape, const QByteArray & json, int latencyMs, QSettings & settings)
+		: m_shape(shape)
+	{
+		auto source = std::make_unique<FakePositionSource>();
+		m_positionSource = source.get();
+
+		auto networkManager = std::make_unique<FixtureNetworkAccessManager>([json](const QUrl &) { return json; });
+		networkManager->SetLatency(std::chrono::milliseconds(latencyMs));
+		auto baseModel = std::make_unique<BaseModel>(m_positionSource, QUrl("http://fixture/api2"), std::move(networkManager));
+		m_baseModel = baseModel.get();
+
+		m_controller = std::make_unique<PastVuModelController>(std::move(source), std::move(baseModel), settings);
+	}
+
+	PastVuModelController & Controller()
+	{
+		return *m_controller;
+	}
+
+	std::vector<PhaseResult> Run(int repeat)
+	{
+		ViewStandIn view(*m_controller->GetModel(ModelType::Clustered));
+		const auto center = Datasets::Center(m_shape);
+		m_positionSource->MoveTo(center);
+
+		Phase("load", 1, [&](int) {
+			m_controller->setProperty("zoomLevel", BASE_ZOOM);
+			m_controller->SetViewportArea(ViewportArea(center, BASE_ZOOM));
+			WaitForLoad(Datasets::Area(m_shape));
+		});
+
+		for (int i = 0; i < repeat; ++i)
+		{
+			// A fling east over two viewports and back, pans past the loaded area fetch more
+			Phase("pan", PAN_FRAMES, [&](int frame) {
+				const auto shift = 4.0 * Datasets::HALF_SPAN_DEGREES * std::sin(std::numbers::pi * frame / PAN_FRAMES);
+				m_controller->SetViewportArea(ViewportArea({ center.latitude(), Datasets::WrapLongitude(center.longitude() + shift) }, BASE_ZOOM));
+				RunFor(FRAME_MS);
+			});
+			RunFor(SETTLE_MS);
+
+			// From the whole city into the street level and back
+			Phase("zoom", 2 * (MAX_ZOOM - MIN_ZOOM), [&](int step) {
+				const auto zoom = step < MAX_ZOOM - MIN_ZOOM ? MIN_ZOOM + step : 2 * MAX_ZOOM - MIN_ZOOM - step;
+				m_controller->setProperty("zoomLevel", zoom);
+				m_controller->SetViewportArea(ViewportArea(center, zoom));
+				RunFor(FRAME_MS);
+			});
+			m_controller->setProperty("zoomLevel", BASE_ZOOM);
+			m_controller->SetViewportArea(ViewportArea(center, BASE_ZOOM));
+			RunFor(SETTLE_MS);
+
+			Phase("rotate", ROTATE_FRAMES, [&](int frame) {
+				m_controller->SetViewportArea(ViewportArea(center, BASE_ZOOM, 360.0 * (frame + 1) / ROTATE_FRAMES));
+				RunFor(FRAME_MS);
+			});
+			RunFor(SETTLE_MS);
+
+			// Walking in a circle, so the nearest objects keep changing
+			Phase("walk", WALK_STEPS, [&](int step) {
+				const auto position = m_positionSource->lastKnownPosition().coordinate();
+				m_positionSource->MoveTo(position.atDistanceAndAzimuth(WALK_STEP_METERS, 360.0 * step / WALK_STEPS));
+				RunFor(FRAME_MS);
+			});
+
+			Phase("timeline", TIMELINE_STEPS, [&](int step) {
+				const auto range = step % 2 ? Range { 1800, QDate::currentDate().year() } : Range { 1900 + step, 1950 + step };
+				m_controller->setProperty("userSelectedTimelineRange", QVariant::fromValue(range));
+				RunFor(FRAME_MS);
+			});
+		}
+		return m_results;
+	}
+
+private:
+	void Phase(const char * name, int steps, const std::function<void(int)> & step)
+	{
+		TRACE_SCOPE(name);
+		// The models run on this thread only, so its allocations are theirs and the runner's
+		const AllocationTracker::Stage stage(name);
+		QElapsedTimer wall;
+		wall.start();
+		const auto cpuStart = std::clock();
+
+		for (int i = 0; i < steps; ++i)
+			step(i);
+
+		const auto allocated = stage.Current();
+		m_results.push_back({
+			name,
+			steps,
+			static_cast<double>(wall.nsecsElapsed()) / 1e6,
+			1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC,
+			allocated.allocations,
+			allocated.bytes,
+			stage.PeakBytes(),
+		});
+	}
+
+	void WaitForLoad(const QGeoPolygon & area)
+	{
+		QEventLoop loop;
+		QObject::connect(m_controller.get(), &PastVuModelController::itemsLoaded, &loop, [&] {
+			QTimer::singleShot(0, &loop, [&] {
+				if (m_baseModel->IsAreaLoaded(area))
+					loop.quit();
+			});
+		});
+		QTimer::singleShot(LOAD_TIMEOUT_MS, &loop, &QEventLoop::quit);
+		loop.exec();
+		RunFor(SETTLE_MS);
+	}
+
+private:
+	const Shape m_shape;
+	FakePositionSource * m_positionSource { nullptr };
+	BaseModel * m_baseModel { nullptr };
+	std::unique_ptr<PastVuModelController> m_controller;
+	std::vector<PhaseResult> m_results;
+};
+
+void PrintResults(const std::vector<PhaseResult> & results)
+{
+	std::printf("%-10s %6s %10s %10s %12s %12s %12s %10s\n", "phase", "steps", "wall ms", "cpu ms", "cpu us/step", "allocs", "allocs/step", "peak KiB");
+	for (const auto & result : results)
+	{
+		std::printf("%-10s %6d %10.1f %10.1f %12.1f %12llu %12.1f %10.1f\n",
+			qPrintable(result.name),
+			result.steps,
+			result.wallMs,
+			result.cpuMs,
+			1000.0 * result.cpuMs / result.steps,
+			static_cast<unsigned long long>(result.allocations),
+			static_cast<double>(result.allocations) / result.steps,
+			result.peakBytes / 1024.0);
+	}
+}
+
+void PrintStages()
+{
+	std::printf("\n%-56s %8s %12s %12s %10s %10s\n", "stage", "calls", "allocs", "allocs/call", "KiB", "peak KiB");
+	for (const auto & stage : AllocationTracker::Stages())
+	{
+		std::printf("%-56s %8llu %12llu %12.1f %10.1f %10.1f\n",
+			stage.name,
+			static_cast<unsigned long long>(stage.calls),
+			static_cast<unsigned long long>(stage.allocations),
+			static_cast<double>(stage.allocations) / stage.calls,
+			stage.bytes / 1024.0,
+			stage.peakBytes / 1024.0);
+	}
+}
+
+// Phases of the last repetition allocating more per step than their budget, e.g. pan=0
+bool CheckBudgets(const QStringList & budgets, const std::vector<PhaseResult> & results)
+{
+	std::map<QString, PhaseResult> lastResults;
+	for (const auto & result : results)
+		lastResults.insert_or_assign(result.name, result);
+
+	auto withinBudgets = true;
+	for (const auto & budget : budgets)
+	{
+		const auto phase = budget.section('=', 0, 0);
+		const auto maxPerStep = budget.section('=', 1).toDouble();
+		const auto it = lastResults.find(phase);
+		if (it == lastResults.end())
+		{
+			std::fprintf(stderr, "Unknown phase in budget %s\n", qPrintable(budget));
+			withinBudgets = false;
+			continue;
+		}
+
+		const auto perStep = static_cast<double>(it->second.allocations) / it->second.steps;
+		if (perStep > maxPerStep)
+		{
+			std::fprintf(stderr, "Over budget: %s allocates %.1f per step, %.1f allowed\n", qPrintable(phase), perStep, maxPerStep);
+			withinBudgets = false;
+		}
+	}
+	return withinBudgets;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	// Models read the timeline from QSettings, keep them apart from the app's
+	QCoreApplication::setOrganizationName("PastViewerPipelineRunner");
+	QCoreApplication::setApplicationName("PastViewerPipelineRunner");
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replays a scripted map session through the models against a synthetic dataset.");
+	parser.addHelpOption();
+	const QCommandLineOption shapeOption("shape", "Dataset: uniform, clustered or antimeridian.", "shape", "uniform");
+	const QCommandLineOption pipelineOption("pipeline", "Clustered model: screen, nearest or fused.", "pipeline", "screen");
+	const QCommandLineOption repeatOption("repeat", "Times the script runs after the initial load.", "count", "1");
+	const QCommandLineOption latencyOption("latency", "Fixture response latency in ms.", "ms", "0");
+	const QCommandLineOption traceOption("trace", "Writes a Chrome trace of the run to the file.", "file");
+	const QCommandLineOption budgetOption("budget", "Fails when a phase of the last repetition allocates more per step, e.g. pan=0. Repeatable.", "phase=allocations");
+	parser.addOptions({ shapeOption, pipelineOption, repeatOption, latencyOption, traceOption, budgetOption });
+	parser.process(app);
+
+	const auto shapeName = parser.value(shapeOption);
+	const auto shape = shapeName == "clustered" ? Shape::Clustered : shapeName == "antimeridian" ? Shape::Antimeridian : Shape::Uniform;
+
+	if (parser.isSet(traceOption))
+		Trace::SetEnabled(true);
+
+	QSettings settings;
+	settings.clear();
+
+	Session session(shape, Datasets::ToJson(Datasets::Generate(shape, Datasets::CITY_ITEMS)), parser.value(latencyOption).toInt(), settings);
+	const auto pipeline = parser.value(pipelineOption);
+	if (pipeline == "fused")
+		session.Controller().ToggleFusedPipeline();
+	else if (pipeline == "nearest")
+		session.Controller().ToggleOnlyNearestObjects();
+
+	std::printf("dataset %s, pipeline %s\n", qPrintable(shapeName), qPrintable(pipeline));
+	const auto results = session.Run(std::max(1, parser.value(repeatOption).toInt()));
+	PrintResults(results);
+	PrintStages();
+
+	if (parser.isSet(traceOption))
+	{
+		QFile file(parser.value(traceOption));
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			std::fprintf(stderr, "Cannot write %s\n", qPrintable(file.fileName()));
+			return 1;
+		}
+		file.write(QByteArray::fromStdString(Trace::ExportChromeJson()));
+	}
+	return CheckBudgets(parser.values(budgetOption), results) ? 0 : 2;
+}
@@ -0,0 +1,18 @@
+#include <benchmark/benchmark.h>
+
+#include <QCoreApplication>
+
+int main(int argc, char ** argv)
+{
+	// Models read the timeline from QSettings, keep them apart from the app's
+	QCoreApplication::setOrganizationName("PastViewerBenchmarks");
+	QCoreApplication app(argc, argv);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -10,6 +10,7 @@ class PastViewerConan(ConanFile):
         self.requires("glog/0.7.1")
         self.requires("gflags/2.2.2")
         self.requires("gtest/1.14.0")
+        self.requires("benchmark/1.8.3")
 
         # sentry-native on Apple desktop and iOS. Android uses Sentry via Gradle.
         if self.settings.get_safe("os") in ("Macos", "iOS"):
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+import argparse
+import json
+import statistics
+import sys
+from pathlib import Path
+
+
+TIME_UNIT_TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def measured_time_ns(run):
+    # Benchmarks using real time are the ones driving the event loop, their CPU time means little
+    field = "real_time" if run["run_name"].endswith("/real_time") else "cpu_time"
+    return run[field] * TIME_UNIT_TO_NS[run.get("time_unit", "ns")]
+
+
+def load_results(path):
+    runs_by_name = {}
+    for run in json.loads(Path(path).read_text())["benchmarks"]:
+        run_name = run.get("run_name", run["name"])
+        if run.get("error_occurred"):
+            runs_by_name.setdefault(run_name, {"error": run.get("error_message", "error")})
+            continue
+
+        entry = runs_by_name.setdefault(run_name, {"iterations": [], "median": None})
+        if run.get("run_type") == "aggregate":
+            if run.get("aggregate_name") == "median":
+                entry["median"] = measured_time_ns(run)
+        else:
+            entry["iterations"].append(measured_time_ns(run))
+
+    results = {}
+    for name, entry in runs_by_name.items():
+        if "error" in entry:
+            results[name] = entry
+        elif entry["median"] is not None:
+            results[name] = {"time_ns": entry["median"]}
+        elif entry["iterations"]:
+            results[name] = {"time_ns": statistics.median(entry["iterations"])}
+    return results
+
+
+def format_ns(value):
+    if value is None:
+        return "-"
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if value >= scale:
+            return f"{value / scale:.2f} {unit}"
+    return f"{value:.0f} ns"
+
+
+def compare(baseline, results):
+    default_tolerance = baseline.get("default_tolerance", 0.15)
+    rows = []
+    failed = False
+    compared = 0
+
+    for name, expected in sorted(baseline["benchmarks"].items()):
+        tolerance = expected.get("tolerance", default_tolerance)
+        baseline_ns = expected.get("time_ns")
+        current = results.get(name)
+
+        if current is None:
+            rows.append((name, baseline_ns, None, None, tolerance, "MISSING"))
+            failed = True
+            continue
+        if "error" in current:
+            rows.append((name, baseline_ns, None, None, tolerance, "ERROR: " + current["error"]))
+            failed = True
+            continue
+
+        current_ns = current["time_ns"]
+        if baseline_ns is None:
+            # An unrecorded baseline would otherwise pass every run
+            rows.append((name, None, current_ns, None, tolerance, "NO BASELINE, run benchmark_baseline"))
+            failed = True
+            continue
+
+        compared += 1
+        delta = current_ns / baseline_ns - 1.0
+        if delta > tolerance:
+            status = "SLOWER"
+            failed = True
+        elif delta < -tolerance:
+            status = "faster, consider --update"
+        else:
+            status = "ok"
+        rows.append((name, baseline_ns, current_ns, delta, tolerance, status))
+
+    for name in sorted(set(results) - set(baseline["benchmarks"])):
+        rows.append((name, None, results[name].get("time_ns"), None, default_tolerance, "new, not in baseline"))
+
+    return rows, failed or compared == 0, compared
+
+
+def print_report(rows):
+    header = ("Benchmark", "Baseline", "Current", "Delta", "Tolerance", "Status")
+    table = [header] + [
+        (
+            name,
+            format_ns(baseline_ns),
+            format_ns(current_ns),
+            "-" if delta is None else f"{delta:+.1%}",
+            f"{tolerance:.0%}",
+            status,
+        )
+        for name, baseline_ns, current_ns, delta, tolerance, status in rows
+    ]
+    widths = [max(len(row[column]) for row in table) for column in range(len(header))]
+    for index, row in enumerate(table):
+        print("  ".join(cell.ljust(width) for cell, width in zip(row, widths)).rstrip())
+        if index == 0:
+            print("  ".join("-" * width for width in widths))
+
+
+def update_baseline(baseline_path, baseline, results):
+    recorded = 0
+    for name, current in results.items():
+        if "error" in current:
+            continue
+        baseline["benchmarks"].setdefault(name, {})["time_ns"] = round(current["time_ns"], 1)
+        recorded += 1
+    if recorded == 0:
+        print("No benchmark results to record, baseline left unchanged", file=sys.stderr)
+        return False
+    Path(baseline_path).write_text(json.dumps(baseline, indent=2, sort_keys=True) + "\n")
+    print(f"Baseline updated: {baseline_path}, {recorded} benchmarks recorded")
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare Google Benchmark JSON results against a checked-in baseline.")
+    parser.add_argument("--baseline", required=True, help="baseline JSON with per-benchmark times and tolerances")
+    parser.add_argument("--results", required=True, help="--benchmark_out JSON of the current run")
+    parser.add_argument("--update", action="store_true", help="record the current times as the new baseline")
+    args = parser.parse_args()
+
+    baseline = json.loads(Path(args.baseline).read_text())
+    results = load_results(args.results)
+
+    if args.update:
+        return 0 if update_baseline(args.baseline, baseline, results) else 1
+
+    rows, failed, compared = compare(baseline, results)
+    print_report(rows)
+    if compared == 0:
+        print("\nNo benchmark was compared against a baseline time", file=sys.stderr)
+    if failed:
+        print("\nBenchmark regression gate FAILED", file=sys.stderr)
+        return 1
+
+    print(f"\nBenchmark regression gate passed, {compared} benchmarks compared")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
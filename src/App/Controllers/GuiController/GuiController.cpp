@@ -3,12 +3,15 @@
 #include <QCameraDevice>
 #include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QGuiApplication>
 #include <QLocationPermission>
 #include <QMediaDevices>
+#include <QNetworkAccessManager>
 #include <QPermissions>
 #include <QQmlAbstractUrlInterceptor>
 #include <QQmlContext>
+#include <QQuickWindow>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QStringLiteral>
@@ -22,13 +25,20 @@
 #include "App/Controllers/I18nController/I18nController.h"
 #include "App/Controllers/ModelController/PastViewModelController.h"
 #include "App/Controllers/ModelController/PositionSourceAdapter.h"
+#include "App/Controllers/ModelController/RegionDownloader.h"
+#include "App/Models/ThumbnailCache.h"
+#include "App/Utils/AllocationTracker.h"
 #include "App/Utils/HoleItem.h"
 #include "App/Utils/PlatformUtils.h"
+#include "App/Utils/ThumbnailProvider.h"
+#include "App/Utils/Trace.h"
 
 using namespace PastViewer;
 
 namespace {
 
+constexpr auto TRACING = "Tracing";
+
 class HotReloadUrlInterceptor
 	: public QQmlAbstractUrlInterceptor
 {
@@ -74,6 +84,8 @@ private:
 
 struct GuiController::Impl
 {
+	// Outlives the engine and the image provider it owns
+	ThumbnailCache thumbnailCache { QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails", std::make_unique<QNetworkAccessManager>() };
 	QQmlApplicationEngine engine;
 	I18nController i18nController { engine };
 	QSettings settings;
@@ -117,6 +129,7 @@ GuiController::GuiController(QObject * parent)
 
 	qmlRegisterType<HoleItem>("PastViewer", 1, 0, "HoleItem");
 	qmlRegisterUncreatableType<PositionSourceAdapter>("PastViewer", 1, 0, "PositionSourceAdapter", "Cannot create PositionSourceAdapter from QML");
+	qmlRegisterUncreatableType<RegionDownloader>("PastViewer", 1, 0, "RegionDownloader", "Cannot create RegionDownloader from QML");
 	qmlRegisterUncreatableType<Range>("PastViewer", 1, 0, "range", "Range is a value type");
 	qmlRegisterUncreatableMetaObject(ModelType::staticMetaObject, "PastViewer", 1, 0, "ModelType", "ModelType is an enum namespace");
 	qRegisterMetaType<QGeoCoordinate>();
@@ -124,6 +137,8 @@ GuiController::GuiController(QObject * parent)
 	m_impl->engine.rootContext()->setContextProperty("guiController", this);
 	m_impl->engine.rootContext()->setContextProperty("pastVuModelController", m_impl->pastVuModelController.get());
 	m_impl->engine.rootContext()->setContextProperty("i18nController", &m_impl->i18nController);
+	m_impl->engine.rootContext()->setContextProperty("thumbnailCache", &m_impl->thumbnailCache);
+	m_impl->engine.addImageProvider(ThumbnailProvider::ID, new ThumbnailProvider(m_impl->thumbnailCache));
 	m_impl->engine.addImportPath("qrc:/qt/qml");
 	m_impl->engine.addUrlInterceptor(m_impl->interceptor.get());
 	m_impl->LoadQml();
@@ -139,6 +154,11 @@ GuiController::GuiController(QObject * parent)
 			m_impl->pastVuModelController->OnPositionPermissionGranted();
 	});
 
+	// Tracing is a debug build tool, release builds never record
+	Trace::SetEnabled(IsDebug() && IsTracing());
+	if (auto * window = qobject_cast<QQuickWindow *>(m_impl->engine.rootObjects().front()))
+		connect(window, &QQuickWindow::frameSwapped, this, [] { Trace::Instant("Frame swapped"); }, Qt::DirectConnection);
+
 	RequestPermission(m_impl->locationPermission);
 	RequestCameraPermission();
 }
@@ -188,6 +208,49 @@ void GuiController::ResetOnboarding()
 	emit onboardingReset();
 }
 
+QString GuiController::ExportTrace()
+{
+	const auto tracesPath = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("traces");
+	if (!QDir().mkpath(tracesPath))
+	{
+		LOG(WARNING) << "Failed to create traces directory: " << tracesPath.toStdString();
+		return {};
+	}
+
+	const auto filePath = QDir(tracesPath).absoluteFilePath(QString("trace_%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss")));
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly) || file.write(QByteArray::fromStdString(Trace::ExportChromeJson())) < 0)
+	{
+		LOG(WARNING) << "Failed to write trace to: " << filePath.toStdString();
+		return {};
+	}
+
+	LOG(INFO) << "Trace saved to: " << filePath.toStdString();
+
+	// Instrumented builds also log what the model stages allocated so far
+	for (const auto & stage : AllocationTracker::Stages())
+	{
+		LOG(INFO) << "Allocations in " << stage.name << ": " << stage.allocations << " in " << stage.calls << " calls, "
+				  << stage.bytes << " bytes, peak " << stage.peakBytes << " bytes";
+	}
+	return filePath;
+}
+
+bool GuiController::IsTracing() const
+{
+	return m_impl->settings.value(TRACING).toBool();
+}
+
+void GuiController::SetTracing(bool value)
+{
+	m_impl->settings.setValue(TRACING, value);
+	// A new recording starts from scratch, stopping keeps it for export
+	if (value)
+		Trace::Clear();
+	Trace::SetEnabled(IsDebug() && value);
+	emit TracingChanged();
+}
+
 void GuiController::RequestCameraPermission()
 {
 	QMediaDevices devices;
@@ -12,10 +12,13 @@ class GuiController
 	Q_OBJECT
 	Q_DISABLE_COPY(GuiController)
 
+	Q_PROPERTY(bool tracing READ IsTracing WRITE SetTracing NOTIFY TracingChanged)
+
 signals:
 	void PermissionGranted(const QPermission & permission);
 	void showErrorDialog(const QString & errorMessage);
 	void onboardingReset();
+	void TracingChanged();
 
 public:
 	GuiController(QObject * parent = nullptr);
@@ -33,9 +36,15 @@ public:
 	Q_INVOKABLE void SetOnboardingStepCompleted(const QString & key);
 	Q_INVOKABLE void ResetOnboarding();
 
+	// Writes the recorded trace as Chrome trace JSON, returns the file path or empty on failure
+	Q_INVOKABLE QString ExportTrace();
+
 private:
 	void RequestPermission(const QPermission & permission);
 
+	bool IsTracing() const;
+	void SetTracing(bool value);
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -0,0 +1,78 @@
+#include "ModelUpdateScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include <QTimer>
+
+#include "App/Utils/Trace.h"
+
+struct ModelUpdateScheduler::Impl
+{
+	struct Entry
+	{
+		const QObject * model;
+		Rebuild rebuild;
+		IsActive isActive;
+		bool dirty { false };
+	};
+
+	// Registration order is the rebuild order, so upstream models go first
+	std::vector<Entry> entries;
+	QTimer flushTimer;
+};
+
+ModelUpdateScheduler::ModelUpdateScheduler(QObject * parent)
+	: QObject(parent)
+	, m_impl(std::make_unique<Impl>())
+{
+	// Zero interval fires once the events queued in this turn have been processed
+	m_impl->flushTimer.setSingleShot(true);
+	m_impl->flushTimer.setInterval(0);
+	connect(&m_impl->flushTimer, &QTimer::timeout, this, &ModelUpdateScheduler::Flush);
+}
+
+ModelUpdateScheduler::~ModelUpdateScheduler() = default;
+
+void ModelUpdateScheduler::Register(const QObject * model, Rebuild rebuild, IsActive isActive)
+{
+	assert(std::ranges::none_of(m_impl->entries, [model](const auto & entry) { return entry.model == model; }));
+	m_impl->entries.push_back({ model, std::move(rebuild), std::move(isActive) });
+}
+
+void ModelUpdateScheduler::MarkDirty(const QObject * model)
+{
+	const auto it = std::ranges::find(m_impl->entries, model, &Impl::Entry::model);
+	if (assert(it != m_impl->entries.end()); it == m_impl->entries.end())
+		return;
+
+	it->dirty = true;
+	m_impl->flushTimer.start();
+}
+
+void ModelUpdateScheduler::MarkAllDirty()
+{
+	for (auto & entry : m_impl->entries)
+		entry.dirty = true;
+	m_impl->flushTimer.start();
+}
+
+void ModelUpdateScheduler::OnActiveModelsChanged()
+{
+	m_impl->flushTimer.start();
+}
+
+void ModelUpdateScheduler::Flush()
+{
+	TRACE_SCOPE("ModelUpdateScheduler::Flush");
+	for (auto & entry : m_impl->entries)
+	{
+		if (!entry.dirty || !entry.isActive())
+			continue;
+
+		// Cleared first: a rebuild may mark its own model dirty again, which schedules another turn
+		entry.dirty = false;
+		entry.rebuild();
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <QObject>
+
+#include "App/Utils/NonCopyMovable.h"
+
+// Coalesces rebuild requests. Models marked dirty any number of times during one
+// event loop turn are rebuilt once when control returns to the loop, and only
+// while they are active; inactive models keep their dirty flag until activated.
+class ModelUpdateScheduler
+	: public QObject
+{
+	Q_OBJECT
+
+public:
+	using Rebuild = std::function<void()>;
+	using IsActive = std::function<bool()>;
+
+	explicit ModelUpdateScheduler(QObject * parent = nullptr);
+	NON_COPY_MOVABLE(ModelUpdateScheduler);
+
+	~ModelUpdateScheduler();
+
+	void Register(const QObject * model, Rebuild rebuild, IsActive isActive);
+
+	void MarkDirty(const QObject * model);
+	void MarkAllDirty();
+
+	// Lets models that became active catch up on changes made while they were inactive
+	void OnActiveModelsChanged();
+
+private slots:
+	void Flush();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
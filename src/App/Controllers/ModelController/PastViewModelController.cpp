@@ -1,83 +1,194 @@
 #include "PastViewModelController.h"
 
+#include <cmath>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QLocationPermission>
+#include <QNetworkAccessManager>
+#include <QStandardPaths>
 #include <QString>
+#include <QTimer>
 
 #include "App/Models/ClusterModel.h"
 #include "glog/logging.h"
 
+#include "App/Controllers/ModelController/ModelUpdateScheduler.h"
 #include "App/Controllers/ModelController/PositionSourceAdapter.h"
+#include "App/Controllers/ModelController/RegionDownloader.h"
 #include "App/Models/BaseModel.h"
+#include "App/Models/FusedClusterModel.h"
 #include "App/Models/NearestObjectsModel.h"
+#include "App/Models/OfflineStore.h"
+#include "App/Models/PastVuApi.h"
 #include "App/Models/ScreenObjectsModel.h"
+#include "App/Models/YearHistogram.h"
+#include "App/Utils/SettingsKeys.h"
+#include "App/Utils/Trace.h"
+
+using namespace SettingsKeys;
 
 namespace {
-constexpr auto NEAREST_OBJECTS_ONLY = "NearestObjectsOnly";
-constexpr auto HISTORY_NEAR_MODEL_TYPE = "HistoryNearModelType";
-constexpr auto YEARS_FROM = "YEARS_FROM";
-constexpr auto YEARS_TO = "YEARS_TO";
-constexpr auto YEAR_FROM_VALUE = 1800;
+constexpr auto YEAR_HISTOGRAM_BUCKET_SIZE = 10;
+// Clusters follow the viewport at most once per frame
+constexpr auto FRAME_INTERVAL_MS = 16;
+// Requests wait for the viewport to settle
+constexpr auto FETCH_DEBOUNCE_MS = 250;
+// Prefetches compete with the visible area for bandwidth
+constexpr auto PREFETCH_INTERVAL_MS = 1000;
+// The area ahead overlaps the current one by a quarter of the diagonal
+constexpr auto PREFETCH_SHIFT_DIAGONALS = 0.75;
+// Slower pans are fine-tuning rather than heading somewhere
+constexpr auto MIN_PAN_SPEED_DIAGONALS_PER_SECOND = 0.5;
+// Viewport updates further apart belong to different gestures
+constexpr auto MAX_PAN_SAMPLE_INTERVAL_MS = 200;
+
+double DiagonalMeters(const QGeoRectangle & rectangle)
+{
+	return rectangle.isValid() ? rectangle.topLeft().distanceTo(rectangle.bottomRight()) : 0.0;
+}
+
+// Same area centred on `to` instead of `from`
+QGeoPolygon MoveArea(const QGeoPolygon & area, const QGeoCoordinate & from, const QGeoCoordinate & to)
+{
+	QGeoPolygon moved;
+	for (const auto & corner : area.perimeter())
+		moved.addCoordinate(to.atDistanceAndAzimuth(from.distanceTo(corner), from.azimuthTo(corner)));
+	return moved;
+}
+
+std::unique_ptr<BaseModel> MakePastVuBaseModel(QGeoPositionInfoSource * source, const OfflineStore & offlineStore)
+{
+	auto baseModel = std::make_unique<BaseModel>(source);
+	// Downloaded regions are served from the store
+	baseModel->SetOfflineStore(&offlineStore);
+	return baseModel;
+}
 }
 
 struct PastVuModelController::Impl
 {
-	Impl(const QLocationPermission & permission, QSettings & settings)
-		: source(QGeoPositionInfoSource::createDefaultSource(nullptr))
-		, baseModel(std::make_unique<BaseModel>(source.get()))
+	Impl(std::unique_ptr<QGeoPositionInfoSource> source_, std::unique_ptr<BaseModel> baseModel_, QSettings & settings)
+		: source(std::move(source_))
+		// Models fed by the caller stay off the user's data and the network
+		, offlineStore(baseModel_ ? nullptr : std::make_unique<OfflineStore>(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/offline"))
+		, baseModel(baseModel_ ? std::move(baseModel_) : MakePastVuBaseModel(source.get(), *offlineStore))
 		, screenObjectsModel(std::make_unique<ScreenObjectsModel>(baseModel.get()))
 		, nearestObjectsModel(std::make_unique<NearestObjectsModel>(screenObjectsModel.get(), source.get()))
+		, nearestStripModel(std::make_unique<NearestObjectsModel>(screenObjectsModel.get(), source.get(), NearestObjectsModel::MAX_NEAREST_OBJECTS))
 		, clusterModelScreen(std::make_unique<ClusterModel>(screenObjectsModel.get()))
 		, clusterModelNearest(std::make_unique<ClusterModel>(nearestObjectsModel.get()))
+		, fusedClusterModel(std::make_unique<FusedClusterModel>(baseModel.get(), source.get()))
 		, positionSourceAdapter([&] {
 			if (!source)
 				throw std::runtime_error("POSITION SOURCE EMPTY!");
 			return std::make_unique<PositionSourceAdapter>(*source);
 		}())
 		, settings(settings)
+		, regionDownloader(offlineStore ? std::make_unique<RegionDownloader>(*offlineStore, QUrl(PastVuApi::API_URL), std::make_unique<QNetworkAccessManager>(), settings) : nullptr)
 	{
-		if (qApp->checkPermission(permission) == Qt::PermissionStatus::Granted)
-			source->startUpdates();
 	}
 
 	std::unique_ptr<QGeoPositionInfoSource> source;
 	QGeoRectangle viewPort;
+	QGeoPolygon viewportArea;
+	// Both null for models fed by the caller
+	std::unique_ptr<OfflineStore> offlineStore;
 	std::unique_ptr<BaseModel> baseModel;
 	std::unique_ptr<ScreenObjectsModel> screenObjectsModel;
+	// Everything within the circle is clustered, the strip only lists the nearest
 	std::unique_ptr<NearestObjectsModel> nearestObjectsModel;
+	std::unique_ptr<NearestObjectsModel> nearestStripModel;
 	std::unique_ptr<ClusterModel> clusterModelScreen;
 	std::unique_ptr<ClusterModel> clusterModelNearest;
+	std::unique_ptr<FusedClusterModel> fusedClusterModel;
 	std::unique_ptr<PositionSourceAdapter> positionSourceAdapter;
+	// Chosen at the last UpdateModelActivity
+	QAbstractItemModel * clusteredModel { nullptr };
+	QAbstractItemModel * rawModel { nullptr };
+	ModelUpdateScheduler updateScheduler;
+	QTimer clusterThrottleTimer;
+	QTimer fetchDebounceTimer;
+	QElapsedTimer panClock;
+	QElapsedTimer prefetchClock;
 	QSettings & settings;
 	const Range defaultTimelineRange { YEAR_FROM_VALUE, QDate::currentDate().year() };
 	Range userSelectedTimelineRange {
 		settings.value(YEARS_FROM, defaultTimelineRange.min).toInt(),
 		settings.value(YEARS_TO, defaultTimelineRange.max).toInt()
 	};
+	std::unique_ptr<RegionDownloader> regionDownloader;
 };
 
 PastVuModelController::PastVuModelController(const QLocationPermission & permission, QSettings & settings, QObject * parent)
+	: PastVuModelController(std::unique_ptr<QGeoPositionInfoSource>(QGeoPositionInfoSource::createDefaultSource(nullptr)), nullptr, settings, parent)
+{
+	if (qApp->checkPermission(permission) == Qt::PermissionStatus::Granted)
+		m_impl->source->startUpdates();
+}
+
+PastVuModelController::PastVuModelController(std::unique_ptr<QGeoPositionInfoSource> source, std::unique_ptr<BaseModel> baseModel, QSettings & settings, QObject * parent)
 	: QObject(parent)
-	, m_impl(std::make_unique<Impl>(permission, settings))
+	, m_impl(std::make_unique<Impl>(std::move(source), std::move(baseModel), settings))
 {
 	connect(this, &PastVuModelController::PositionPermissionGranted, m_impl->baseModel.get(), &BaseModel::OnPositionPermissionGranted);
 	connect(this, &PastVuModelController::UserSelectedTimelineRangeChanged, m_impl->screenObjectsModel.get(), &ScreenObjectsModel::OnUserSelectedTimelineRangeChanged);
-	connect(m_impl->baseModel.get(), &BaseModel::LoadingItems, this, &PastVuModelController::loadingItems);
-	connect(m_impl->baseModel.get(), &BaseModel::ItemsLoaded, this, [&]() {
-		emit itemsLoaded();
-		m_impl->clusterModelScreen->OnViewportChanged(m_impl->viewPort);
-		m_impl->clusterModelNearest->OnViewportChanged(m_impl->viewPort);
-	});
-	connect(m_impl->baseModel.get(), &BaseModel::ItemsLoaded, m_impl->clusterModelScreen.get(), [&]() {
-		m_impl->clusterModelScreen->OnViewportChanged(m_impl->baseModel->GetLastKnownViewport());
+	connect(this, &PastVuModelController::UserSelectedTimelineRangeChanged, m_impl->fusedClusterModel.get(), &FusedClusterModel::OnUserSelectedTimelineRangeChanged);
+	connect(this, &PastVuModelController::NearestObjectsOnlyChanged, m_impl->fusedClusterModel.get(), [this] {
+		m_impl->fusedClusterModel->SetNearestObjectsOnly(GetNearestObjectsOnly());
 	});
-	connect(m_impl->baseModel.get(), &BaseModel::ItemsLoaded, m_impl->clusterModelNearest.get(), [&]() {
-		m_impl->clusterModelScreen->OnViewportChanged(m_impl->baseModel->GetLastKnownViewport());
+	connect(m_impl->baseModel.get(), &BaseModel::LoadingItems, this, &PastVuModelController::loadingItems);
+	connect(m_impl->baseModel.get(), &BaseModel::YearHistogramChanged, this, &PastVuModelController::YearHistogramChanged);
+	connect(m_impl->baseModel.get(), &BaseModel::LoadingFinished, this, &PastVuModelController::itemsLoaded);
+	connect(m_impl->baseModel.get(), &BaseModel::ItemsLoaded, this, [&]() { m_impl->updateScheduler.MarkAllDirty(); });
+
+	for (auto * clusterModel : { m_impl->clusterModelScreen.get(), m_impl->clusterModelNearest.get() })
+	{
+		m_impl->updateScheduler.Register(
+			clusterModel,
+			[this, clusterModel] {
+				clusterModel->SetVisibleArea(m_impl->viewportArea);
+				clusterModel->OnViewportChanged(m_impl->viewPort);
+			},
+			[this, clusterModel] { return GetModel(ModelType::Clustered) == clusterModel; });
+		connect(clusterModel, &ClusterModel::SourceChanged, this, [this, clusterModel] { m_impl->updateScheduler.MarkDirty(clusterModel); });
+	}
+	m_impl->updateScheduler.Register(
+		m_impl->fusedClusterModel.get(),
+		[this] {
+			m_impl->fusedClusterModel->SetVisibleArea(m_impl->viewportArea);
+			m_impl->fusedClusterModel->OnViewportChanged(m_impl->viewPort);
+		},
+		[this] { return GetModel(ModelType::Clustered) == m_impl->fusedClusterModel.get(); });
+	connect(m_impl->fusedClusterModel.get(), &FusedClusterModel::SourceChanged, this, [this] { m_impl->updateScheduler.MarkDirty(m_impl->fusedClusterModel.get()); });
+	m_impl->clusterThrottleTimer.setSingleShot(true);
+	m_impl->clusterThrottleTimer.setInterval(FRAME_INTERVAL_MS);
+	connect(&m_impl->clusterThrottleTimer, &QTimer::timeout, this, [this] { m_impl->updateScheduler.MarkAllDirty(); });
+
+	m_impl->fetchDebounceTimer.setSingleShot(true);
+	m_impl->fetchDebounceTimer.setInterval(FETCH_DEBOUNCE_MS);
+	connect(&m_impl->fetchDebounceTimer, &QTimer::timeout, this, &PastVuModelController::FetchViewport);
+
+	// Walking towards somewhere, the area ahead is loaded before the user gets there
+	connect(m_impl->positionSourceAdapter.get(), &PositionSourceAdapter::PositionChanged, this, [this] {
+		if (const auto bearing = m_impl->positionSourceAdapter->Bearing(); !std::isnan(bearing))
+			PrefetchAhead(m_impl->positionSourceAdapter->Coordinate(), bearing);
 	});
+
+	connect(this, &PastVuModelController::ModelChanged, this, &PastVuModelController::UpdateModelActivity);
+	connect(this, &PastVuModelController::NearestObjectsOnlyChanged, this, &PastVuModelController::UpdateModelActivity);
+	connect(this, &PastVuModelController::FusedPipelineChanged, this, &PastVuModelController::UpdateModelActivity);
+	connect(this, &PastVuModelController::HistoryNearModelChanged, this, &PastVuModelController::UpdateModelActivity);
+
+	// Whichever cluster model is active feeds the zooms shown by the raw list
 	connect(m_impl->clusterModelScreen.get(), &ClusterModel::ZoomsToDecluster, m_impl->screenObjectsModel.get(), &ScreenObjectsModel::UpdateZoomsToDecluster);
+	connect(m_impl->clusterModelNearest.get(), &ClusterModel::ZoomsToDecluster, m_impl->screenObjectsModel.get(), &ScreenObjectsModel::UpdateZoomsToDecluster);
+	connect(m_impl->fusedClusterModel.get(), &FusedClusterModel::ZoomsToDecluster, m_impl->screenObjectsModel.get(), &ScreenObjectsModel::UpdateZoomsToDecluster);
+
+	UpdateModelActivity();
 }
 
 PastVuModelController::~PastVuModelController() = default;
@@ -89,8 +200,11 @@ QAbstractItemModel * PastVuModelController::GetModel(ModelType::Type modelType)
 		case ModelType::Raw:
 			return GetHistoryNearModelType() // @TODO think on the function name
 					 ? static_cast<QAbstractItemModel *>(m_impl->screenObjectsModel.get())
-					 : static_cast<QAbstractItemModel *>(m_impl->nearestObjectsModel.get());
+					 : static_cast<QAbstractItemModel *>(m_impl->nearestStripModel.get());
 		case ModelType::Clustered:
+			if (GetFusedPipeline())
+				return m_impl->fusedClusterModel.get();
+
 			return GetNearestObjectsOnly()
 					 ? static_cast<QAbstractItemModel *>(m_impl->clusterModelNearest.get())
 					 : static_cast<QAbstractItemModel *>(m_impl->clusterModelScreen.get());
@@ -108,6 +222,16 @@ PositionSourceAdapter * PastVuModelController::GetPositionSource()
 	return m_impl->positionSourceAdapter.get();
 }
 
+QGeoRectangle PastVuModelController::GetViewport() const
+{
+	return m_impl->viewPort;
+}
+
+RegionDownloader * PastVuModelController::GetOfflineRegions() const
+{
+	return m_impl->regionDownloader.get();
+}
+
 void PastVuModelController::OnPositionPermissionGranted()
 {
 	emit PositionPermissionGranted();
@@ -135,6 +259,27 @@ void PastVuModelController::SetHistoryNearModelType(bool value)
 	emit HistoryNearModelChanged();
 }
 
+bool PastVuModelController::GetFusedPipeline()
+{
+	return m_impl->settings.value(FUSED_PIPELINE).toBool();
+}
+
+void PastVuModelController::SetFusedPipeline(bool value)
+{
+	m_impl->settings.setValue(FUSED_PIPELINE, value);
+	emit FusedPipelineChanged();
+}
+
+QAbstractItemModel * PastVuModelController::GetClusteredModel() const
+{
+	return m_impl->clusteredModel;
+}
+
+QAbstractItemModel * PastVuModelController::GetRawModel() const
+{
+	return m_impl->rawModel;
+}
+
 int PastVuModelController::GetZoomLevel() const
 {
 	return m_impl->screenObjectsModel->data({}, BaseModel::Roles::ZoomLevel).toInt();
@@ -164,6 +309,17 @@ void PastVuModelController::SetUserSelectedTimelineRange(const Range & range)
 	emit UserSelectedTimelineRangeChanged(range);
 }
 
+QList<int> PastVuModelController::GetYearHistogram() const
+{
+	const auto buckets = m_impl->baseModel->GetYearHistogram().Buckets(m_impl->defaultTimelineRange.min, m_impl->defaultTimelineRange.max, YEAR_HISTOGRAM_BUCKET_SIZE);
+	return { buckets.cbegin(), buckets.cend() };
+}
+
+int PastVuModelController::GetYearHistogramBucketSize() const
+{
+	return YEAR_HISTOGRAM_BUCKET_SIZE;
+}
+
 void PastVuModelController::ToggleOnlyNearestObjects()
 {
 	SetNearestObjectsOnly(!GetNearestObjectsOnly());
@@ -176,6 +332,33 @@ void PastVuModelController::ToggleHistoryNearYouModel()
 	emit HistoryNearModelChanged();
 }
 
+void PastVuModelController::ToggleFusedPipeline()
+{
+	SetFusedPipeline(!GetFusedPipeline());
+	emit ModelChanged();
+}
+
+void PastVuModelController::UpdateModelActivity()
+{
+	auto * clustered = GetModel(ModelType::Clustered);
+	auto * raw = GetModel(ModelType::Raw);
+
+	// ScreenObjectsModel feeds every variant but the fused one and always stays live.
+	// Upstream models are resumed before the cluster models reading from them
+	m_impl->nearestObjectsModel->SetSuspended(clustered != m_impl->clusterModelNearest.get());
+	m_impl->nearestStripModel->SetSuspended(raw != m_impl->nearestStripModel.get());
+	m_impl->clusterModelScreen->SetSuspended(clustered != m_impl->clusterModelScreen.get());
+	m_impl->clusterModelNearest->SetSuspended(clustered != m_impl->clusterModelNearest.get());
+	m_impl->fusedClusterModel->SetSuspended(clustered != m_impl->fusedClusterModel.get());
+
+	m_impl->updateScheduler.OnActiveModelsChanged();
+
+	if (std::exchange(m_impl->clusteredModel, clustered) != clustered)
+		emit ClusteredModelChanged();
+	if (std::exchange(m_impl->rawModel, raw) != raw)
+		emit RawModelChanged();
+}
+
 void PastVuModelController::ReloadItems()
 {
 	m_impl->baseModel->ReloadItems();
@@ -183,6 +366,55 @@ void PastVuModelController::ReloadItems()
 
 void PastVuModelController::SetViewportCoordinates(const QGeoRectangle & viewport)
 {
-	m_impl->viewPort = viewport;
-	emit m_impl->baseModel->UpdateCoords(viewport);
+	SetViewportArea(QGeoPolygon({ viewport.topLeft(), viewport.bottomLeft(), viewport.bottomRight(), viewport.topRight() }));
+}
+
+void PastVuModelController::SetViewportArea(const QGeoPolygon & area)
+{
+	TRACE_SCOPE("PastVuModelController::SetViewportArea");
+	const auto previousViewport = m_impl->viewPort;
+	const auto sampleIntervalMs = m_impl->panClock.isValid() ? m_impl->panClock.restart() : 0;
+	if (!m_impl->panClock.isValid())
+		m_impl->panClock.start();
+
+	// Accepted at any rate, only the latest viewport is processed
+	m_impl->viewportArea = area;
+	m_impl->viewPort = area.boundingGeoRectangle();
+
+	// Panning fast enough, the area next to the viewport in the direction of the pan is loaded ahead
+	if (const auto diagonal = DiagonalMeters(previousViewport); diagonal > 0 && sampleIntervalMs > 0 && sampleIntervalMs <= MAX_PAN_SAMPLE_INTERVAL_MS)
+	{
+		const auto previousCenter = previousViewport.center();
+		const auto center = m_impl->viewPort.center();
+		const auto speed = previousCenter.distanceTo(center) / diagonal * 1000.0 / sampleIntervalMs;
+		if (speed >= MIN_PAN_SPEED_DIAGONALS_PER_SECOND)
+			PrefetchAhead(center, previousCenter.azimuthTo(center));
+	}
+
+	// Throttled rather than debounced, so clusters keep up with a continuous pan
+	if (!m_impl->clusterThrottleTimer.isActive())
+		m_impl->clusterThrottleTimer.start();
+
+	m_impl->fetchDebounceTimer.start();
+}
+
+void PastVuModelController::FetchViewport()
+{
+	TRACE_SCOPE("PastVuModelController::FetchViewport");
+	// Also for prefetched areas, the base model skips loaded tiles and keeps the area for reloads
+	emit m_impl->baseModel->UpdateCoords(m_impl->viewportArea);
+}
+
+void PastVuModelController::PrefetchAhead(const QGeoCoordinate & origin, double azimuth)
+{
+	if (!m_impl->viewPort.isValid() || !origin.isValid())
+		return;
+
+	if (m_impl->prefetchClock.isValid() && m_impl->prefetchClock.elapsed() < PREFETCH_INTERVAL_MS)
+		return;
+
+	// A viewport sized area, so it is covered once the user gets there at the current zoom
+	const auto target = origin.atDistanceAndAzimuth(DiagonalMeters(m_impl->viewPort) * PREFETCH_SHIFT_DIAGONALS, azimuth);
+	m_impl->baseModel->Prefetch(MoveArea(m_impl->viewportArea, m_impl->viewPort.center(), target));
+	m_impl->prefetchClock.start();
 }
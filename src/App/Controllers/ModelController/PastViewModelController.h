@@ -3,6 +3,7 @@
 #include <memory>
 
 #include <QAbstractItemModel>
+#include <QGeoPolygon>
 #include <QGeoPositionInfoSource>
 #include <QGeoRectangle>
 #include <QLocationPermission>
@@ -12,7 +13,10 @@
 
 #include "App/Utils/Range.h"
 
+class BaseModel;
 class PositionSourceAdapter;
+class RegionDownloader;
+Q_MOC_INCLUDE("App/Controllers/ModelController/RegionDownloader.h")
 
 namespace ModelType {
 Q_NAMESPACE
@@ -36,10 +40,14 @@ signals:
 	void NearestObjectsOnlyChanged();
 	void ModelChanged();
 	void HistoryNearModelChanged();
+	void FusedPipelineChanged();
+	void ClusteredModelChanged();
+	void RawModelChanged();
 	void ZoomLevelChanged();
 	void YearFromChanged();
 	void YearToChanged();
 	void UserSelectedTimelineRangeChanged(const Range & timeline);
+	void YearHistogramChanged();
 
 	// @IMPORTANT: signals exposed to QML and HAVE to be in camel case
 	void loadingItems();
@@ -47,19 +55,36 @@ signals:
 
 public:
 	PastVuModelController(const QLocationPermission & permission, QSettings & settings, QObject * parent = nullptr);
+	// Models fed by the given source and base model, e.g. for headless runs against fixtures;
+	// with no base model one talking to PastVu is created. Updates are left to the caller.
+	// A given base model comes with no offline regions, nothing is stored or downloaded
+	PastVuModelController(std::unique_ptr<QGeoPositionInfoSource> source, std::unique_ptr<BaseModel> baseModel, QSettings & settings, QObject * parent = nullptr);
 	~PastVuModelController();
 
 	Q_PROPERTY(bool nearestObjectsOnly READ GetNearestObjectsOnly WRITE SetNearestObjectsOnly NOTIFY NearestObjectsOnlyChanged);
 	Q_PROPERTY(bool historyNearModelType READ GetHistoryNearModelType WRITE SetHistoryNearModelType NOTIFY HistoryNearModelChanged);
+	Q_PROPERTY(bool fusedPipeline READ GetFusedPipeline WRITE SetFusedPipeline NOTIFY FusedPipelineChanged);
+	// The models chosen by the settings above, inactive ones are suspended
+	Q_PROPERTY(QAbstractItemModel * clusteredModel READ GetClusteredModel NOTIFY ClusteredModelChanged);
+	Q_PROPERTY(QAbstractItemModel * rawModel READ GetRawModel NOTIFY RawModelChanged);
 	Q_PROPERTY(int zoomLevel READ GetZoomLevel WRITE SetZoomLevel NOTIFY ZoomLevelChanged);
 	Q_PROPERTY(Range timelineRange READ GetTimelineRange);
 	Q_PROPERTY(Range userSelectedTimelineRange READ GetUserSelectedTimelineRange WRITE SetUserSelectedTimelineRange NOTIFY UserSelectedTimelineRangeChanged);
+	Q_PROPERTY(QList<int> yearHistogram READ GetYearHistogram NOTIFY YearHistogramChanged);
+	Q_PROPERTY(int yearHistogramBucketSize READ GetYearHistogramBucketSize CONSTANT);
+	// Null when the base model was given
+	Q_PROPERTY(RegionDownloader * offlineRegions READ GetOfflineRegions CONSTANT);
 
 	Q_INVOKABLE QString GetMapHostApiKey();
 	Q_INVOKABLE PositionSourceAdapter * GetPositionSource();
+	// Bounding box of the last viewport area
+	Q_INVOKABLE QGeoRectangle GetViewport() const;
 	Q_INVOKABLE void SetViewportCoordinates(const QGeoRectangle & viewport);
+	// Visible area of a possibly rotated map, corners in counter-clockwise order
+	Q_INVOKABLE void SetViewportArea(const QGeoPolygon & area);
 	Q_INVOKABLE void ToggleOnlyNearestObjects();
 	Q_INVOKABLE void ToggleHistoryNearYouModel();
+	Q_INVOKABLE void ToggleFusedPipeline();
 	Q_INVOKABLE void ReloadItems();
 
 	void OnPositionPermissionGranted();
@@ -73,6 +98,12 @@ private:
 	bool GetHistoryNearModelType();
 	void SetHistoryNearModelType(bool value);
 
+	bool GetFusedPipeline();
+	void SetFusedPipeline(bool value);
+
+	QAbstractItemModel * GetClusteredModel() const;
+	QAbstractItemModel * GetRawModel() const;
+
 	int GetZoomLevel() const;
 	void SetZoomLevel(int value);
 
@@ -80,6 +111,17 @@ private:
 	Range GetUserSelectedTimelineRange() const;
 	void SetUserSelectedTimelineRange(const Range & range);
 
+	QList<int> GetYearHistogram() const;
+	int GetYearHistogramBucketSize() const;
+
+	RegionDownloader * GetOfflineRegions() const;
+
+	// Suspends the models no longer chosen, resumes the chosen ones and announces the switch
+	void UpdateModelActivity();
+	void FetchViewport();
+	// Loads the viewport sized area one step from origin towards azimuth
+	void PrefetchAhead(const QGeoCoordinate & origin, double azimuth);
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -0,0 +1,320 @@
+#include "RegionDownloader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QTimer>
+
+#include "glog/logging.h"
+
+#include "App/Models/OfflineStore.h"
+#include "App/Models/PastVuApi.h"
+#include "App/Models/TileGrid.h"
+#include "App/Utils/Trace.h"
+
+namespace {
+
+constexpr auto OFFLINE_REGION = "OfflineRegion";
+constexpr auto NORTH = "North";
+constexpr auto WEST = "West";
+constexpr auto SOUTH = "South";
+constexpr auto EAST = "East";
+
+// Four requests a second at most, the API is shared with everyone browsing the map
+constexpr auto REQUEST_INTERVAL_MS = 250;
+constexpr auto MAX_IN_FLIGHT = 2;
+// A tile failing this often is skipped until the next resume
+constexpr auto MAX_ATTEMPTS = 3;
+
+std::optional<QGeoRectangle> LoadRegion(QSettings & settings)
+{
+	settings.beginGroup(OFFLINE_REGION);
+	std::optional<QGeoRectangle> region;
+	if (settings.contains(NORTH))
+	{
+		region = QGeoRectangle(
+			{ settings.value(NORTH).toDouble(), settings.value(WEST).toDouble() },
+			{ settings.value(SOUTH).toDouble(), settings.value(EAST).toDouble() });
+	}
+	settings.endGroup();
+	return region;
+}
+
+void SaveRegion(QSettings & settings, const QGeoRectangle & region)
+{
+	settings.beginGroup(OFFLINE_REGION);
+	settings.setValue(NORTH, region.topLeft().latitude());
+	settings.setValue(WEST, region.topLeft().longitude());
+	settings.setValue(SOUTH, region.bottomRight().latitude());
+	settings.setValue(EAST, region.bottomRight().longitude());
+	settings.endGroup();
+}
+
+}
+
+struct RegionDownloader::Impl
+{
+	struct PendingTile
+	{
+		TileGrid::Tile tile;
+		int attempts { 0 };
+	};
+
+	Impl(OfflineStore & store, QUrl apiUrl, std::unique_ptr<QNetworkAccessManager> networkManager, QSettings & settings)
+		: store(store)
+		, apiUrl(std::move(apiUrl))
+		, networkManager(std::move(networkManager))
+		, settings(settings)
+	{
+	}
+
+	OfflineStore & store;
+	QUrl apiUrl;
+	std::unique_ptr<QNetworkAccessManager> networkManager;
+	QSettings & settings;
+	QTimer requestTimer;
+	std::deque<PendingTile> queue;
+	std::map<QNetworkReply *, PendingTile> inFlight;
+	bool downloading { false };
+	int tilesTotal { 0 };
+	int tilesDone { 0 };
+	int failedTiles { 0 };
+	qint64 downloadedBytes { 0 };
+};
+
+RegionDownloader::RegionDownloader(OfflineStore & store, const QUrl & apiUrl, std::unique_ptr<QNetworkAccessManager> networkManager, QSettings & settings, QObject * parent)
+	: QObject(parent)
+	, m_impl(std::make_unique<Impl>(store, apiUrl, std::move(networkManager), settings))
+{
+	m_impl->requestTimer.setInterval(REQUEST_INTERVAL_MS);
+	connect(&m_impl->requestTimer, &QTimer::timeout, this, &RegionDownloader::RequestNext);
+	connect(m_impl->networkManager.get(), &QNetworkAccessManager::finished, this, &RegionDownloader::OnNetworkReplyFinished);
+
+	// A download cut short by the app closing shows how far it got
+	if (const auto region = LoadRegion(settings))
+	{
+		const auto tiles = OfflineStore::TilesCovering(*region);
+		m_impl->tilesTotal = static_cast<int>(tiles.size());
+		m_impl->tilesDone = static_cast<int>(std::ranges::count_if(tiles, [this](const TileGrid::Tile & tile) { return m_impl->store.Contains(tile); }));
+	}
+}
+
+RegionDownloader::~RegionDownloader() = default;
+
+int RegionDownloader::CountMissingTiles(const QGeoRectangle & region) const
+{
+	if (!region.isValid())
+		return 0;
+
+	// Too large to download anyway, not worth listing
+	if (const auto count = OfflineStore::CountTilesCovering(region); count > MAX_REGION_TILES)
+		return static_cast<int>(std::min<qint64>(count, std::numeric_limits<int>::max()));
+
+	const auto tiles = OfflineStore::TilesCovering(region);
+	return static_cast<int>(std::ranges::count_if(tiles, [this](const TileGrid::Tile & tile) { return !m_impl->store.Contains(tile); }));
+}
+
+qint64 RegionDownloader::EstimateBytes(const QGeoRectangle & region) const
+{
+	return CountMissingTiles(region) * m_impl->store.AverageTileBytes();
+}
+
+bool RegionDownloader::Download(const QGeoRectangle & region)
+{
+	if (!region.isValid())
+		return false;
+
+	if (OfflineStore::CountTilesCovering(region) > MAX_REGION_TILES)
+	{
+		emit regionTooLarge();
+		return false;
+	}
+
+	Pause();
+	SaveRegion(m_impl->settings, region);
+	Start(region);
+	return true;
+}
+
+void RegionDownloader::Pause()
+{
+	m_impl->requestTimer.stop();
+	m_impl->queue.clear();
+
+	// Aborting finishes the reply synchronously, which edits inFlight, so the replies are collected first
+	std::vector<QPointer<QNetworkReply>> replies;
+	for (const auto & [reply, pending] : m_impl->inFlight)
+		replies.emplace_back(reply);
+	for (const auto & reply : replies)
+		if (reply)
+			reply->abort();
+
+	if (std::exchange(m_impl->downloading, false))
+		emit StateChanged();
+}
+
+void RegionDownloader::Resume()
+{
+	if (const auto region = LoadRegion(m_impl->settings); region && !m_impl->downloading)
+		Start(*region);
+}
+
+void RegionDownloader::ClearOfflineData()
+{
+	Pause();
+	m_impl->settings.remove(OFFLINE_REGION);
+	m_impl->store.Clear();
+	m_impl->tilesTotal = 0;
+	m_impl->tilesDone = 0;
+	m_impl->downloadedBytes = 0;
+	emit StateChanged();
+	emit ProgressChanged();
+}
+
+bool RegionDownloader::IsDownloading() const
+{
+	return m_impl->downloading;
+}
+
+bool RegionDownloader::IsResumable() const
+{
+	return !m_impl->downloading && LoadRegion(m_impl->settings).has_value();
+}
+
+int RegionDownloader::GetTilesDone() const
+{
+	return m_impl->tilesDone;
+}
+
+int RegionDownloader::GetTilesTotal() const
+{
+	return m_impl->tilesTotal;
+}
+
+qint64 RegionDownloader::GetDownloadedBytes() const
+{
+	return m_impl->downloadedBytes;
+}
+
+qint64 RegionDownloader::GetStoredBytes() const
+{
+	return m_impl->store.SizeBytes();
+}
+
+void RegionDownloader::Start(const QGeoRectangle & region)
+{
+	// Tiles stored earlier, by this region or an overlapping one, are not downloaded again
+	const auto tiles = OfflineStore::TilesCovering(region);
+	m_impl->tilesTotal = static_cast<int>(tiles.size());
+	m_impl->tilesDone = 0;
+	m_impl->failedTiles = 0;
+	m_impl->downloadedBytes = 0;
+	for (const auto & tile : tiles)
+	{
+		if (m_impl->store.Contains(tile))
+			++m_impl->tilesDone;
+		else
+			m_impl->queue.push_back({ tile });
+	}
+
+	LOG(INFO) << "Downloading offline region, " << m_impl->queue.size() << " of " << tiles.size() << " tiles missing";
+	m_impl->downloading = true;
+	emit StateChanged();
+	emit ProgressChanged();
+
+	if (m_impl->queue.empty())
+	{
+		Finish();
+		return;
+	}
+
+	m_impl->requestTimer.start();
+	RequestNext();
+}
+
+void RegionDownloader::RequestNext()
+{
+	if (m_impl->queue.empty() || m_impl->inFlight.size() >= MAX_IN_FLIGHT)
+		return;
+
+	const auto pending = m_impl->queue.front();
+	m_impl->queue.pop_front();
+
+	QNetworkRequest request(PastVuApi::TileUrl(m_impl->apiUrl, pending.tile));
+	request.setPriority(QNetworkRequest::LowPriority);
+	auto * reply = m_impl->networkManager->get(request);
+	m_impl->inFlight[reply] = pending;
+	Trace::AsyncBegin("Offline tile", reinterpret_cast<std::uintptr_t>(reply));
+}
+
+void RegionDownloader::OnNetworkReplyFinished(QNetworkReply * reply)
+{
+	reply->deleteLater();
+	const auto it = m_impl->inFlight.find(reply);
+	if (it == m_impl->inFlight.end())
+		return;
+
+	auto pending = it->second;
+	m_impl->inFlight.erase(it);
+	Trace::AsyncEnd("Offline tile", reinterpret_cast<std::uintptr_t>(reply));
+
+	// Paused, the tile is asked again on resume
+	if (reply->error() == QNetworkReply::OperationCanceledError)
+		return;
+
+	auto stored = false;
+	if (reply->error())
+	{
+		LOG(INFO) << "Offline tile error: " << reply->errorString().toStdString();
+	}
+	else
+	{
+		const auto response = reply->readAll();
+		m_impl->downloadedBytes += response.size();
+
+		QString error;
+		if (const auto photos = PastVuApi::ParsePhotos(response, error))
+			stored = m_impl->store.Store(pending.tile, *photos);
+		else
+			LOG(WARNING) << "Failed to parse offline tile with error " << error.toStdString();
+	}
+
+	if (stored)
+		++m_impl->tilesDone;
+	else if (++pending.attempts < MAX_ATTEMPTS)
+		m_impl->queue.push_back(pending);
+	else
+		++m_impl->failedTiles;
+	emit ProgressChanged();
+
+	if (m_impl->queue.empty() && m_impl->inFlight.empty())
+		Finish();
+}
+
+void RegionDownloader::Finish()
+{
+	m_impl->requestTimer.stop();
+	m_impl->downloading = false;
+
+	if (m_impl->failedTiles == 0)
+	{
+		LOG(INFO) << "Offline region complete, " << m_impl->store.SizeBytes() << " bytes stored";
+		m_impl->settings.remove(OFFLINE_REGION);
+		emit StateChanged();
+		emit downloadFinished();
+		return;
+	}
+
+	LOG(WARNING) << "Offline region incomplete, " << m_impl->failedTiles << " tiles failed";
+	emit StateChanged();
+	emit downloadFailed(m_impl->failedTiles);
+}
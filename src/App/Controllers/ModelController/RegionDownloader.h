@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+
+#include <QGeoRectangle>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QSettings>
+#include <QUrl>
+
+class OfflineStore;
+class QNetworkReply;
+
+// Downloads the photo metadata of a region into an OfflineStore, one tile of
+// OfflineStore::TILE_ZOOM per request at a limited rate. The region is remembered
+// until it is complete, so a download cut short resumes with the tiles still missing
+class RegionDownloader
+	: public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(bool downloading READ IsDownloading NOTIFY StateChanged)
+	Q_PROPERTY(bool resumable READ IsResumable NOTIFY StateChanged)
+	Q_PROPERTY(int tilesDone READ GetTilesDone NOTIFY ProgressChanged)
+	Q_PROPERTY(int tilesTotal READ GetTilesTotal NOTIFY ProgressChanged)
+	Q_PROPERTY(qint64 downloadedBytes READ GetDownloadedBytes NOTIFY ProgressChanged)
+	Q_PROPERTY(qint64 storedBytes READ GetStoredBytes NOTIFY ProgressChanged)
+
+signals:
+	void StateChanged();
+	void ProgressChanged();
+
+	// @IMPORTANT: signals exposed to QML and HAVE to be in camel case
+	void downloadFinished();
+	// Tiles that kept failing, the region stays resumable
+	void downloadFailed(int failedTiles);
+	void regionTooLarge();
+
+public:
+	// Larger regions are refused, a city fits several times over
+	static constexpr auto MAX_REGION_TILES = 2500;
+
+	RegionDownloader(OfflineStore & store, const QUrl & apiUrl, std::unique_ptr<QNetworkAccessManager> networkManager, QSettings & settings, QObject * parent = nullptr);
+	~RegionDownloader();
+
+	// Tiles of the region not stored yet and the bytes they are expected to take
+	Q_INVOKABLE int CountMissingTiles(const QGeoRectangle & region) const;
+	Q_INVOKABLE qint64 EstimateBytes(const QGeoRectangle & region) const;
+
+	// Replaces the remembered region, false and regionTooLarge if it is too large
+	Q_INVOKABLE bool Download(const QGeoRectangle & region);
+	// Requests in flight are dropped and asked again on resume
+	Q_INVOKABLE void Pause();
+	Q_INVOKABLE void Resume();
+	// Stops any download and deletes everything stored
+	Q_INVOKABLE void ClearOfflineData();
+
+private slots:
+	void OnNetworkReplyFinished(QNetworkReply * reply);
+
+private:
+	bool IsDownloading() const;
+	bool IsResumable() const;
+	int GetTilesDone() const;
+	int GetTilesTotal() const;
+	qint64 GetDownloadedBytes() const;
+	qint64 GetStoredBytes() const;
+
+	void Start(const QGeoRectangle & region);
+	void RequestNext();
+	void Finish();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
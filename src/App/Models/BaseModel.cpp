@@ -1,31 +1,77 @@
 #include "BaseModel.h"
 
 #include <QAbstractListModel>
+#include <QGeoPolygon>
 #include <QGeoPositionInfoSource>
-#include <QGeoRectangle>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QPointer>
+#include <QPromise>
+#include <QStandardPaths>
+#include <QThreadPool>
 #include <QUrl>
-#include <QUrlQuery>
 #include <QVariant>
 
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
+#include <optional>
 #include <ranges>
+#include <set>
 #include <vector>
 
 #include "glog/logging.h"
 
+#include "App/Models/Clustering.h"
+#include "App/Models/OfflineStore.h"
+#include "App/Models/PastVuApi.h"
+#include "App/Models/TileGrid.h"
+#include "App/Models/YearHistogram.h"
 #include "App/Utils/DirectionUtils.h"
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/Trace.h"
 
 namespace {
 
+// Responses are a few tens of KB, this keeps a city's worth of areas
+constexpr auto MAX_API_CACHE_BYTES = 20 * 1024 * 1024;
+
+// Tiles two levels coarser than the map, a phone screen is then a handful of them
+constexpr auto TILE_ZOOM_OFFSET = 2;
+// Larger viewports fall back to coarser tiles rather than to many requests
+constexpr auto MAX_TILES_PER_FETCH = 12;
+// Bounds the bookkeeping only, a tile whose items were evicted no longer counts as loaded anyway
+constexpr auto MAX_LOADED_TILES = 64;
+// Levels of finer loaded tiles a tile counts as loaded from, e.g. after zooming out one step
+constexpr auto MAX_ZOOM_OUT_LEVELS = 1;
+
+std::vector<TileGrid::Tile> TilesCovering(const QGeoPolygon & area, int zoomLevel)
+{
+	const auto box = area.boundingGeoRectangle();
+	for (auto zoom = std::max(zoomLevel - TILE_ZOOM_OFFSET, 0);; --zoom)
+	{
+		auto tiles = TileGrid::TilesCovering(box.topLeft().latitude(), box.topLeft().longitude(), box.bottomRight().latitude(), box.bottomRight().longitude(), zoom);
+		if (tiles.size() <= MAX_TILES_PER_FETCH || zoom == 0)
+			return tiles;
+	}
+}
+
+// Pairs the spans of a tile read from the offline store
+std::uint64_t TraceId(const TileGrid::Tile & tile)
+{
+	return static_cast<std::uint64_t>(tile.zoom) << 56 | static_cast<std::uint64_t>(tile.x) << 28 | static_cast<std::uint64_t>(tile.y);
+}
+
 Item JsonObjectToItem(const QJsonObject & obj)
 {
 	const auto geo = obj.value("geo").toArray();
-	return {
+	Item item {
 		obj.value("cid").toInt(),
 		{ geo.at(0).toDouble(), geo.at(1).toDouble() },
 		obj.value("file").toString(),
@@ -33,14 +79,17 @@ Item JsonObjectToItem(const QJsonObject & obj)
 		DirectionUtils::BearingFromDirection(obj.value("dir").toString()),
 		obj.value("year").toInt()
 	};
+	item.mercator = Clustering::ToMercator(item.coord);
+	return item;
 }
 }
 
 struct BaseModel::Impl
 {
-	explicit Impl(QGeoPositionInfoSource * positionSource)
-		: networkManager(std::make_unique<QNetworkAccessManager>())
+	Impl(QGeoPositionInfoSource * positionSource, QUrl url, std::unique_ptr<QNetworkAccessManager> networkManager)
+		: networkManager(std::move(networkManager))
 		, positionSource(positionSource)
+		, url(std::move(url))
 		, zoomLevel(13)
 	{
 	}
@@ -49,49 +98,88 @@ struct BaseModel::Impl
 
 	NON_COPY_MOVABLE(Impl);
 
+	struct LoadedTile
+	{
+		TileGrid::Tile tile;
+		// Items of the answer, the tile stops counting as loaded once one of them is evicted
+		std::vector<int> cids;
+	};
+
+	bool IsStillLoaded(const LoadedTile & loaded) const
+	{
+		return std::ranges::all_of(loaded.cids, [this](int cid) { return items.Contains(cid); });
+	}
+
+	// Answered at its own zoom, as part of a coarser tile or as finer tiles
+	bool IsLoaded(const TileGrid::Tile & tile, int zoomOutLevels = MAX_ZOOM_OUT_LEVELS) const
+	{
+		for (auto zoom = tile.zoom; zoom >= 0; --zoom)
+		{
+			const auto shift = tile.zoom - zoom;
+			const TileGrid::Tile covering { zoom, tile.x >> shift, tile.y >> shift };
+			if (const auto it = std::ranges::find(loadedTiles, covering, &LoadedTile::tile); it != loadedTiles.cend() && IsStillLoaded(*it))
+				return true;
+		}
+
+		if (zoomOutLevels == 0)
+			return false;
+
+		for (const auto dy : { 0, 1 })
+			for (const auto dx : { 0, 1 })
+				if (!IsLoaded({ tile.zoom + 1, 2 * tile.x + dx, 2 * tile.y + dy }, zoomOutLevels - 1))
+					return false;
+		return true;
+	}
+
 	std::unique_ptr<QNetworkAccessManager> networkManager;
 	Items items { &Item::cid };
+	YearHistogram yearHistogram;
 	QGeoPositionInfoSource * positionSource;
-	QUrl url { "https://pastvu.com/api2" };
+	QUrl url;
 	int zoomLevel;
-	quint64 requestNumber { 0 };
-	QGeoRectangle lastKnownViewport {};
+	QGeoPolygon lastKnownArea {};
+	std::deque<LoadedTile> loadedTiles;
+	// One request per tile at a time, whoever else needs the tile waits for the same reply
+	std::map<TileGrid::Tile, QPointer<QNetworkReply>> inFlightTiles;
+	// Being read from the offline store on the thread pool
+	std::map<TileGrid::Tile, RequestKind> readingTiles;
+	// Stored tiles that failed to read, requested from the network instead
+	std::set<TileGrid::Tile> unreadableTiles;
+	RequestStats requestStats;
+	const OfflineStore * offlineStore { nullptr };
+	// Between LoadingItems and LoadingFinished
+	bool loading { false };
 };
 
 BaseModel::BaseModel(QGeoPositionInfoSource * positionSource, QObject * parent)
+	: BaseModel(positionSource, QUrl(PastVuApi::API_URL), std::make_unique<QNetworkAccessManager>(), parent)
+{
+	// Revisited areas are revalidated with the stored ETag/Last-Modified instead of downloaded again
+	auto * cache = new QNetworkDiskCache(m_impl->networkManager.get());
+	cache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/api");
+	cache->setMaximumCacheSize(MAX_API_CACHE_BYTES);
+	m_impl->networkManager->setCache(cache);
+}
+
+BaseModel::BaseModel(QGeoPositionInfoSource * positionSource, const QUrl & apiUrl, std::unique_ptr<QNetworkAccessManager> networkManager, QObject * parent)
 	: QAbstractListModel(parent)
-	, m_impl(std::make_unique<Impl>(positionSource))
+	, m_impl(std::make_unique<Impl>(positionSource, apiUrl, std::move(networkManager)))
 {
 	connect(this, &QAbstractListModel::rowsInserted, this, [this] { emit CountChanged(); });
 	connect(this, &QAbstractListModel::rowsRemoved, this, [this] { emit CountChanged(); });
 	connect(this, &QAbstractListModel::modelReset, this, [this] { emit CountChanged(); });
 
-	connect(this, &BaseModel::UpdateCoords, this, [this](const QGeoRectangle & viewport) {
-		if (m_impl->zoomLevel < 9)
+	connect(this, &BaseModel::UpdateCoords, this, [this](const QGeoPolygon & area) {
+		// Reloading before the first viewport arrives has no area yet
+		if (m_impl->zoomLevel < 9 || area.size() < 3)
 			return;
 
-		emit LoadingItems();
-		m_impl->lastKnownViewport = viewport;
-		const auto paramsJson = QString(R"({"z":17,"geometry":{"type":"Polygon","coordinates":[[[%1,%2],[%3,%4],[%5,%6],[%7,%8],[%9,%10]]]},"localWork":1})")
-									.arg(QString::number(viewport.topLeft().longitude(), 'f', 15))
-									.arg(QString::number(viewport.topLeft().latitude(), 'f', 15))
-									.arg(QString::number(viewport.bottomLeft().longitude(), 'f', 15))
-									.arg(QString::number(viewport.bottomLeft().latitude(), 'f', 15))
-									.arg(QString::number(viewport.bottomRight().longitude(), 'f', 15))
-									.arg(QString::number(viewport.bottomRight().latitude(), 'f', 15))
-									.arg(QString::number(viewport.topRight().longitude(), 'f', 15))
-									.arg(QString::number(viewport.topRight().latitude(), 'f', 15))
-									.arg(QString::number(viewport.topLeft().longitude(), 'f', 15))
-									.arg(QString::number(viewport.topLeft().latitude(), 'f', 15));
-
-		QUrlQuery query;
-		query.addQueryItem("method", "photo.getByBounds");
-		query.addQueryItem("params", paramsJson);
-		m_impl->url.setQuery(query);
-
-		QNetworkRequest request(m_impl->url);
-		auto * reply = m_impl->networkManager->get(request);
-		reply->setProperty("requestNumber", ++m_impl->requestNumber);
+		m_impl->lastKnownArea = area;
+		if (RequestTiles(area, RequestKind::Viewport) > 0)
+		{
+			m_impl->loading = true;
+			emit LoadingItems();
+		}
 	});
 
 	connect(m_impl->networkManager.get(), &QNetworkAccessManager::finished, this, &BaseModel::OnNetworkReplyFinished);
@@ -143,6 +231,8 @@ QVariant BaseModel::data(const QModelIndex & index, int role) const
 			return item.selected;
 		case Roles::ZoomLevel:
 			return m_impl->zoomLevel;
+		case Roles::Mercator:
+			return item.mercator;
 		default:
 			assert(false && "Unexpected role");
 	}
@@ -212,6 +302,29 @@ QHash<int, QByteArray> BaseModel::roleNames() const
 #undef ROLENAME
 }
 
+void BaseModel::Prefetch(const QGeoPolygon & area)
+{
+	if (m_impl->zoomLevel < 9 || area.size() < 3)
+		return;
+
+	RequestTiles(area, RequestKind::Prefetch);
+}
+
+bool BaseModel::IsAreaLoaded(const QGeoPolygon & area) const
+{
+	return std::ranges::all_of(TilesCovering(area, m_impl->zoomLevel), [this](const TileGrid::Tile & tile) { return m_impl->IsLoaded(tile); });
+}
+
+void BaseModel::SetOfflineStore(const OfflineStore * store)
+{
+	m_impl->offlineStore = store;
+}
+
+const BaseModel::RequestStats & BaseModel::GetRequestStats() const
+{
+	return m_impl->requestStats;
+}
+
 void BaseModel::OnPositionPermissionGranted()
 {
 	if (m_impl->positionSource)
@@ -220,65 +333,241 @@ void BaseModel::OnPositionPermissionGranted()
 
 void BaseModel::ReloadItems()
 {
+	beginResetModel();
 	m_impl->items.Clear();
-	emit UpdateCoords(m_impl->lastKnownViewport);
+	m_impl->yearHistogram.Clear();
+	m_impl->loadedTiles.clear();
+	endResetModel();
+	emit YearHistogramChanged();
+	emit UpdateCoords(m_impl->lastKnownArea);
+}
+
+const YearHistogram & BaseModel::GetYearHistogram() const
+{
+	return m_impl->yearHistogram;
 }
 
-QGeoRectangle BaseModel::GetLastKnownViewport() const
+const Items & BaseModel::GetItems() const
 {
-	return m_impl->lastKnownViewport;
+	return m_impl->items;
+}
+
+int BaseModel::RequestTiles(const QGeoPolygon & area, RequestKind kind)
+{
+	const auto tiles = TilesCovering(area, m_impl->zoomLevel);
+	const auto prefetch = kind == RequestKind::Prefetch;
+
+	// Requests of the same kind for tiles no longer wanted are superseded. Aborting finishes
+	// the reply synchronously, which edits inFlightTiles, so the replies are collected first
+	std::vector<QPointer<QNetworkReply>> superseded;
+	for (const auto & [tile, reply] : m_impl->inFlightTiles)
+		if (reply && reply->property("prefetch").toBool() == prefetch && std::ranges::find(tiles, tile) == tiles.cend())
+			superseded.push_back(reply);
+	for (const auto & reply : superseded)
+		if (reply)
+			reply->abort();
+
+	auto & stats = m_impl->requestStats;
+	auto pending = 0;
+	for (const auto & tile : tiles)
+	{
+		++stats.tilesNeeded;
+		if (m_impl->IsLoaded(tile))
+		{
+			++stats.loadedHits;
+			continue;
+		}
+
+		++pending;
+		if (const auto it = m_impl->readingTiles.find(tile); it != m_impl->readingTiles.end())
+		{
+			++stats.inFlightHits;
+			if (!prefetch)
+				it->second = RequestKind::Viewport;
+			continue;
+		}
+
+		if (const auto it = m_impl->inFlightTiles.find(tile); it != m_impl->inFlightTiles.cend() && it->second)
+		{
+			++stats.inFlightHits;
+			// A prefetch joined by the viewport becomes a viewport request: the next prefetch no longer
+			// supersedes it and its items may push out older ones like any other on screen
+			if (!prefetch && it->second->property("prefetch").toBool())
+			{
+				it->second->setProperty("prefetch", false);
+				Trace::AsyncEnd("Prefetch tile", reinterpret_cast<std::uintptr_t>(it->second.data()));
+				Trace::AsyncBegin("Viewport tile", reinterpret_cast<std::uintptr_t>(it->second.data()));
+			}
+			continue;
+		}
+
+		// Inside a downloaded region tiles are read from the store, tiles reaching past it are requested
+		if (auto files = m_impl->offlineStore && !m_impl->unreadableTiles.contains(tile) ? m_impl->offlineStore->Files(tile) : std::nullopt)
+		{
+			++stats.offlineHits;
+			ReadOfflineTile(tile, std::move(*files), kind);
+			continue;
+		}
+
+		// Accept-Encoding is left to Qt, which then decodes gzip/deflate itself
+		QNetworkRequest request(PastVuApi::TileUrl(m_impl->url, tile));
+		request.setPriority(prefetch ? QNetworkRequest::LowPriority : QNetworkRequest::NormalPriority);
+		request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+		auto * reply = m_impl->networkManager->get(request);
+		reply->setProperty("prefetch", prefetch);
+		m_impl->inFlightTiles[tile] = reply;
+		Trace::AsyncBegin(prefetch ? "Prefetch tile" : "Viewport tile", reinterpret_cast<std::uintptr_t>(reply));
+	}
+
+	return pending;
 }
 
 void BaseModel::OnNetworkReplyFinished(QNetworkReply * reply)
 {
-	const auto requestNumber = reply->property("requestNumber").toInt();
-	if (const auto skipNonLastReply = requestNumber != m_impl->requestNumber)
+	TRACE_SCOPE("BaseModel::OnNetworkReplyFinished");
+	const auto inFlight = std::ranges::find_if(m_impl->inFlightTiles, [reply](const auto & entry) { return entry.second == reply; });
+	if (inFlight == m_impl->inFlightTiles.cend())
+	{
+		reply->deleteLater();
 		return;
+	}
+
+	const auto tile = inFlight->first;
+	m_impl->inFlightTiles.erase(inFlight);
+	Trace::AsyncEnd(reply->property("prefetch").toBool() ? "Prefetch tile" : "Viewport tile", reinterpret_cast<std::uintptr_t>(reply));
 
 	LOG(INFO) << "Reply received";
 	if (reply->error())
 	{
-		LOG(INFO) << "Reply error:" << reply->errorString().toStdString();
+		if (reply->error() != QNetworkReply::OperationCanceledError)
+			LOG(INFO) << "Reply error:" << reply->errorString().toStdString();
 		reply->deleteLater();
+		SettleLoading();
 		return;
 	}
 
-	LOG(INFO) << "Reply success";
+	auto & stats = m_impl->requestStats;
+	if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+		++stats.httpCacheHits;
+	LOG(INFO) << "Reply success, tile hit ratio " << stats.HitRatio();
+
+	const auto prefetch = reply->property("prefetch").toBool();
 	const auto response = reply->readAll();
 	reply->deleteLater();
 
-	QJsonParseError parserError;
-	const auto jsonDoc = QJsonDocument::fromJson(response, &parserError);
-	if (parserError.error != QJsonParseError::NoError)
-	{
-		LOG(WARNING) << "Failed to parse JSON with error" << parserError.errorString().toStdString();
+	QString error;
+	const auto photos = PastVuApi::ParsePhotos(response, error);
+	if (photos)
+		LoadTile(tile, *photos, prefetch ? EvictionPolicy::KeepLoaded : EvictionPolicy::EvictOldest);
+	else
+		LOG(WARNING) << "Failed to parse JSON with error" << error.toStdString();
+	SettleLoading();
+}
+
+void BaseModel::ReadOfflineTile(const TileGrid::Tile & tile, std::vector<QString> files, RequestKind kind)
+{
+	m_impl->readingTiles[tile] = kind;
+	Trace::AsyncBegin("Offline tile", TraceId(tile));
+
+	// Up to MAX_AREA_TILES files to read and parse, the GUI thread only adds the items
+	auto promise = std::make_shared<QPromise<std::optional<QJsonArray>>>();
+	auto future = promise->future();
+	QThreadPool::globalInstance()->start([promise, files = std::move(files)] {
+		promise->start();
+		promise->addResult(OfflineStore::ReadPhotos(files));
+		promise->finish();
+	});
+
+	future.then(this, [this, tile](const std::optional<QJsonArray> & photos) {
+		Trace::AsyncEnd("Offline tile", TraceId(tile));
+		const auto node = m_impl->readingTiles.extract(tile);
+		if (node.empty())
+			return;
+
+		// An unreadable tile is left unloaded and requested from the network next time
+		if (photos)
+			LoadTile(tile, *photos, node.mapped() == RequestKind::Prefetch ? EvictionPolicy::KeepLoaded : EvictionPolicy::EvictOldest);
+		else
+			m_impl->unreadableTiles.insert(tile);
+		SettleLoading();
+	});
+}
+
+void BaseModel::SettleLoading()
+{
+	if (!m_impl->loading)
 		return;
-	}
 
-	const auto root = jsonDoc.object();
-	const auto result = root.value("result").toObject();
-	const auto photos = result.value("photos").toArray();
+	const auto viewportPending = false
+		|| std::ranges::any_of(m_impl->inFlightTiles, [](const auto & entry) { return entry.second && !entry.second->property("prefetch").toBool(); })
+		|| std::ranges::any_of(m_impl->readingTiles, [](const auto & entry) { return entry.second == RequestKind::Viewport; });
+	if (viewportPending)
+		return;
 
-	if (!photos.isEmpty())
-		ProcessPhotos(photos);
+	m_impl->loading = false;
+	emit LoadingFinished();
 }
 
-void BaseModel::ProcessPhotos(const QJsonArray & photos)
+bool BaseModel::LoadTile(const TileGrid::Tile & tile, const QJsonArray & photos, EvictionPolicy evictionPolicy)
 {
+	// A prefetched tile whose items did not all fit is not loaded and gets requested again once on screen
+	if (!photos.isEmpty() && !ProcessPhotos(photos, evictionPolicy))
+		return false;
+
+	auto & loadedTiles = m_impl->loadedTiles;
+	std::erase_if(loadedTiles, [&](const Impl::LoadedTile & loaded) { return loaded.tile == tile || !m_impl->IsStillLoaded(loaded); });
+
+	Impl::LoadedTile loaded { tile, {} };
+	loaded.cids.reserve(photos.size());
+	for (const auto & photo : photos)
+		loaded.cids.push_back(photo.toObject().value("cid").toInt());
+	loadedTiles.push_back(std::move(loaded));
+	if (loadedTiles.size() > MAX_LOADED_TILES)
+		loadedTiles.pop_front();
+	return true;
+}
+
+bool BaseModel::ProcessPhotos(const QJsonArray & photos, EvictionPolicy evictionPolicy)
+{
+	TRACE_SCOPE("BaseModel::ProcessPhotos");
 	const auto newItemsView = photos
 							| std::views::transform([](const QJsonValue & v) { return v.toObject(); })
 							| std::views::transform([](const QJsonObject & obj) { return JsonObjectToItem(obj); });
 
-	AddItemsToModel(std::vector<Item>(newItemsView.begin(), newItemsView.end()));
+	return AddItemsToModel(std::vector<Item>(newItemsView.begin(), newItemsView.end()), evictionPolicy);
 }
 
-void BaseModel::AddItemsToModel(std::span<const Item> newItems)
+bool BaseModel::AddItemsToModel(std::span<const Item> newItems, EvictionPolicy evictionPolicy)
 {
-	if (newItems.empty())
-		return;
+	ALLOCATION_STAGE("BaseModel::AddItemsToModel");
+	// Areas served again, e.g. from the offline store, add nothing and cost no reset; LoadingFinished still follows
+	if (std::ranges::all_of(newItems, [this](const Item & item) { return m_impl->items.Contains(item.cid); }))
+		return true;
 
 	beginResetModel();
-	m_impl->items.Push(newItems);
+	auto & items = m_impl->items;
+	auto allAdded = true;
+	for (const auto & item : newItems)
+	{
+		if (items.Contains(item.cid))
+			continue;
+
+		// Prefetched items are a guess and must not push out what may be on screen
+		if (items.IsFull() && evictionPolicy == EvictionPolicy::KeepLoaded)
+		{
+			allAdded = false;
+			break;
+		}
+
+		// Keep the histogram in step with the buffer: the oldest item is evicted by the push below
+		if (items.IsFull())
+			m_impl->yearHistogram.Remove(items.At(0).year);
+
+		items.Push(item);
+		m_impl->yearHistogram.Add(item.year);
+	}
 	endResetModel();
+	emit YearHistogramChanged();
 	emit ItemsLoaded();
+	return allAdded;
 }
@@ -1,17 +1,24 @@
 #pragma once
 #include <memory>
+#include <vector>
 
 #include <QAbstractListModel>
 #include <QGeoCoordinate>
+#include <QGeoPolygon>
 #include <QGeoPositionInfoSource>
 #include <QGeoRectangle>
+#include <QNetworkAccessManager>
+#include <QPointF>
+#include <QUrl>
 #include <QVariant>
 
+#include "App/Models/TileGrid.h"
 #include "App/Models/UniqueCircularBuffer.h"
 #include "App/Utils/NonCopyMovable.h"
 
-class QNetworkAccessManager;
+class OfflineStore;
 class QNetworkReply;
+class YearHistogram;
 
 struct Item
 {
@@ -22,6 +29,8 @@ struct Item
 	int bearing { 0 };
 	int year { 0 };
 	bool selected { false };
+	// Projected once on arrival, see Clustering::ToMercator
+	QPointF mercator;
 };
 
 constexpr auto MAX_ITEMS = 1000;
@@ -44,6 +53,8 @@ public:
 		Title,
 		Year,
 		ZoomLevel,
+		// QPointF for clustering, not exposed to QML
+		Mercator,
 
 		// Setters
 		Selected,
@@ -51,7 +62,29 @@ public:
 		LastRole,
 	};
 
+	// Areas are requested as canonical tiles, counted here per tile
+	struct RequestStats
+	{
+		quint64 tilesNeeded { 0 };
+		// Already answered
+		quint64 loadedHits { 0 };
+		// Joined a request still in flight
+		quint64 inFlightHits { 0 };
+		// Answered from the disk cache, fresh or revalidated
+		quint64 httpCacheHits { 0 };
+		// Answered from a downloaded region
+		quint64 offlineHits { 0 };
+
+		// Share of tiles that needed no download
+		double HitRatio() const
+		{
+			return tilesNeeded ? static_cast<double>(loadedHits + inFlightHits + httpCacheHits + offlineHits) / tilesNeeded : 0.0;
+		}
+	};
+
 	explicit BaseModel(QGeoPositionInfoSource * positionSource, QObject * parent = nullptr);
+	// Requests go to apiUrl through networkManager, e.g. a FixtureNetworkAccessManager for offline runs
+	BaseModel(QGeoPositionInfoSource * positionSource, const QUrl & apiUrl, std::unique_ptr<QNetworkAccessManager> networkManager, QObject * parent = nullptr);
 	NON_COPY_MOVABLE(BaseModel);
 
 	~BaseModel();
@@ -60,9 +93,15 @@ public:
 
 signals:
 	void CountChanged();
-	void UpdateCoords(const QGeoRectangle & viewport);
+	// Requests the items within the area, a convex polygon in counter-clockwise order
+	void UpdateCoords(const QGeoPolygon & area);
+	// Tiles of the viewport are being requested
 	void LoadingItems();
+	// Rows changed by arriving items
 	void ItemsLoaded();
+	// After LoadingItems, once no tile of the viewport is pending any more, whether or not rows changed
+	void LoadingFinished();
+	void YearHistogramChanged();
 
 public:
 	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
@@ -72,14 +111,43 @@ public:
 
 	void OnPositionPermissionGranted();
 	void ReloadItems();
-	QGeoRectangle GetLastKnownViewport() const;
+	// Loads the items within the area at low priority, prefetches of tiles no longer ahead are dropped
+	void Prefetch(const QGeoPolygon & area);
+	// Whether every tile covering the area has been answered, at whichever zoom, and its items are still held
+	bool IsAreaLoaded(const QGeoPolygon & area) const;
+	// Tiles the store covers are read from it instead of requested; the store has to outlive the model
+	void SetOfflineStore(const OfflineStore * store);
+	const RequestStats & GetRequestStats() const;
+	const YearHistogram & GetYearHistogram() const;
+	const Items & GetItems() const;
 
 private slots:
 	void OnNetworkReplyFinished(QNetworkReply * reply);
 
 private:
-	void ProcessPhotos(const QJsonArray & photos);
-	void AddItemsToModel(std::span<const Item> newItems);
+	enum class EvictionPolicy
+	{
+		EvictOldest,
+		KeepLoaded,
+	};
+
+	enum class RequestKind
+	{
+		Viewport,
+		Prefetch,
+	};
+
+	// Requests the tiles covering the area that are not loaded yet, returns how many are still pending
+	int RequestTiles(const QGeoPolygon & area, RequestKind kind);
+	// Reads and parses the files on the thread pool, then loads the tile
+	void ReadOfflineTile(const TileGrid::Tile & tile, std::vector<QString> files, RequestKind kind);
+	// Emits LoadingFinished if loading and no viewport tile is pending
+	void SettleLoading();
+	// Whether every item was added, KeepLoaded stops at a full buffer
+	bool ProcessPhotos(const QJsonArray & photos, EvictionPolicy evictionPolicy);
+	// Adds the tile's photos and marks it loaded if they all fit
+	bool LoadTile(const TileGrid::Tile & tile, const QJsonArray & photos, EvictionPolicy evictionPolicy);
+	bool AddItemsToModel(std::span<const Item> newItems, EvictionPolicy evictionPolicy);
 
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
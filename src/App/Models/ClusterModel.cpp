@@ -1,110 +1,36 @@
 #include "ClusterModel.h"
 
 #include "App/Models/BaseModel.h"
+#include "App/Models/Clustering.h"
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/Trace.h"
 
-#include <functional>
-#include <numbers>
-#include <queue>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
-#include <QPointF>
-
 namespace {
 
-constexpr auto CLUSTER_THRESHOLD_PIXELS = 20.0;
-constexpr auto CLUSTER_THRESHOLD_SQUARED = CLUSTER_THRESHOLD_PIXELS * CLUSTER_THRESHOLD_PIXELS;
-constexpr auto NEIGHBOR_RADIUS = 1; // Check 3x3 grid of cells
-
-struct ClusterItem
+struct ClusterItems
 {
-	int sourceRowIndex;
-	QPersistentModelIndex sourceIndex;
-	QGeoCoordinate geoCoord;
-	QPointF screenPos;
-	int cellX;
-	int cellY;
-};
-
-using CellKey = std::pair<int, int>;
-
-const auto getHash = [](const CellKey & key) {
-	return std::hash<int> {}(key.first) ^ (std::hash<int> {}(key.second) << 1);
+	// Item ids are source rows
+	std::vector<Clustering::Item> items;
+	// Parallel to items
+	std::vector<int> cids;
 };
 
-using GridMap = std::unordered_map<CellKey, std::vector<int>, decltype(getHash)>;
-
-double ClampLat(double lat) noexcept
-{
-	// Maximum latitude for Web Mercator projection (EPSG:3857)
-	// Formula: arctan(sinh(π)) × 180/π ≈ 85.0511287798°
-	// This is the latitude where Mercator projection becomes infinite
-	// Used by Google Maps, OpenStreetMap, and most web mapping services
-	constexpr auto WEB_MERCATOR_MAX_LATITUDE = 85.0511287798;
-
-	if (lat > WEB_MERCATOR_MAX_LATITUDE)
-		return WEB_MERCATOR_MAX_LATITUDE;
-	if (lat < -WEB_MERCATOR_MAX_LATITUDE)
-		return -WEB_MERCATOR_MAX_LATITUDE;
-	return lat;
-}
-
-double WrapLon(double lon) noexcept
-{
-	auto x = std::fmod(lon + 180.0, 360.0);
-	if (x < 0)
-		x += 360.0;
-	return x - 180.0; // [-180, 180)
-}
-
-double WorldSizeForZoom(const int zoom) noexcept
-{
-	return std::ldexp(256.0, zoom);
-}
-
-QPointF GeoToWorldPx(const QGeoCoordinate & c, const int z)
+ClusterItems BuildClusterItems(const QAbstractItemModel & sourceModel, const QGeoRectangle & viewport, const QGeoPolygon & visibleArea)
 {
-	const auto world = WorldSizeForZoom(z);
+	auto projectionZoomLevel = sourceModel.data({}, BaseModel::ZoomLevel).toInt();
+	auto projection = Clustering::ScreenProjection(viewport, projectionZoomLevel);
+	const auto screenArea = Clustering::ProjectArea(visibleArea, projection);
 
-	const auto lat = ClampLat(c.latitude());
-	const auto lon = WrapLon(c.longitude());
-
-	const auto x = (lon + 180.0) / 360.0 * world;
-
-	const auto latRad = qDegreesToRadians(lat);
-	const auto sinLat = std::sin(latRad);
-
-	const auto y = (0.5 - std::log((1.0 + sinLat) / (1.0 - sinLat)) / (4.0 * std::numbers::pi)) * world;
-
-	return { x, y };
-}
-
-double AlignWrappedX(double x, double refX, double worldSize)
-{
-	while (x < refX - worldSize / 2.0)
-		x += worldSize;
-	while (x > refX + worldSize / 2.0)
-		x -= worldSize;
-	return x;
-}
-
-QPointF GeoToScreenCoords(const QGeoRectangle & viewport, int zoomLevel, const QGeoCoordinate & geoCoord)
-{
-	const auto worldSize = WorldSizeForZoom(zoomLevel);
-
-	auto topLeft = GeoToWorldPx(viewport.topLeft(), zoomLevel);
-	auto currentPoint = GeoToWorldPx(geoCoord, zoomLevel);
-
-	currentPoint.setX(AlignWrappedX(currentPoint.x(), topLeft.x(), worldSize));
-
-	return { currentPoint.x() - topLeft.x(), currentPoint.y() - topLeft.y() };
-}
-
-std::vector<ClusterItem> BuildClusterItems(const QAbstractItemModel & sourceModel, const QGeoRectangle & viewport)
-{
-	std::vector<ClusterItem> items;
-	items.reserve(sourceModel.rowCount());
+	ClusterItems clusterItems;
+	clusterItems.items.reserve(sourceModel.rowCount());
+	clusterItems.cids.reserve(sourceModel.rowCount());
 	std::unordered_set<int> seenCids;
 
 	for (int i = 0; i < sourceModel.rowCount(); ++i)
@@ -115,174 +41,148 @@ std::vector<ClusterItem> BuildClusterItems(const QAbstractItemModel & sourceMode
 			continue;
 		seenCids.insert(cid);
 
-		const auto coords = sourceModel.data(sourceIndex, BaseModel::Coordinate).value<QGeoCoordinate>();
-		const auto zoomLevel = sourceModel.data(sourceIndex, BaseModel::ZoomLevel).toInt();
-		const auto screenCoords = GeoToScreenCoords(viewport, zoomLevel, coords);
-
-		const auto cellX = static_cast<int>(std::floor(screenCoords.x() / CLUSTER_THRESHOLD_PIXELS));
-		const auto cellY = static_cast<int>(std::floor(screenCoords.y() / CLUSTER_THRESHOLD_PIXELS));
+		if (const auto zoomLevel = sourceModel.data(sourceIndex, BaseModel::ZoomLevel).toInt(); zoomLevel != projectionZoomLevel)
+		{
+			projection = Clustering::ScreenProjection(viewport, zoomLevel);
+			projectionZoomLevel = zoomLevel;
+		}
 
-		items.push_back({ .sourceRowIndex = i,
-			.sourceIndex = QPersistentModelIndex(sourceIndex),
-			.geoCoord = coords,
-			.screenPos = screenCoords,
-			.cellX = cellX,
-			.cellY = cellY });
+		// Sources without the cached projection pay for it on every rebuild
+		const auto mercator = sourceModel.data(sourceIndex, BaseModel::Mercator);
+		auto item = Clustering::MakeItem(i, mercator.isValid() ? mercator.toPointF() : Clustering::ToMercator(sourceModel.data(sourceIndex, BaseModel::Coordinate).value<QGeoCoordinate>()), projection);
+		if (Clustering::AreaContains(screenArea, item.screenPos))
+		{
+			clusterItems.items.push_back(std::move(item));
+			clusterItems.cids.push_back(cid);
+		}
 	}
 
-	return items;
+	return clusterItems;
+}
+
+ItemHandle MakeHandle(const ClusterItems & clusterItems, int member)
+{
+	return { clusterItems.cids[member], clusterItems.items[member].id };
 }
 
-GridMap BuildGridMap(const std::vector<ClusterItem> & items)
+Node CreateNode(const QAbstractItemModel & sourceModel, const ClusterItems & clusterItems, const Clustering::Cluster & cluster)
 {
-	GridMap gridMap;
-	gridMap.reserve(items.size());
+	if (cluster.members.size() == 1)
+		return IndividualNode { MakeHandle(clusterItems, cluster.members[0]) };
 
-	for (size_t i = 0; i < items.size(); ++i)
+	ClusterNode clusterNode { cluster.centroid, {}, {} };
+	clusterNode.members.reserve(cluster.members.size());
+	ClusterSummaryBuilder summary(static_cast<qsizetype>(cluster.members.size()));
+	for (const auto member : cluster.members)
 	{
-		const CellKey key { items[i].cellX, items[i].cellY };
-		gridMap[key].push_back(static_cast<int>(i));
+		const auto handle = MakeHandle(clusterItems, member);
+		const auto sourceIndex = sourceModel.index(handle.rowHint, 0);
+		clusterNode.members.push_back(handle);
+		summary.Add(handle.cid, sourceModel.data(sourceIndex, BaseModel::Year).toInt(), sourceModel.data(sourceIndex, BaseModel::Bearing).toInt());
 	}
 
-	return gridMap;
+	const auto representative = sourceModel.index(clusterItems.items[Clustering::Representative(clusterItems.items, cluster)].id, 0);
+	clusterNode.summary = std::move(summary).Build(sourceModel.data(representative, BaseModel::Thumbnail).toString());
+	return clusterNode;
 }
 
-double CalculateSquaredDistance(const QPointF & a, const QPointF & b) noexcept
+std::vector<Node> BuildNodes(const QAbstractItemModel & sourceModel, const ClusterItems & clusterItems)
 {
-	const auto dx = b.x() - a.x();
-	const auto dy = b.y() - a.y();
-	return dx * dx + dy * dy;
-}
+	TRACE_SCOPE("ClusterModel::BuildClusters");
+	ALLOCATION_STAGE("ClusterModel::BuildClusters");
 
-void VisitNeighboringItems(
-	const std::vector<ClusterItem> & items,
-	const GridMap & gridMap,
-	const int itemIndex,
-	std::function<void(int, double)> && callback)
-{
-	const auto & item = items.at(itemIndex);
+	std::vector<Node> nodes;
+	nodes.reserve(clusterItems.items.size());
+	for (const auto & cluster : Clustering::BuildClusters(clusterItems.items))
+		nodes.push_back(CreateNode(sourceModel, clusterItems, cluster));
 
-	// Check 3x3 grid of cells
-	for (auto dxCell = -NEIGHBOR_RADIUS; dxCell <= NEIGHBOR_RADIUS; ++dxCell)
-	{
-		for (auto dyCell = -NEIGHBOR_RADIUS; dyCell <= NEIGHBOR_RADIUS; ++dyCell)
-		{
-			const CellKey key { item.cellX + dxCell, item.cellY + dyCell };
-			const auto gridIt = gridMap.find(key);
-			if (gridIt == gridMap.end())
-				continue;
-
-			// Check all items in this cell
-			for (const auto otherIndex : gridIt->second)
-			{
-				if (const auto isSelf = otherIndex == itemIndex; isSelf)
-					continue;
-
-				const auto squaredDistance = CalculateSquaredDistance(item.screenPos, items.at(otherIndex).screenPos);
-				callback(otherIndex, squaredDistance);
-			}
-		}
-	}
+	return nodes;
 }
 
-std::vector<int> FindClusterMembers(
-	const std::vector<ClusterItem> & items,
-	const GridMap & gridMap,
-	std::vector<bool> & visited,
-	const int startIndex)
+quint64 MixCid(int cid)
 {
-	std::vector<int> members;
-	std::queue<int> queue;
-
-	queue.push(startIndex);
-	members.push_back(startIndex);
-	visited[startIndex] = true;
+	// splitmix64 finalizer, so sums of cids rarely collide
+	auto x = static_cast<quint64>(static_cast<quint32>(cid)) + 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
 
-	while (!queue.empty())
-	{
-		const auto currentIndex = queue.front();
-		queue.pop();
-
-		VisitNeighboringItems(items, gridMap, currentIndex, [&](int candidateIndex, double distanceSquared) {
-			if (visited.at(candidateIndex))
-				return;
-
-			if (distanceSquared <= CLUSTER_THRESHOLD_SQUARED)
-			{
-				visited.at(candidateIndex) = true;
-				queue.push(candidateIndex);
-				members.push_back(candidateIndex);
-			}
-		});
-	}
+// Same for nodes standing for the same items, whatever the member order
+quint64 NodeKey(const Node & node)
+{
+	if (const auto * individual = std::get_if<IndividualNode>(&node))
+		return MixCid(individual->item.cid);
 
-	return members;
+	quint64 key = 0;
+	for (const auto & member : std::get<ClusterNode>(node).members)
+		key += MixCid(member.cid);
+	return key;
 }
 
-QGeoCoordinate CalculateCentroid(const std::vector<ClusterItem> & items, const std::vector<int> & memberIndices)
+// Role of the item an individual node stands for
+int IndividualRole(int role)
 {
-	auto sumLat = 0.0;
-	auto sumLon = 0.0;
-
-	for (const auto index : memberIndices)
+	switch (role)
 	{
-		const auto & item = items[index];
-		sumLat += item.geoCoord.latitude();
-		sumLon += item.geoCoord.longitude();
+		case ClusterModel::ClusterYearFrom:
+		case ClusterModel::ClusterYearTo:
+			return BaseModel::Year;
+		case ClusterModel::ClusterThumbnail:
+			return BaseModel::Thumbnail;
+		case ClusterModel::ClusterBearing:
+			return BaseModel::Bearing;
+		default:
+			return role;
 	}
-
-	assert(!memberIndices.empty());
-	const auto memberCount = static_cast<double>(memberIndices.size());
-	const auto centroidLat = sumLat / memberCount;
-	const auto centroidLon = sumLon / memberCount;
-	return { centroidLat, centroidLon };
 }
 
-Node CreateNode(const std::vector<ClusterItem> & items, const std::vector<int> & memberIndices)
+// Roles of an individual node that follow a changed source role, an empty list stands for all
+QList<int> NodeRoles(const QList<int> & sourceRoles)
 {
-	if (memberIndices.size() == 1)
-		return IndividualNode { items[memberIndices[0]].sourceIndex };
-
-	QVector<QPersistentModelIndex> sourceIndices;
-	sourceIndices.reserve(static_cast<qsizetype>(memberIndices.size()));
-
-	for (const auto index : memberIndices)
-		sourceIndices.push_back(items[index].sourceIndex);
-
-	const auto centroid = CalculateCentroid(items, memberIndices);
-	return ClusterNode { centroid, sourceIndices };
+	auto roles = sourceRoles;
+	for (const auto role : sourceRoles)
+	{
+		switch (role)
+		{
+			case BaseModel::Year:
+				roles << ClusterModel::ClusterYearFrom << ClusterModel::ClusterYearTo;
+				break;
+			case BaseModel::Thumbnail:
+				roles << ClusterModel::ClusterThumbnail;
+				break;
+			case BaseModel::Bearing:
+				roles << ClusterModel::ClusterBearing;
+				break;
+			default:
+				break;
+		}
+	}
+	return roles;
 }
 
-double FindNearestNeighborDistancePx(const std::vector<ClusterItem> & items, const GridMap & gridMap, const int itemIndex)
+std::vector<int> SortedCids(const ClusterNode & node)
 {
-	auto bestDistanceSquared = std::numeric_limits<double>::infinity();
-
-	VisitNeighboringItems(items, gridMap, itemIndex, [&](int, double squaredDistance) {
-		if (squaredDistance < bestDistanceSquared)
-			bestDistanceSquared = squaredDistance;
-	});
-
-	return std::isfinite(bestDistanceSquared)
-			 ? std::sqrt(bestDistanceSquared)
-			 : std::numeric_limits<double>::infinity();
+	std::vector<int> cids;
+	cids.reserve(node.members.size());
+	for (const auto & member : node.members)
+		cids.push_back(member.cid);
+	std::ranges::sort(cids);
+	return cids;
 }
 
-int ZoomToDeclusterFromNearestPx(const double dPx, const int currentZoom)
+// Checked on a NodeKey match, so a collision of the sums never keeps a stale centroid or summary
+bool HaveSameItems(const Node & left, const Node & right)
 {
-	static constexpr auto maxZoom = 20;
-
-	if (dPx <= 0.0)
-		return std::min(maxZoom, currentZoom + 1);
-
-	if (const auto alreadyDeclustered = dPx > CLUSTER_THRESHOLD_PIXELS; alreadyDeclustered)
-		return currentZoom;
+	if (left.index() != right.index())
+		return false;
 
-	// How many zooms(doublings) until dPx becomes > 20?
-	// After k zoom steps: dPx * 2^k > 20
-	// So: k > log2(20 / dPx)
-	const auto zooms = static_cast<int>(std::ceil(std::log2(CLUSTER_THRESHOLD_PIXELS / dPx)));
+	if (const auto * individual = std::get_if<IndividualNode>(&left))
+		return individual->item.cid == std::get<IndividualNode>(right).item.cid;
 
-	return std::min(maxZoom, currentZoom + std::max(1, zooms));
+	const auto & leftCluster = std::get<ClusterNode>(left);
+	const auto & rightCluster = std::get<ClusterNode>(right);
+	return leftCluster.members.size() == rightCluster.members.size() && SortedCids(leftCluster) == SortedCids(rightCluster);
 }
 
 }
@@ -292,6 +192,17 @@ struct ClusterModel::Impl
 	QAbstractItemModel * sourceModel;
 	std::vector<Node> nodes;
 	QGeoRectangle viewport;
+	// Items outside are culled, unset means no culling
+	QGeoPolygon visibleArea;
+	std::vector<QMetaObject::Connection> sourceConnections;
+	bool suspended { false };
+
+	// Bumped whenever source rows move; row hints of nodes built at an older one need checking
+	quint64 sourceGeneration { 1 };
+	quint64 nodesGeneration { 0 };
+	// Source row by cid, built on demand once per generation
+	mutable std::unordered_map<int, int> rowOfCid;
+	mutable quint64 rowOfCidGeneration { 0 };
 };
 
 ClusterModel::ClusterModel(QAbstractItemModel * sourceModel, QObject * parent)
@@ -299,10 +210,7 @@ ClusterModel::ClusterModel(QAbstractItemModel * sourceModel, QObject * parent)
 	, m_impl(std::make_unique<Impl>(sourceModel))
 
 {
-	connect(m_impl->sourceModel, &QAbstractItemModel::modelReset, this, &ClusterModel::modelReset);
-	connect(m_impl->sourceModel, &QAbstractItemModel::rowsInserted, this, &ClusterModel::rowsInserted);
-	connect(m_impl->sourceModel, &QAbstractItemModel::rowsRemoved, this, &ClusterModel::rowsRemoved);
-	connect(m_impl->sourceModel, &QAbstractItemModel::dataChanged, this, &ClusterModel::dataChanged);
+	ConnectSource();
 
 	connect(this, &ClusterModel::rowsInserted, this, [this] { emit CountChanged(); });
 	connect(this, &ClusterModel::rowsRemoved, this, [this] { emit CountChanged(); });
@@ -310,6 +218,7 @@ ClusterModel::ClusterModel(QAbstractItemModel * sourceModel, QObject * parent)
 
 	beginResetModel();
 	m_impl->nodes = BuildClusters();
+	m_impl->nodesGeneration = m_impl->sourceGeneration;
 	endResetModel();
 }
 
@@ -336,20 +245,14 @@ QVariant ClusterModel::data(const QModelIndex & index, int role) const
 				return 1;
 
 			const auto & clusterNode = std::get<ClusterNode>(node);
-			return clusterNode.indicesIntoSourceModel.size();
+			return static_cast<int>(clusterNode.members.size());
 		}
 		case CidsInCluster:
 		{
 			if (!std::holds_alternative<ClusterNode>(node))
 				return {};
 
-			const auto & clusterNode = std::get<ClusterNode>(node);
-			QVariantList cids;
-			cids.reserve(clusterNode.indicesIntoSourceModel.size());
-			for (const auto index : clusterNode.indicesIntoSourceModel)
-				cids.emplace_back(m_impl->sourceModel->data(index, BaseModel::Roles::Cid).toInt());
-
-			return cids;
+			return std::get<ClusterNode>(node).summary.cids;
 		}
 		default:
 			break;
@@ -357,21 +260,39 @@ QVariant ClusterModel::data(const QModelIndex & index, int role) const
 
 	if (std::holds_alternative<IndividualNode>(node))
 	{
-		const auto & individualNode = std::get<IndividualNode>(node);
-		assert(individualNode.indexIntoSourceModel.isValid());
-		return m_impl->sourceModel->data(individualNode.indexIntoSourceModel, role);
+		// Invalid when the item left the source after the last rebuild
+		const auto sourceIndex = ResolveSourceIndex(std::get<IndividualNode>(node).item);
+		if (!sourceIndex.isValid())
+			return {};
+		return m_impl->sourceModel->data(sourceIndex, IndividualRole(role));
 	}
 	else if (std::holds_alternative<ClusterNode>(node))
 	{
 		const auto & clusterNode = std::get<ClusterNode>(node);
 
-		// For clusters, return centroid coordinate and aggregate data from first member
-		if (role == BaseModel::Coordinate)
-			return QVariant::fromValue(clusterNode.centroid);
+		// For clusters, return centroid coordinate and the aggregates cached at rebuild
+		switch (role)
+		{
+			case BaseModel::Coordinate:
+				return QVariant::fromValue(clusterNode.centroid);
+			case ClusterYearFrom:
+				return clusterNode.summary.yearFrom;
+			case ClusterYearTo:
+				return clusterNode.summary.yearTo;
+			case ClusterThumbnail:
+				return clusterNode.summary.thumbnail;
+			case ClusterBearing:
+				return clusterNode.summary.dominantBearing;
+			default:
+				break;
+		}
 
 		// For other roles, use data from the first member
-		if (!clusterNode.indicesIntoSourceModel.isEmpty() && clusterNode.indicesIntoSourceModel.front().isValid())
-			return m_impl->sourceModel->data(clusterNode.indicesIntoSourceModel.front(), role);
+		if (!clusterNode.members.empty())
+		{
+			if (const auto sourceIndex = ResolveSourceIndex(clusterNode.members.front()); sourceIndex.isValid())
+				return m_impl->sourceModel->data(sourceIndex, role);
+		}
 	}
 
 	return {};
@@ -384,54 +305,238 @@ QHash<int, QByteArray> ClusterModel::roleNames() const
 	ROLENAME(ClusterCount);
 	ROLENAME(CidsInCluster);
 	ROLENAME(IsCluster);
+	ROLENAME(ClusterYearFrom);
+	ROLENAME(ClusterYearTo);
+	ROLENAME(ClusterThumbnail);
+	ROLENAME(ClusterBearing);
 #undef ROLENAME
 	return roles;
 }
 
 std::vector<Node> ClusterModel::BuildClusters() const
 {
-	const auto items = BuildClusterItems(*m_impl->sourceModel, m_impl->viewport);
-	if (items.empty())
-		return {};
+	return BuildNodes(*m_impl->sourceModel, BuildClusterItems(*m_impl->sourceModel, m_impl->viewport, m_impl->visibleArea));
+}
 
-	const auto gridMap = BuildGridMap(items);
-	std::vector<bool> visited(items.size(), false);
-	std::vector<Node> nodes;
-	nodes.reserve(items.size());
+void ClusterModel::SetSuspended(bool suspended)
+{
+	if (std::exchange(m_impl->suspended, suspended) == suspended)
+		return;
 
-	for (size_t i = 0; i < items.size(); ++i)
+	if (!suspended)
 	{
-		if (visited[i])
-			continue;
-
-		const auto members = FindClusterMembers(items, gridMap, visited, static_cast<int>(i));
-		nodes.push_back(CreateNode(items, members));
+		// Source changes were not followed while suspended
+		++m_impl->sourceGeneration;
+		ConnectSource();
+		emit SourceChanged();
+		return;
 	}
 
-	return nodes;
+	for (const auto & connection : m_impl->sourceConnections)
+		disconnect(connection);
+	m_impl->sourceConnections.clear();
+
+	beginResetModel();
+	m_impl->nodes = {};
+	endResetModel();
+}
+
+void ClusterModel::SetVisibleArea(const QGeoPolygon & area)
+{
+	m_impl->visibleArea = area;
 }
 
 void ClusterModel::OnViewportChanged(const QGeoRectangle & viewport)
 {
+	TRACE_SCOPE("ClusterModel::OnViewportChanged");
+	ALLOCATION_STAGE("ClusterModel::OnViewportChanged");
 	m_impl->viewport = viewport;
+	if (m_impl->suspended)
+		return;
 
-	const auto items = BuildClusterItems(*m_impl->sourceModel, viewport);
-	const auto gridMap = BuildGridMap(items);
+	const auto clusterItems = BuildClusterItems(*m_impl->sourceModel, viewport, m_impl->visibleArea);
 
 	const auto currentZoom = m_impl->sourceModel->data({}, BaseModel::ZoomLevel).toInt();
+	const auto zoomsToDecluster = Clustering::ZoomsToDecluster(clusterItems.items, currentZoom);
 	QHash<int, int> cidToZoom;
-	for (size_t i = 0; i < items.size(); ++i)
+	for (size_t i = 0; i < clusterItems.items.size(); ++i)
+		cidToZoom[clusterItems.cids[i]] = zoomsToDecluster[i];
+
+	ApplyNodes(BuildNodes(*m_impl->sourceModel, clusterItems));
+
+	// After the nodes are in place, so the data changes it causes upstream reach the new rows
+	emit ZoomsToDecluster(cidToZoom);
+}
+
+void ClusterModel::ApplyNodes(std::vector<Node> nodes)
+{
+	auto & current = m_impl->nodes;
+
+	std::unordered_map<quint64, int> newRowOfKey;
+	newRowOfKey.reserve(nodes.size());
+	for (int row = 0; row < static_cast<int>(nodes.size()); ++row)
+		newRowOfKey.try_emplace(NodeKey(nodes[row]), row);
+
+	// New row of every current node, -1 for the ones leaving
+	std::vector<int> matches(current.size(), -1);
+	std::vector<bool> matched(nodes.size(), false);
+	for (size_t row = 0; row < current.size(); ++row)
 	{
-		const auto sourceIndex = items[i].sourceIndex;
-		const auto cid = m_impl->sourceModel->data(sourceIndex, BaseModel::Cid).toInt();
-		const auto dPx = FindNearestNeighborDistancePx(items, gridMap, static_cast<int>(i));
-		const auto zoomToDecluster = ZoomToDeclusterFromNearestPx(dPx, currentZoom);
-		cidToZoom[cid] = zoomToDecluster;
+		const auto it = newRowOfKey.find(NodeKey(current[row]));
+		if (it == newRowOfKey.end() || matched[it->second] || !HaveSameItems(current[row], nodes[it->second]))
+			continue;
+		matches[row] = it->second;
+		matched[it->second] = true;
 	}
 
-	emit ZoomsToDecluster(cidToZoom);
+	// Leaving runs are removed from the back, so rows in front keep their numbers
+	for (auto last = static_cast<int>(current.size()) - 1; last >= 0;)
+	{
+		if (matches[last] >= 0)
+		{
+			--last;
+			continue;
+		}
 
-	beginResetModel();
-	m_impl->nodes = BuildClusters();
-	endResetModel();
+		auto first = last;
+		while (first > 0 && matches[first - 1] < 0)
+			--first;
+
+		beginRemoveRows({}, first, last);
+		current.erase(current.begin() + first, current.begin() + last + 1);
+		matches.erase(matches.begin() + first, matches.begin() + last + 1);
+		endRemoveRows();
+		last = first - 1;
+	}
+
+	// Staying nodes keep their row and, having the same members, their centroid and summary.
+	// A cluster reads its other roles from its first member, which the rebuild may have reordered
+	std::vector<int> changedRows;
+	for (size_t row = 0; row < current.size(); ++row)
+	{
+		auto & staying = nodes[matches[row]];
+		if (auto * clusterNode = std::get_if<ClusterNode>(&current[row]))
+		{
+			auto & members = std::get<ClusterNode>(staying).members;
+			if (clusterNode->members.front().cid != members.front().cid)
+				changedRows.push_back(static_cast<int>(row));
+			clusterNode->members = std::move(members);
+		}
+		else
+			current[row] = std::move(staying);
+	}
+	m_impl->nodesGeneration = m_impl->sourceGeneration;
+	for (const auto row : changedRows)
+		emit dataChanged(index(row), index(row));
+
+	const auto arriving = static_cast<int>(std::ranges::count(matched, false));
+	if (arriving > 0)
+	{
+		beginInsertRows({}, static_cast<int>(current.size()), static_cast<int>(current.size()) + arriving - 1);
+		for (size_t row = 0; row < nodes.size(); ++row)
+		{
+			if (!matched[row])
+				current.push_back(std::move(nodes[row]));
+		}
+		endInsertRows();
+	}
+}
+
+void ClusterModel::ConnectSource()
+{
+	// Rebuilding is left to the owner, which coalesces bursts of source changes into one rebuild
+	m_impl->sourceConnections = {
+		connect(m_impl->sourceModel, &QAbstractItemModel::modelReset, this, &ClusterModel::OnSourceRowsChanged),
+		connect(m_impl->sourceModel, &QAbstractItemModel::rowsInserted, this, &ClusterModel::OnSourceRowsChanged),
+		connect(m_impl->sourceModel, &QAbstractItemModel::rowsRemoved, this, &ClusterModel::OnSourceRowsChanged),
+		// Reordering keeps the clusters, only the row hints go stale
+		connect(m_impl->sourceModel, &QAbstractItemModel::rowsMoved, this, [this] { ++m_impl->sourceGeneration; }),
+		connect(m_impl->sourceModel, &QAbstractItemModel::layoutChanged, this, [this] { ++m_impl->sourceGeneration; }),
+		connect(m_impl->sourceModel, &QAbstractItemModel::dataChanged, this, &ClusterModel::OnSourceDataChanged),
+	};
+}
+
+void ClusterModel::OnSourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles)
+{
+	const auto & nodes = m_impl->nodes;
+	if (nodes.empty())
+		return;
+
+	// Data of the whole source, such as its zoom level
+	if (!topLeft.isValid() || !bottomRight.isValid())
+	{
+		emit dataChanged(index(0), index(rowCount() - 1), NodeRoles(roles));
+		return;
+	}
+
+	const auto & sourceModel = *m_impl->sourceModel;
+	const auto nodeRoles = NodeRoles(roles);
+
+	// Every source row, such as when the declustering zooms are refreshed, reaches every node
+	if (topLeft.row() == 0 && bottomRight.row() >= sourceModel.rowCount() - 1)
+	{
+		emit dataChanged(index(0), index(rowCount() - 1), nodeRoles);
+		return;
+	}
+
+	// Node row of every member, built once per signal
+	std::unordered_map<int, int> nodeRowOfCid;
+	for (int row = 0; row < static_cast<int>(nodes.size()); ++row)
+	{
+		if (const auto * individual = std::get_if<IndividualNode>(&nodes[row]))
+		{
+			nodeRowOfCid.try_emplace(individual->item.cid, row);
+			continue;
+		}
+		for (const auto & member : std::get<ClusterNode>(nodes[row]).members)
+			nodeRowOfCid.try_emplace(member.cid, row);
+	}
+
+	std::vector<bool> affected(nodes.size(), false);
+	for (auto row = topLeft.row(); row <= bottomRight.row(); ++row)
+	{
+		if (const auto it = nodeRowOfCid.find(sourceModel.data(sourceModel.index(row, 0), BaseModel::Cid).toInt()); it != nodeRowOfCid.end())
+			affected[it->second] = true;
+	}
+
+	// One signal per run of affected nodes
+	for (int row = 0; row < static_cast<int>(nodes.size()); ++row)
+	{
+		if (!affected[row])
+			continue;
+
+		auto last = row;
+		while (last + 1 < static_cast<int>(nodes.size()) && affected[last + 1])
+			++last;
+		emit dataChanged(index(row), index(last), nodeRoles);
+		row = last;
+	}
+}
+
+void ClusterModel::OnSourceRowsChanged()
+{
+	++m_impl->sourceGeneration;
+	emit SourceChanged();
+}
+
+QModelIndex ClusterModel::ResolveSourceIndex(const ItemHandle & handle) const
+{
+	const auto & sourceModel = *m_impl->sourceModel;
+	if (m_impl->nodesGeneration == m_impl->sourceGeneration)
+		return sourceModel.index(handle.rowHint, 0);
+
+	// Most items keep their row across small source changes
+	if (const auto hinted = sourceModel.index(handle.rowHint, 0); hinted.isValid() && sourceModel.data(hinted, BaseModel::Cid).toInt() == handle.cid)
+		return hinted;
+
+	if (m_impl->rowOfCidGeneration != m_impl->sourceGeneration)
+	{
+		m_impl->rowOfCid.clear();
+		for (int row = 0; row < sourceModel.rowCount(); ++row)
+			m_impl->rowOfCid.try_emplace(sourceModel.data(sourceModel.index(row, 0), BaseModel::Cid).toInt(), row);
+		m_impl->rowOfCidGeneration = m_impl->sourceGeneration;
+	}
+
+	const auto it = m_impl->rowOfCid.find(handle.cid);
+	return it != m_impl->rowOfCid.end() ? sourceModel.index(it->second, 0) : QModelIndex();
 }
@@ -1,22 +1,36 @@
 #pragma once
 
 #include <memory>
+#include <variant>
+#include <vector>
 
 #include <QAbstractListModel>
 #include <QGeoCoordinate>
+#include <QGeoPolygon>
 #include <QGeoRectangle>
 
+#include "App/Models/ClusterSummary.h"
 #include "App/Models/ScreenObjectsModel.h"
 
+// A source item by cid. The row it had when clusters were built is trusted while the
+// source keeps its rows, afterwards it is checked and looked up again when needed.
+// Unlike a persistent index it costs the source nothing on inserts and removes
+struct ItemHandle
+{
+	int cid { 0 };
+	int rowHint { -1 };
+};
+
 struct IndividualNode
 {
-	QPersistentModelIndex indexIntoSourceModel;
+	ItemHandle item;
 };
 
 struct ClusterNode
 {
 	QGeoCoordinate centroid;
-	QVector<QPersistentModelIndex> indicesIntoSourceModel;
+	std::vector<ItemHandle> members;
+	ClusterSummary summary;
 };
 
 using Node = std::variant<IndividualNode, ClusterNode>;
@@ -32,6 +46,11 @@ public:
 		ClusterCount = ScreenObjectsModel::Roles::LastRole + 1,
 		CidsInCluster,
 		IsCluster,
+		// Aggregates over the members, an individual node's own Year, Thumbnail and Bearing
+		ClusterYearFrom,
+		ClusterYearTo,
+		ClusterThumbnail,
+		ClusterBearing,
 	};
 
 	Q_PROPERTY(int count READ rowCount NOTIFY CountChanged)
@@ -42,6 +61,8 @@ public:
 signals:
 	void CountChanged();
 	void ZoomsToDecluster(const QHash<int, int> & cidToZoom);
+	// Source rows were added or removed, clusters are stale until the next OnViewportChanged
+	void SourceChanged();
 
 public:
 	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
@@ -50,10 +71,25 @@ public:
 
 	std::vector<Node> BuildClusters() const;
 
+	// A suspended model is empty and ignores its source; resuming emits SourceChanged to get rebuilt
+	void SetSuspended(bool suspended);
+
+	// Applied from the next OnViewportChanged on
+	void SetVisibleArea(const QGeoPolygon & area);
+
 public slots:
 	void OnViewportChanged(const QGeoRectangle & viewport);
 
 private:
+	void ConnectSource();
+	void OnSourceRowsChanged();
+	// Forwarded to the rows of the nodes holding the changed items
+	void OnSourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles);
+	// Rows of nodes that stay, same items by cid, are kept; the others are removed or appended
+	void ApplyNodes(std::vector<Node> nodes);
+	// Invalid when the item left the source
+	QModelIndex ResolveSourceIndex(const ItemHandle & handle) const;
+
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include <QString>
+#include <QVariantList>
+
+#include "App/Utils/DirectionUtils.h"
+
+// Aggregates of a cluster's members, computed once per rebuild so QML bindings read them in O(1)
+struct ClusterSummary
+{
+	// Implicitly shared, handed to QML without copying
+	QVariantList cids;
+	int yearFrom { 0 };
+	int yearTo { 0 };
+	// Of the member closest to the middle of the cluster
+	QString thumbnail;
+	// Most common known member bearing, ties go to the smaller one
+	int dominantBearing { DirectionUtils::INCORRECT_DIRECTION };
+};
+
+// Fed member by member, in any order
+class ClusterSummaryBuilder
+{
+public:
+	explicit ClusterSummaryBuilder(qsizetype members)
+	{
+		m_summary.cids.reserve(members);
+	}
+
+	void Add(int cid, int year, int bearing)
+	{
+		m_summary.yearFrom = m_summary.cids.isEmpty() ? year : std::min(m_summary.yearFrom, year);
+		m_summary.yearTo = m_summary.cids.isEmpty() ? year : std::max(m_summary.yearTo, year);
+		m_summary.cids.append(cid);
+
+		// Bearings come from the eight PastVu directions
+		if (bearing >= 0 && bearing < 360)
+			++m_bearingCounts[bearing / 45];
+	}
+
+	ClusterSummary Build(QString thumbnail) &&
+	{
+		m_summary.thumbnail = std::move(thumbnail);
+		if (const auto dominant = std::ranges::max_element(m_bearingCounts); *dominant > 0)
+			m_summary.dominantBearing = static_cast<int>(dominant - m_bearingCounts.begin()) * 45;
+		return std::move(m_summary);
+	}
+
+private:
+	ClusterSummary m_summary;
+	std::array<int, 8> m_bearingCounts {};
+};
@@ -0,0 +1,350 @@
+#include "Clustering.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include <QtMath>
+
+namespace Clustering {
+
+namespace {
+
+constexpr auto CLUSTER_THRESHOLD_SQUARED = CLUSTER_THRESHOLD_PIXELS * CLUSTER_THRESHOLD_PIXELS;
+constexpr auto NEIGHBOR_RADIUS = 1; // Check 3x3 grid of cells
+
+using CellKey = std::pair<int, int>;
+
+const auto getHash = [](const CellKey & key) {
+	return std::hash<int> {}(key.first) ^ (std::hash<int> {}(key.second) << 1);
+};
+
+using GridMap = std::unordered_map<CellKey, std::vector<int>, decltype(getHash)>;
+
+double ClampLat(double lat) noexcept
+{
+	// Maximum latitude for Web Mercator projection (EPSG:3857)
+	// Formula: arctan(sinh(π)) × 180/π ≈ 85.0511287798°
+	// This is the latitude where Mercator projection becomes infinite
+	// Used by Google Maps, OpenStreetMap, and most web mapping services
+	constexpr auto WEB_MERCATOR_MAX_LATITUDE = 85.0511287798;
+
+	if (lat > WEB_MERCATOR_MAX_LATITUDE)
+		return WEB_MERCATOR_MAX_LATITUDE;
+	if (lat < -WEB_MERCATOR_MAX_LATITUDE)
+		return -WEB_MERCATOR_MAX_LATITUDE;
+	return lat;
+}
+
+double WrapLon(double lon) noexcept
+{
+	auto x = std::fmod(lon + 180.0, 360.0);
+	if (x < 0)
+		x += 360.0;
+	return x - 180.0; // [-180, 180)
+}
+
+double WorldSizeForZoom(const int zoom) noexcept
+{
+	return std::ldexp(256.0, zoom);
+}
+
+double AlignWrappedX(double x, double refX, double worldSize)
+{
+	while (x < refX - worldSize / 2.0)
+		x += worldSize;
+	while (x > refX + worldSize / 2.0)
+		x -= worldSize;
+	return x;
+}
+
+GridMap BuildGridMap(const std::vector<Item> & items)
+{
+	GridMap gridMap;
+	gridMap.reserve(items.size());
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		const CellKey key { items[i].cellX, items[i].cellY };
+		gridMap[key].push_back(static_cast<int>(i));
+	}
+
+	return gridMap;
+}
+
+double CalculateSquaredDistance(const QPointF & a, const QPointF & b) noexcept
+{
+	const auto dx = b.x() - a.x();
+	const auto dy = b.y() - a.y();
+	return dx * dx + dy * dy;
+}
+
+void VisitNeighboringItems(
+	const std::vector<Item> & items,
+	const GridMap & gridMap,
+	const int itemIndex,
+	std::function<void(int, double)> && callback)
+{
+	const auto & item = items.at(itemIndex);
+
+	// Check 3x3 grid of cells
+	for (auto dxCell = -NEIGHBOR_RADIUS; dxCell <= NEIGHBOR_RADIUS; ++dxCell)
+	{
+		for (auto dyCell = -NEIGHBOR_RADIUS; dyCell <= NEIGHBOR_RADIUS; ++dyCell)
+		{
+			const CellKey key { item.cellX + dxCell, item.cellY + dyCell };
+			const auto gridIt = gridMap.find(key);
+			if (gridIt == gridMap.end())
+				continue;
+
+			// Check all items in this cell
+			for (const auto otherIndex : gridIt->second)
+			{
+				if (const auto isSelf = otherIndex == itemIndex; isSelf)
+					continue;
+
+				const auto squaredDistance = CalculateSquaredDistance(item.screenPos, items.at(otherIndex).screenPos);
+				callback(otherIndex, squaredDistance);
+			}
+		}
+	}
+}
+
+// Sums members in Mercator space as they join. Every x is taken on the side of the
+// antimeridian where the first member is, so members on both sides average between them
+class CentroidAccumulator
+{
+public:
+	explicit CentroidAccumulator(const QPointF & first)
+		: m_referenceX(first.x())
+	{
+	}
+
+	void Add(const QPointF & mercator)
+	{
+		m_sum += { AlignWrappedX(mercator.x(), m_referenceX, 1.0), mercator.y() };
+		++m_count;
+	}
+
+	QGeoCoordinate Centroid() const
+	{
+		assert(m_count > 0);
+		auto mean = m_sum / static_cast<double>(m_count);
+		mean.setX(mean.x() - std::floor(mean.x()));
+		return FromMercator(mean);
+	}
+
+private:
+	double m_referenceX;
+	QPointF m_sum;
+	int m_count { 0 };
+};
+
+Cluster FindCluster(
+	const std::vector<Item> & items,
+	const GridMap & gridMap,
+	std::vector<bool> & visited,
+	const int startIndex)
+{
+	std::vector<int> members;
+	std::queue<int> queue;
+	CentroidAccumulator centroid(items[startIndex].mercator);
+
+	queue.push(startIndex);
+	members.push_back(startIndex);
+	centroid.Add(items[startIndex].mercator);
+	visited[startIndex] = true;
+
+	while (!queue.empty())
+	{
+		const auto currentIndex = queue.front();
+		queue.pop();
+
+		VisitNeighboringItems(items, gridMap, currentIndex, [&](int candidateIndex, double distanceSquared) {
+			if (visited.at(candidateIndex))
+				return;
+
+			if (distanceSquared <= CLUSTER_THRESHOLD_SQUARED)
+			{
+				visited.at(candidateIndex) = true;
+				queue.push(candidateIndex);
+				members.push_back(candidateIndex);
+				centroid.Add(items[candidateIndex].mercator);
+			}
+		});
+	}
+
+	return { std::move(members), centroid.Centroid() };
+}
+
+double FindNearestNeighborDistancePx(const std::vector<Item> & items, const GridMap & gridMap, const int itemIndex)
+{
+	auto bestDistanceSquared = std::numeric_limits<double>::infinity();
+
+	VisitNeighboringItems(items, gridMap, itemIndex, [&](int, double squaredDistance) {
+		if (squaredDistance < bestDistanceSquared)
+			bestDistanceSquared = squaredDistance;
+	});
+
+	return std::isfinite(bestDistanceSquared)
+			 ? std::sqrt(bestDistanceSquared)
+			 : std::numeric_limits<double>::infinity();
+}
+
+int ZoomToDeclusterFromNearestPx(const double dPx, const int currentZoom)
+{
+	static constexpr auto maxZoom = 20;
+
+	if (dPx <= 0.0)
+		return std::min(maxZoom, currentZoom + 1);
+
+	if (const auto alreadyDeclustered = dPx > CLUSTER_THRESHOLD_PIXELS; alreadyDeclustered)
+		return currentZoom;
+
+	// How many zooms(doublings) until dPx becomes > 20?
+	// After k zoom steps: dPx * 2^k > 20
+	// So: k > log2(20 / dPx)
+	const auto zooms = static_cast<int>(std::ceil(std::log2(CLUSTER_THRESHOLD_PIXELS / dPx)));
+
+	return std::min(maxZoom, currentZoom + std::max(1, zooms));
+}
+
+}
+
+QPointF ToMercator(const QGeoCoordinate & coord)
+{
+	const auto lat = ClampLat(coord.latitude());
+	const auto lon = WrapLon(coord.longitude());
+
+	const auto x = (lon + 180.0) / 360.0;
+
+	const auto latRad = qDegreesToRadians(lat);
+	const auto sinLat = std::sin(latRad);
+
+	const auto y = 0.5 - std::log((1.0 + sinLat) / (1.0 - sinLat)) / (4.0 * std::numbers::pi);
+
+	return { x, y };
+}
+
+QGeoCoordinate FromMercator(const QPointF & mercator)
+{
+	const auto lon = mercator.x() * 360.0 - 180.0;
+	const auto lat = qRadiansToDegrees(std::atan(std::sinh(std::numbers::pi * (1.0 - 2.0 * mercator.y()))));
+	return { lat, lon };
+}
+
+ScreenProjection::ScreenProjection(const QGeoRectangle & viewport, int zoomLevel)
+	: m_worldSize(WorldSizeForZoom(zoomLevel))
+	, m_topLeft(ToMercator(viewport.topLeft()) * m_worldSize)
+{
+}
+
+QPointF ScreenProjection::ToScreen(const QPointF & mercator) const
+{
+	auto currentPoint = mercator * m_worldSize;
+	currentPoint.setX(AlignWrappedX(currentPoint.x(), m_topLeft.x(), m_worldSize));
+	return currentPoint - m_topLeft;
+}
+
+Item MakeItem(int id, const QPointF & mercator, const ScreenProjection & projection)
+{
+	const auto screenCoords = projection.ToScreen(mercator);
+	return {
+		.id = id,
+		.mercator = mercator,
+		.screenPos = screenCoords,
+		.cellX = static_cast<int>(std::floor(screenCoords.x() / CLUSTER_THRESHOLD_PIXELS)),
+		.cellY = static_cast<int>(std::floor(screenCoords.y() / CLUSTER_THRESHOLD_PIXELS)),
+	};
+}
+
+Item MakeItem(int id, const QGeoCoordinate & coord, const QGeoRectangle & viewport, int zoomLevel)
+{
+	return MakeItem(id, ToMercator(coord), ScreenProjection(viewport, zoomLevel));
+}
+
+std::vector<QPointF> ProjectArea(const QGeoPolygon & area, const ScreenProjection & projection)
+{
+	std::vector<QPointF> corners;
+	corners.reserve(area.size());
+	for (const auto & coordinate : area.perimeter())
+		corners.push_back(projection.ToScreen(ToMercator(coordinate)));
+	return corners;
+}
+
+bool AreaContains(const std::vector<QPointF> & area, const QPointF & screenPos)
+{
+	if (area.size() < 3)
+		return true;
+
+	// Inside a convex polygon the point is on the same side of every edge, whatever the winding
+	auto hasPositive = false;
+	auto hasNegative = false;
+	for (size_t i = 0; i < area.size(); ++i)
+	{
+		const auto & from = area[i];
+		const auto & to = area[(i + 1) % area.size()];
+		const auto cross = (to.x() - from.x()) * (screenPos.y() - from.y()) - (to.y() - from.y()) * (screenPos.x() - from.x());
+		hasPositive |= cross > 0;
+		hasNegative |= cross < 0;
+	}
+	return !(hasPositive && hasNegative);
+}
+
+std::vector<Cluster> BuildClusters(const std::vector<Item> & items)
+{
+	if (items.empty())
+		return {};
+
+	const auto gridMap = BuildGridMap(items);
+	std::vector<bool> visited(items.size(), false);
+	std::vector<Cluster> clusters;
+	clusters.reserve(items.size());
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (visited[i])
+			continue;
+
+		clusters.push_back(FindCluster(items, gridMap, visited, static_cast<int>(i)));
+	}
+
+	return clusters;
+}
+
+int Representative(const std::vector<Item> & items, const Cluster & cluster)
+{
+	assert(!cluster.members.empty());
+	QPointF middle;
+	for (const auto member : cluster.members)
+		middle += items[member].screenPos;
+	middle /= static_cast<double>(cluster.members.size());
+
+	return *std::ranges::min_element(cluster.members, {}, [&](int member) {
+		const auto offset = items[member].screenPos - middle;
+		return QPointF::dotProduct(offset, offset);
+	});
+}
+
+std::vector<int> ZoomsToDecluster(const std::vector<Item> & items, int currentZoom)
+{
+	const auto gridMap = BuildGridMap(items);
+
+	std::vector<int> zooms;
+	zooms.reserve(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		const auto dPx = FindNearestNeighborDistancePx(items, gridMap, static_cast<int>(i));
+		zooms.push_back(ZoomToDeclusterFromNearestPx(dPx, currentZoom));
+	}
+
+	return zooms;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <QGeoCoordinate>
+#include <QGeoPolygon>
+#include <QGeoRectangle>
+#include <QPointF>
+
+// Screen-space clustering shared by the cluster models. Callers project their items
+// once, then group them and compute declustering zooms on the same projection.
+namespace Clustering {
+
+constexpr auto CLUSTER_THRESHOLD_PIXELS = 20.0;
+
+// Web Mercator scaled to the unit square, x grows east from the antimeridian and y south.
+// Zoom independent, so items can be projected once and kept projected
+QPointF ToMercator(const QGeoCoordinate & coord);
+QGeoCoordinate FromMercator(const QPointF & mercator);
+
+// Places Mercator points on the screen of a viewport, the viewport itself is projected only once
+class ScreenProjection
+{
+public:
+	ScreenProjection(const QGeoRectangle & viewport, int zoomLevel);
+
+	QPointF ToScreen(const QPointF & mercator) const;
+
+private:
+	double m_worldSize;
+	QPointF m_topLeft;
+};
+
+struct Item
+{
+	// Opaque to the algorithm, lets callers find their item back
+	int id;
+	QPointF mercator;
+	QPointF screenPos;
+	int cellX;
+	int cellY;
+};
+
+struct Cluster
+{
+	// Indices into the items the clusters were built from, in item order
+	std::vector<int> members;
+	// Mean of the members in Mercator space, so it stays between them across the antimeridian
+	QGeoCoordinate centroid;
+};
+
+Item MakeItem(int id, const QPointF & mercator, const ScreenProjection & projection);
+Item MakeItem(int id, const QGeoCoordinate & coord, const QGeoRectangle & viewport, int zoomLevel);
+
+// Convex area projected the same way as items, so culling is a few cross products per item
+std::vector<QPointF> ProjectArea(const QGeoPolygon & area, const ScreenProjection & projection);
+
+// An empty area contains everything
+bool AreaContains(const std::vector<QPointF> & area, const QPointF & screenPos);
+
+// Items closer than CLUSTER_THRESHOLD_PIXELS end up in one cluster, transitively
+std::vector<Cluster> BuildClusters(const std::vector<Item> & items);
+
+// Index of the member closest to the middle of the cluster on screen, to stand for the whole cluster
+int Representative(const std::vector<Item> & items, const Cluster & cluster);
+
+// Per item, the zoom level at which it no longer clusters with its nearest neighbor
+std::vector<int> ZoomsToDecluster(const std::vector<Item> & items, int currentZoom);
+
+}
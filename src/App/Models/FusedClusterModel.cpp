@@ -0,0 +1,377 @@
+#include "FusedClusterModel.h"
+
+#include <QDate>
+#include <QGeoCoordinate>
+#include <QSettings>
+#include <QVariant>
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "App/Models/BaseModel.h"
+#include "App/Models/ClusterModel.h"
+#include "App/Models/ClusterSummary.h"
+#include "App/Models/Clustering.h"
+#include "App/Models/NearestObjectsModel.h"
+#include "App/Models/ScreenObjectsModel.h"
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/SettingsKeys.h"
+#include "App/Utils/Trace.h"
+
+namespace {
+
+struct Node
+{
+	// BaseModel rows, the first one stands for the whole cluster
+	std::vector<int> rows;
+	// The first row by cid, still found after BaseModel resets
+	ItemHandle first;
+	QGeoCoordinate centroid;
+	int zoomToDecluster;
+	// Clusters only
+	ClusterSummary summary;
+};
+
+}
+
+struct FusedClusterModel::Impl
+{
+	Impl(BaseModel * baseModel, QGeoPositionInfoSource * positionSource)
+		: baseModel(baseModel)
+		, positionSource(positionSource)
+	{
+	}
+
+	BaseModel * baseModel;
+	QGeoPositionInfoSource * positionSource;
+	QSettings settings;
+	Range timeline {
+		settings.value(SettingsKeys::YEARS_FROM, SettingsKeys::YEAR_FROM_VALUE).toInt(),
+		settings.value(SettingsKeys::YEARS_TO, QDate::currentDate().year()).toInt()
+	};
+	bool nearestObjectsOnly { settings.value(SettingsKeys::NEAREST_OBJECTS_ONLY).toBool() };
+	QGeoCoordinate filterCenter;
+	QGeoRectangle viewport;
+	// Items outside are culled, unset means no culling
+	QGeoPolygon visibleArea;
+
+	std::vector<QMetaObject::Connection> sourceConnections;
+	bool suspended { false };
+
+	std::vector<Node> nodes;
+	// BaseModel row -> node, -1 for filtered out rows
+	std::vector<int> nodeOfRow;
+
+	// Bumped on every BaseModel reset; rows of nodes built at an older one need checking
+	quint64 baseGeneration { 1 };
+	quint64 nodesGeneration { 0 };
+	// BaseModel row by cid, built on demand once per generation
+	mutable std::unordered_map<int, int> rowOfCid;
+	mutable quint64 rowOfCidGeneration { 0 };
+};
+
+FusedClusterModel::FusedClusterModel(BaseModel * baseModel, QGeoPositionInfoSource * positionSource, QObject * parent)
+	: QAbstractListModel(parent)
+	, m_impl(std::make_unique<Impl>(baseModel, positionSource))
+{
+	if (assert(baseModel); !baseModel)
+	{
+		LOG(ERROR) << "FusedClusterModel: baseModel is null";
+		return;
+	}
+
+	ConnectSources();
+
+	connect(this, &QAbstractItemModel::modelReset, this, [this] { emit CountChanged(); });
+
+	Rebuild();
+}
+
+FusedClusterModel::~FusedClusterModel() = default;
+
+int FusedClusterModel::rowCount(const QModelIndex & parent) const
+{
+	return parent.isValid() ? 0 : static_cast<int>(m_impl->nodes.size());
+}
+
+QVariant FusedClusterModel::data(const QModelIndex & index, int role) const
+{
+	if (!index.isValid() || index.row() < 0 || index.row() >= static_cast<int>(m_impl->nodes.size()))
+		return {};
+
+	const auto & node = m_impl->nodes[index.row()];
+	const auto isCluster = node.rows.size() > 1;
+	switch (role)
+	{
+		case ClusterModel::IsCluster:
+			return isCluster;
+		case ClusterModel::ClusterCount:
+			return static_cast<int>(node.rows.size());
+		case ClusterModel::CidsInCluster:
+			return isCluster ? QVariant(node.summary.cids) : QVariant();
+		case ClusterModel::ClusterYearFrom:
+			return isCluster ? QVariant(node.summary.yearFrom) : data(index, BaseModel::Year);
+		case ClusterModel::ClusterYearTo:
+			return isCluster ? QVariant(node.summary.yearTo) : data(index, BaseModel::Year);
+		case ClusterModel::ClusterThumbnail:
+			return isCluster ? QVariant(node.summary.thumbnail) : data(index, BaseModel::Thumbnail);
+		case ClusterModel::ClusterBearing:
+			return isCluster ? QVariant(node.summary.dominantBearing) : data(index, BaseModel::Bearing);
+		case ScreenObjectsModel::IsClustered:
+			return true;
+		case ScreenObjectsModel::ZoomToDecluster:
+			return node.zoomToDecluster;
+		case BaseModel::Coordinate:
+			return QVariant::fromValue(node.centroid);
+		default:
+			break;
+	}
+
+	// One direct call into storage, no proxy hops in between; nothing once the item left it
+	const auto row = BaseRow(node.first);
+	return row >= 0 ? m_impl->baseModel->data(m_impl->baseModel->index(row, 0), role) : QVariant();
+}
+
+QHash<int, QByteArray> FusedClusterModel::roleNames() const
+{
+	auto roles = m_impl->baseModel->roleNames();
+#define ROLENAME(CLASS, NAME) roles[CLASS::NAME] = #NAME
+	ROLENAME(ScreenObjectsModel, IsClustered);
+	ROLENAME(ScreenObjectsModel, ZoomToDecluster);
+	ROLENAME(ClusterModel, ClusterCount);
+	ROLENAME(ClusterModel, CidsInCluster);
+	ROLENAME(ClusterModel, IsCluster);
+	ROLENAME(ClusterModel, ClusterYearFrom);
+	ROLENAME(ClusterModel, ClusterYearTo);
+	ROLENAME(ClusterModel, ClusterThumbnail);
+	ROLENAME(ClusterModel, ClusterBearing);
+#undef ROLENAME
+	return roles;
+}
+
+void FusedClusterModel::SetSuspended(bool suspended)
+{
+	if (std::exchange(m_impl->suspended, suspended) == suspended)
+		return;
+
+	if (!suspended)
+	{
+		// Position updates were not followed while suspended
+		if (m_impl->positionSource && m_impl->positionSource->lastKnownPosition().isValid())
+			m_impl->filterCenter = m_impl->positionSource->lastKnownPosition().coordinate();
+
+		ConnectSources();
+		emit SourceChanged();
+		return;
+	}
+
+	for (const auto & connection : m_impl->sourceConnections)
+		disconnect(connection);
+	m_impl->sourceConnections.clear();
+
+	beginResetModel();
+	m_impl->nodes = {};
+	m_impl->nodeOfRow = {};
+	endResetModel();
+}
+
+void FusedClusterModel::SetVisibleArea(const QGeoPolygon & area)
+{
+	m_impl->visibleArea = area;
+}
+
+void FusedClusterModel::OnViewportChanged(const QGeoRectangle & viewport)
+{
+	m_impl->viewport = viewport;
+	Rebuild();
+}
+
+void FusedClusterModel::OnUserSelectedTimelineRangeChanged(const Range & timeline)
+{
+	m_impl->timeline = timeline;
+	emit SourceChanged();
+}
+
+void FusedClusterModel::SetNearestObjectsOnly(bool nearestObjectsOnly)
+{
+	if (std::exchange(m_impl->nearestObjectsOnly, nearestObjectsOnly) != nearestObjectsOnly)
+		emit SourceChanged();
+}
+
+void FusedClusterModel::OnPositionUpdated(const QGeoPositionInfo & info)
+{
+	const auto newPosition = info.coordinate();
+	if (!newPosition.isValid())
+		return;
+
+	if (m_impl->filterCenter.isValid() && m_impl->filterCenter.distanceTo(newPosition) < NearestObjectsModel::RECOMPUTE_DISTANCE_METERS)
+		return;
+
+	m_impl->filterCenter = newPosition;
+	if (m_impl->nearestObjectsOnly)
+		emit SourceChanged();
+}
+
+void FusedClusterModel::OnBaseModelReset()
+{
+	++m_impl->baseGeneration;
+	emit SourceChanged();
+}
+
+void FusedClusterModel::OnBaseModelDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles)
+{
+	if (!topLeft.isValid() || !bottomRight.isValid())
+		return;
+
+	if (m_impl->nodesGeneration == m_impl->baseGeneration)
+	{
+		for (auto row = topLeft.row(); row <= bottomRight.row() && row < static_cast<int>(m_impl->nodeOfRow.size()); ++row)
+		{
+			const auto node = m_impl->nodeOfRow[row];
+			if (node >= 0)
+				emit dataChanged(index(node), index(node), roles);
+		}
+		return;
+	}
+
+	// Rows moved since the nodes were built, only the items nodes read from are matched by cid
+	const auto & items = m_impl->baseModel->GetItems();
+	for (auto row = topLeft.row(); row <= bottomRight.row() && row < static_cast<int>(items.Size()); ++row)
+	{
+		const auto cid = items.At(row).cid;
+		for (int node = 0; node < static_cast<int>(m_impl->nodes.size()); ++node)
+		{
+			if (m_impl->nodes[node].first.cid == cid)
+				emit dataChanged(index(node), index(node), roles);
+		}
+	}
+}
+
+void FusedClusterModel::ConnectSources()
+{
+	m_impl->sourceConnections = {
+		connect(m_impl->baseModel, &QAbstractItemModel::modelReset, this, &FusedClusterModel::OnBaseModelReset),
+		connect(m_impl->baseModel, &QAbstractItemModel::dataChanged, this, &FusedClusterModel::OnBaseModelDataChanged),
+	};
+
+	if (m_impl->positionSource)
+		m_impl->sourceConnections.push_back(connect(m_impl->positionSource, &QGeoPositionInfoSource::positionUpdated, this, &FusedClusterModel::OnPositionUpdated));
+}
+
+void FusedClusterModel::Rebuild()
+{
+	TRACE_SCOPE("FusedClusterModel::Rebuild");
+	ALLOCATION_STAGE("FusedClusterModel::Rebuild");
+	if (m_impl->suspended)
+		return;
+
+	beginResetModel();
+	const auto cidToZoom = BuildNodes();
+	m_impl->nodesGeneration = m_impl->baseGeneration;
+	endResetModel();
+
+	emit ZoomsToDecluster(cidToZoom);
+}
+
+int FusedClusterModel::BaseRow(const ItemHandle & handle) const
+{
+	const auto & items = m_impl->baseModel->GetItems();
+	if (m_impl->nodesGeneration == m_impl->baseGeneration)
+		return handle.rowHint;
+
+	// Items surviving a reply usually keep their row
+	if (handle.rowHint >= 0 && handle.rowHint < static_cast<int>(items.Size()) && items.At(handle.rowHint).cid == handle.cid)
+		return handle.rowHint;
+
+	if (m_impl->rowOfCidGeneration != m_impl->baseGeneration)
+	{
+		m_impl->rowOfCid.clear();
+		for (int row = 0; row < static_cast<int>(items.Size()); ++row)
+			m_impl->rowOfCid.try_emplace(items.At(row).cid, row);
+		m_impl->rowOfCidGeneration = m_impl->baseGeneration;
+	}
+
+	const auto it = m_impl->rowOfCid.find(handle.cid);
+	return it != m_impl->rowOfCid.end() ? it->second : -1;
+}
+
+QHash<int, int> FusedClusterModel::BuildNodes()
+{
+	const auto & items = m_impl->baseModel->GetItems();
+	const auto itemCount = static_cast<int>(items.Size());
+	const auto & timeline = m_impl->timeline;
+	const auto & center = m_impl->filterCenter;
+
+	m_impl->nodes.clear();
+	m_impl->nodeOfRow.assign(itemCount, -1);
+
+	if (m_impl->nearestObjectsOnly && !center.isValid())
+		return {};
+
+	// Timeline and distance filters in the same pass, timeline ranges are (min, max] like in YearIndex.
+	// Every item within the circle is clustered, only the strip shows just the nearest ones
+	std::vector<int> accepted;
+	accepted.reserve(itemCount);
+	for (int row = 0; row < itemCount; ++row)
+	{
+		const auto & item = items.At(row);
+		if (item.year <= timeline.min || item.year > timeline.max)
+			continue;
+
+		if (m_impl->nearestObjectsOnly && (!item.coord.isValid() || NearestObjectsModel::DistanceMeters(center, item.coord) > NearestObjectsModel::MAX_DISTANCE_METERS))
+			continue;
+
+		accepted.push_back(row);
+	}
+
+	const auto zoomLevel = m_impl->baseModel->data({}, BaseModel::ZoomLevel).toInt();
+	const Clustering::ScreenProjection projection(m_impl->viewport, zoomLevel);
+	const auto screenArea = Clustering::ProjectArea(m_impl->visibleArea, projection);
+	std::vector<Clustering::Item> clusterItems;
+	clusterItems.reserve(accepted.size());
+	for (const auto row : accepted)
+	{
+		auto item = Clustering::MakeItem(row, items.At(row).mercator, projection);
+		if (Clustering::AreaContains(screenArea, item.screenPos))
+			clusterItems.push_back(std::move(item));
+	}
+
+	const auto zoomsToDecluster = Clustering::ZoomsToDecluster(clusterItems, zoomLevel);
+	QHash<int, int> cidToZoom;
+	cidToZoom.reserve(static_cast<qsizetype>(clusterItems.size()));
+	for (size_t i = 0; i < clusterItems.size(); ++i)
+		cidToZoom[items.At(clusterItems[i].id).cid] = zoomsToDecluster[i];
+
+	for (const auto & cluster : Clustering::BuildClusters(clusterItems))
+	{
+		// A single item sits on its own coordinate, not on one projected back and forth
+		const auto & first = clusterItems[cluster.members.front()];
+		Node node { .centroid = cluster.members.size() == 1 ? items.At(first.id).coord : cluster.centroid, .zoomToDecluster = zoomsToDecluster[cluster.members.front()] };
+		node.first = { .cid = items.At(first.id).cid, .rowHint = first.id };
+		node.rows.reserve(cluster.members.size());
+		for (const auto member : cluster.members)
+		{
+			const auto row = clusterItems[member].id;
+			node.rows.push_back(row);
+			m_impl->nodeOfRow[row] = static_cast<int>(m_impl->nodes.size());
+		}
+
+		if (node.rows.size() > 1)
+		{
+			ClusterSummaryBuilder summary(static_cast<qsizetype>(node.rows.size()));
+			for (const auto row : node.rows)
+				summary.Add(items.At(row).cid, items.At(row).year, items.At(row).bearing);
+
+			const auto representative = clusterItems[Clustering::Representative(clusterItems, cluster)].id;
+			node.summary = std::move(summary).Build(m_impl->baseModel->data(m_impl->baseModel->index(representative, 0), BaseModel::Thumbnail).toString());
+		}
+		m_impl->nodes.push_back(std::move(node));
+	}
+
+	return cidToZoom;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+
+#include <QAbstractListModel>
+#include <QGeoPolygon>
+#include <QGeoPositionInfoSource>
+#include <QGeoRectangle>
+#include <QVariant>
+
+#include "App/Utils/NonCopyMovable.h"
+#include "App/Utils/Range.h"
+
+class BaseModel;
+struct ItemHandle;
+
+// Timeline filter, nearest objects filter and clustering fused into one pass over
+// BaseModel's items. Serves the same roles as ClusterModel stacked on the proxy chain,
+// but reads items straight from storage and resets once per rebuild. Like ClusterModel it
+// leaves rebuilding to the owner: source and filter changes only emit SourceChanged
+class FusedClusterModel
+	: public QAbstractListModel
+{
+	Q_OBJECT
+
+public:
+	explicit FusedClusterModel(BaseModel * baseModel, QGeoPositionInfoSource * positionSource, QObject * parent = nullptr);
+	NON_COPY_MOVABLE(FusedClusterModel);
+
+	~FusedClusterModel();
+
+	Q_PROPERTY(int count READ rowCount NOTIFY CountChanged)
+
+signals:
+	void CountChanged();
+	// Same as ClusterModel's, for the raw list while the fused pipeline is shown
+	void ZoomsToDecluster(const QHash<int, int> & cidToZoom);
+	// Items or filters changed, nodes are stale until the next OnViewportChanged
+	void SourceChanged();
+
+public:
+	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+	// A suspended model is empty and only records its inputs; resuming emits SourceChanged to get rebuilt
+	void SetSuspended(bool suspended);
+
+	// Applied from the next OnViewportChanged on
+	void SetVisibleArea(const QGeoPolygon & area);
+
+public slots:
+	void OnViewportChanged(const QGeoRectangle & viewport);
+	void OnUserSelectedTimelineRangeChanged(const Range & timeline);
+	void SetNearestObjectsOnly(bool nearestObjectsOnly);
+
+private slots:
+	void OnPositionUpdated(const QGeoPositionInfo & info);
+	void OnBaseModelReset();
+	void OnBaseModelDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles);
+
+private:
+	void ConnectSources();
+	void Rebuild();
+	// Returns the zoom to decluster of every clustered item by cid
+	QHash<int, int> BuildNodes();
+	// BaseModel row of the item, -1 when it left the model
+	int BaseRow(const ItemHandle & handle) const;
+
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
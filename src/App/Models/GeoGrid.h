@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace GeoMath {
+
+// Mean Earth radius, same value QGeoCoordinate::distanceTo uses
+constexpr auto EARTH_RADIUS_METERS = 6371007.2;
+constexpr auto METERS_PER_DEGREE = EARTH_RADIUS_METERS * std::numbers::pi / 180.0;
+
+inline double WrapLonDelta(double deltaLon) noexcept
+{
+	if (deltaLon > 180.0)
+		return deltaLon - 360.0;
+	if (deltaLon < -180.0)
+		return deltaLon + 360.0;
+	return deltaLon;
+}
+
+// Flat-earth approximation: no trig per point except one cosine, accurate to well
+// below a meter at the few-kilometer scale we filter on
+inline double EquirectangularDistanceMeters(double lat1, double lon1, double lat2, double lon2) noexcept
+{
+	const auto meanLatRad = (lat1 + lat2) / 2.0 * std::numbers::pi / 180.0;
+	const auto x = WrapLonDelta(lon2 - lon1) * std::cos(meanLatRad);
+	const auto y = lat2 - lat1;
+	return std::sqrt(x * x + y * y) * METERS_PER_DEGREE;
+}
+
+} // namespace GeoMath
+
+// Uniform latitude/longitude grid over item rows for radius queries.
+// Cells are square in degrees; a query visits only the cells overlapping the
+// bounding box of the search circle, wrapping across the antimeridian.
+class GeoGrid
+{
+public:
+	struct Point
+	{
+		int row;
+		double lat;
+		double lon;
+	};
+
+	struct Neighbor
+	{
+		int row;
+		double distanceMeters;
+	};
+
+	explicit GeoGrid(double cellSizeMeters)
+		: m_lonCellCount(std::max(1, static_cast<int>(std::round(360.0 / (cellSizeMeters / GeoMath::METERS_PER_DEGREE)))))
+		, m_cellDegrees(360.0 / m_lonCellCount)
+		, m_latCellCount(static_cast<int>(std::ceil(180.0 / m_cellDegrees)))
+	{
+	}
+
+	void Clear()
+	{
+		m_cells.clear();
+		m_size = 0;
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+	void Insert(int row, double lat, double lon)
+	{
+		m_cells[Key(LatCell(lat), LonCell(lon))].push_back({ row, lat, lon });
+		++m_size;
+	}
+
+	// Rows from first on move down by count, like the rows after an insert into a list
+	void InsertRows(int first, int count)
+	{
+		for (auto & [key, points] : m_cells)
+		{
+			for (auto & point : points)
+			{
+				if (point.row >= first)
+					point.row += count;
+			}
+		}
+	}
+
+	// Drops the points of rows [first, last] and moves the rows after them up
+	void RemoveRows(int first, int last)
+	{
+		const auto count = last - first + 1;
+		for (auto it = m_cells.begin(); it != m_cells.end();)
+		{
+			auto & points = it->second;
+			m_size -= std::erase_if(points, [&](const Point & point) { return point.row >= first && point.row <= last; });
+			for (auto & point : points)
+			{
+				if (point.row > last)
+					point.row -= count;
+			}
+			it = points.empty() ? m_cells.erase(it) : std::next(it);
+		}
+	}
+
+	// Calls fn(const Point &) for every point in the cells overlapping the circle's bounding box.
+	// Candidates still have to be distance-checked by the caller
+	template <typename Fn>
+	void ForEachCandidate(double lat, double lon, double radiusMeters, Fn && fn) const
+	{
+		const auto radiusDegrees = radiusMeters / GeoMath::METERS_PER_DEGREE;
+		const auto firstLatCell = LatCell(lat - radiusDegrees);
+		const auto lastLatCell = LatCell(lat + radiusDegrees);
+
+		// Widest longitude span is at the pole-most edge of the box
+		const auto edgeLat = std::min(89.9, std::abs(lat) + radiusDegrees);
+		const auto lonRadiusDegrees = radiusDegrees / std::cos(edgeLat * std::numbers::pi / 180.0);
+		const auto firstLonCell = static_cast<int>(std::floor((lon - lonRadiusDegrees + 180.0) / m_cellDegrees));
+		const auto lastLonCell = static_cast<int>(std::floor((lon + lonRadiusDegrees + 180.0) / m_cellDegrees));
+		const auto lonCellSpan = std::min(lastLonCell - firstLonCell + 1, m_lonCellCount);
+
+		for (auto latCell = firstLatCell; latCell <= lastLatCell; ++latCell)
+		{
+			for (auto i = 0; i < lonCellSpan; ++i)
+			{
+				const auto it = m_cells.find(Key(latCell, WrapLonCell(firstLonCell + i)));
+				if (it == m_cells.end())
+					continue;
+
+				for (const auto & point : it->second)
+					fn(point);
+			}
+		}
+	}
+
+	// Up to k points within the radius, closest first; ties are ordered by row so results are stable
+	std::vector<Neighbor> Nearest(double lat, double lon, double radiusMeters, size_t k = std::numeric_limits<size_t>::max()) const
+	{
+		std::vector<Neighbor> neighbors;
+		ForEachCandidate(lat, lon, radiusMeters, [&](const Point & point) {
+			const auto distance = GeoMath::EquirectangularDistanceMeters(lat, lon, point.lat, point.lon);
+			if (distance <= radiusMeters)
+				neighbors.push_back({ point.row, distance });
+		});
+
+		const auto closer = [](const Neighbor & left, const Neighbor & right) {
+			return std::tie(left.distanceMeters, left.row) < std::tie(right.distanceMeters, right.row);
+		};
+		if (neighbors.size() > k)
+		{
+			std::ranges::nth_element(neighbors, neighbors.begin() + k, closer);
+			neighbors.resize(k);
+		}
+		std::ranges::sort(neighbors, closer);
+		return neighbors;
+	}
+
+private:
+	int LatCell(double lat) const
+	{
+		return std::clamp(static_cast<int>(std::floor((lat + 90.0) / m_cellDegrees)), 0, m_latCellCount - 1);
+	}
+
+	int LonCell(double lon) const
+	{
+		return WrapLonCell(static_cast<int>(std::floor((lon + 180.0) / m_cellDegrees)));
+	}
+
+	int WrapLonCell(int cell) const
+	{
+		const auto wrapped = cell % m_lonCellCount;
+		return wrapped < 0 ? wrapped + m_lonCellCount : wrapped;
+	}
+
+	int64_t Key(int latCell, int lonCell) const
+	{
+		return static_cast<int64_t>(latCell) * m_lonCellCount + lonCell;
+	}
+
+private:
+	int m_lonCellCount;
+	double m_cellDegrees;
+	int m_latCellCount;
+	std::unordered_map<int64_t, std::vector<Point>> m_cells;
+	size_t m_size { 0 };
+};
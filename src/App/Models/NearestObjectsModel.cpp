@@ -2,39 +2,52 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <QGeoCoordinate>
 #include <QGeoPositionInfoSource>
 #include <QMetaObject>
 #include <QModelIndex>
 #include <QVariant>
 
-#include <unordered_set>
+#include <tuple>
+#include <vector>
 
 #include "App/Models/BaseModel.h"
+#include "App/Models/GeoGrid.h"
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/Trace.h"
 
 #include "glog/logging.h"
 
 namespace {
-constexpr auto MAX_DISTANCE_METERS = 4000.0;
+constexpr auto NOT_NEAREST = std::numeric_limits<double>::infinity();
 }
 
 struct NearestObjectsModel::Impl
 {
-	explicit Impl(QGeoPositionInfoSource * positionSource)
+	Impl(QGeoPositionInfoSource * positionSource, size_t maxCount)
 		: positionSource(positionSource)
-		, currentPosition()
+		, maxCount(maxCount)
 	{
 	}
 
 	QGeoPositionInfoSource * positionSource;
-	QGeoCoordinate currentPosition;
+	size_t maxCount;
+	// Position the rows were selected and ordered for, lags the user by up to RECOMPUTE_DISTANCE_METERS
+	QGeoCoordinate filterCenter;
 
-	std::unordered_set<int> withinDistanceIndices;
+	// Per source row, so renumbering on source inserts/removes needs no QVariant round trips
+	std::vector<QGeoCoordinate> coordinates;
+	// Per source row, NOT_NEAREST for rows outside the circle or the maxCount nearest
+	std::vector<double> distances;
+	// Rows within the circle were left out for maxCount, removals may make room for them
+	bool truncated { false };
+	GeoGrid grid { MAX_DISTANCE_METERS };
 };
 
-NearestObjectsModel::NearestObjectsModel(QAbstractItemModel * sourceModel, QGeoPositionInfoSource * positionSource, QObject * parent)
-	: QSortFilterProxyModel(parent)
-	, m_impl(std::make_unique<Impl>(positionSource))
+NearestObjectsModel::NearestObjectsModel(QAbstractItemModel * sourceModel, QGeoPositionInfoSource * positionSource, size_t maxCount, QObject * parent)
+	: RowSubsetProxyModel(parent)
+	, m_impl(std::make_unique<Impl>(positionSource, maxCount))
 {
 	if (assert(sourceModel); !sourceModel)
 	{
@@ -43,86 +56,236 @@ NearestObjectsModel::NearestObjectsModel(QAbstractItemModel * sourceModel, QGeoP
 	}
 
 	setSourceModel(sourceModel);
-	setDynamicSortFilter(false);
-
-	connect(sourceModel, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &, const QModelIndex &, const QVector<int> & roles) {
-		const bool onlySelectedRole = !roles.isEmpty()
-								   && std::all_of(roles.cbegin(), roles.cend(), [](int role) {
-										return role == BaseModel::Roles::Selected;
-									});
-		if (!onlySelectedRole)
-			OnSourceModelChanged();
-	});
-	connect(sourceModel, &QAbstractListModel::rowsInserted, this, &NearestObjectsModel::OnSourceModelChanged);
-	connect(sourceModel, &QAbstractListModel::rowsRemoved, this, &NearestObjectsModel::OnSourceModelChanged);
-	connect(sourceModel, &QAbstractListModel::modelReset, this, &NearestObjectsModel::OnSourceModelChanged);
 
 	if (m_impl->positionSource)
 		connect(m_impl->positionSource, &QGeoPositionInfoSource::positionUpdated, this, &NearestObjectsModel::OnPositionUpdated);
 
-	connect(this, &QSortFilterProxyModel::rowsInserted, this, [this] { emit CountChanged(); });
-	connect(this, &QSortFilterProxyModel::rowsRemoved, this, [this] { emit CountChanged(); });
-	connect(this, &QSortFilterProxyModel::modelReset, this, [this] { emit CountChanged(); });
+	connect(this, &QAbstractItemModel::rowsInserted, this, [this] { emit CountChanged(); });
+	connect(this, &QAbstractItemModel::rowsRemoved, this, [this] { emit CountChanged(); });
+	connect(this, &QAbstractItemModel::modelReset, this, [this] { emit CountChanged(); });
 
-	OnSourceModelChanged();
+	ResetSourceRows();
 }
 
 NearestObjectsModel::~NearestObjectsModel() = default;
 
-bool NearestObjectsModel::filterAcceptsRow(int source_row, const QModelIndex & source_parent) const
+double NearestObjectsModel::DistanceMeters(const QGeoCoordinate & center, const QGeoCoordinate & coordinate)
 {
-	if (source_parent.isValid())
-		return false;
+	const auto distance = GeoMath::EquirectangularDistanceMeters(center.latitude(), center.longitude(), coordinate.latitude(), coordinate.longitude());
+	if (std::abs(distance - MAX_DISTANCE_METERS) <= BOUNDARY_TOLERANCE_METERS)
+		return center.distanceTo(coordinate);
+	return distance;
+}
+
+QVariant NearestObjectsModel::data(const QModelIndex & index, int role) const
+{
+	const auto sourceIndex = mapToSource(index);
+	if (role == Distance)
+		return sourceIndex.isValid() ? QVariant(m_impl->distances[sourceIndex.row()]) : QVariant();
 
-	return m_impl->withinDistanceIndices.find(source_row) != m_impl->withinDistanceIndices.cend();
+	return sourceModel()->data(sourceIndex, role);
+}
+
+QHash<int, QByteArray> NearestObjectsModel::roleNames() const
+{
+	auto roles = sourceModel()->roleNames();
+#define ROLENAME(NAME) roles[NAME] = #NAME
+	ROLENAME(Distance);
+#undef ROLENAME
+	return roles;
 }
 
 void NearestObjectsModel::OnPositionUpdated(const QGeoPositionInfo & info)
 {
 	const auto newPosition = info.coordinate();
-	if (newPosition.isValid() && newPosition != m_impl->currentPosition)
+	if (!newPosition.isValid())
+		return;
+
+	if (m_impl->filterCenter.isValid() && m_impl->filterCenter.distanceTo(newPosition) < RECOMPUTE_DISTANCE_METERS)
+		return;
+
+	// Caches are stale while suspended, resuming re-selects everything around the latest center
+	if (IsSuspended())
 	{
-		m_impl->currentPosition = newPosition;
-		OnSourceModelChanged();
+		m_impl->filterCenter = newPosition;
+		return;
 	}
+
+	MoveFilterCenter(newPosition);
 }
 
-void NearestObjectsModel::OnSourceModelChanged()
+void NearestObjectsModel::MoveFilterCenter(const QGeoCoordinate & center)
 {
-	RebuildProxyModel();
+	TRACE_SCOPE("NearestObjectsModel::MoveFilterCenter");
+	ALLOCATION_STAGE("NearestObjectsModel::MoveFilterCenter");
+	m_impl->filterCenter = center;
+	UpdateDistances();
+
+	// Leaving rows go first so the reorder only moves rows that stay
+	RemoveSourceRows(LeavingRows());
+	ReorderSourceRows();
+	InsertSourceRows(EnteringRows());
 }
 
-void NearestObjectsModel::RebuildProxyModel()
+std::vector<int> NearestObjectsModel::SelectSourceRows()
 {
-	UpdateAcceptedRows();
-	invalidateFilter();
+	ReloadCoordinates();
+	UpdateSpatialIndex();
+	UpdateDistances();
+	return NearestRows();
 }
 
-void NearestObjectsModel::UpdateAcceptedRows()
+std::vector<int> NearestObjectsModel::SelectInsertedSourceRows(int first, int last)
 {
-	m_impl->withinDistanceIndices.clear();
+	TRACE_SCOPE("NearestObjectsModel::SelectInsertedSourceRows");
+	auto & impl = *m_impl;
+	const auto count = last - first + 1;
+	impl.coordinates.insert(impl.coordinates.begin() + first, count, {});
+	impl.distances.insert(impl.distances.begin() + first, count, NOT_NEAREST);
+	impl.grid.InsertRows(first, count);
 
-	if (!m_impl->currentPosition.isValid())
-		return;
+	// Only the inserted rows are measured, the others keep their distances
+	std::vector<int> entering;
+	for (int row = first; row <= last; ++row)
+	{
+		const auto coord = sourceModel()->data(sourceModel()->index(row, 0), BaseModel::Roles::Coordinate).value<QGeoCoordinate>();
+		impl.coordinates[row] = coord;
+		if (!coord.isValid())
+			continue;
+
+		impl.grid.Insert(row, coord.latitude(), coord.longitude());
+		if (const auto distance = impl.filterCenter.isValid() ? DistanceMeters(impl.filterCenter, coord) : NOT_NEAREST; distance <= MAX_DISTANCE_METERS)
+		{
+			impl.distances[row] = distance;
+			entering.push_back(row);
+		}
+	}
+	std::ranges::sort(entering, [this](int left, int right) { return SourceRowLessThan(left, right); });
+
+	// Closer newcomers push the farthest rows out of the maxCount nearest, both lists are nearest first
+	const auto rows = SourceRows();
+	auto kept = rows.size();
+	auto taken = entering.size();
+	std::vector<int> leaving;
+	while (kept + taken > impl.maxCount)
+	{
+		impl.truncated = true;
+		if (taken > 0 && (kept == 0 || SourceRowLessThan(rows[kept - 1], entering[taken - 1])))
+		{
+			impl.distances[entering[--taken]] = NOT_NEAREST;
+			continue;
+		}
+		impl.distances[rows[--kept]] = NOT_NEAREST;
+		leaving.push_back(rows[kept]);
+	}
+	entering.resize(taken);
+
+	RemoveSourceRows(leaving);
+	return entering;
+}
+
+void NearestObjectsModel::UpdateAfterSourceRowsRemoved(int first, int last)
+{
+	TRACE_SCOPE("NearestObjectsModel::UpdateAfterSourceRowsRemoved");
+	auto & impl = *m_impl;
+	impl.coordinates.erase(impl.coordinates.begin() + first, impl.coordinates.begin() + last + 1);
+	impl.distances.erase(impl.distances.begin() + first, impl.distances.begin() + last + 1);
+	impl.grid.RemoveRows(first, last);
+
+	// Rows that were beyond the maxCount nearest may move up into the freed places
+	if (impl.truncated && SourceRows().size() < impl.maxCount)
+	{
+		UpdateDistances();
+		InsertSourceRows(EnteringRows());
+	}
+}
+
+bool NearestObjectsModel::SourceRowLessThan(int left, int right) const
+{
+	return std::tie(m_impl->distances[left], left) < std::tie(m_impl->distances[right], right);
+}
+
+void NearestObjectsModel::ReloadCoordinates()
+{
+	m_impl->coordinates.clear();
 
 	const auto * sourceModel = this->sourceModel();
-	if (!sourceModel || sourceModel->rowCount() == 0)
+	if (!sourceModel)
 		return;
 
 	const auto sourceRowCount = sourceModel->rowCount();
-
+	m_impl->coordinates.reserve(sourceRowCount);
 	for (int i = 0; i < sourceRowCount; ++i)
+		m_impl->coordinates.push_back(sourceModel->data(sourceModel->index(i, 0), BaseModel::Roles::Coordinate).value<QGeoCoordinate>());
+}
+
+void NearestObjectsModel::UpdateSpatialIndex()
+{
+	m_impl->grid.Clear();
+
+	for (int i = 0; i < static_cast<int>(m_impl->coordinates.size()); ++i)
 	{
-		const auto sourceIndex = sourceModel->index(i, 0);
-		const auto coord = sourceModel->data(sourceIndex, BaseModel::Roles::Coordinate).value<QGeoCoordinate>();
+		const auto & coord = m_impl->coordinates[i];
 		if (coord.isValid())
+			m_impl->grid.Insert(i, coord.latitude(), coord.longitude());
+	}
+}
+
+void NearestObjectsModel::UpdateDistances()
+{
+	m_impl->distances.assign(m_impl->coordinates.size(), NOT_NEAREST);
+
+	const auto & center = m_impl->filterCenter;
+	if (!center.isValid())
+		return;
+
+	// Candidates just outside the circle by the estimate may be inside by distanceTo
+	auto count = size_t { 0 };
+	m_impl->truncated = false;
+	for (const auto & [row, estimate] : m_impl->grid.Nearest(center.latitude(), center.longitude(), MAX_DISTANCE_METERS + BOUNDARY_TOLERANCE_METERS))
+	{
+		if (count == m_impl->maxCount)
 		{
-			const auto distance = m_impl->currentPosition.distanceTo(coord);
-			if (!std::isfinite(distance))
-				continue;
+			m_impl->truncated = true;
+			break;
+		}
 
-			if (distance <= MAX_DISTANCE_METERS)
-				m_impl->withinDistanceIndices.insert(i);
+		const auto distance = estimate < MAX_DISTANCE_METERS - BOUNDARY_TOLERANCE_METERS ? estimate : center.distanceTo(m_impl->coordinates[row]);
+		if (distance <= MAX_DISTANCE_METERS)
+		{
+			m_impl->distances[row] = distance;
+			++count;
 		}
 	}
 }
+
+std::vector<int> NearestObjectsModel::NearestRows() const
+{
+	std::vector<int> rows;
+	for (int i = 0; i < static_cast<int>(m_impl->distances.size()); ++i)
+	{
+		if (m_impl->distances[i] != NOT_NEAREST)
+			rows.push_back(i);
+	}
+
+	std::ranges::sort(rows, [this](int left, int right) { return SourceRowLessThan(left, right); });
+	return rows;
+}
+
+std::vector<int> NearestObjectsModel::EnteringRows() const
+{
+	auto rows = NearestRows();
+	std::erase_if(rows, [this](int sourceRow) { return ContainsSourceRow(sourceRow); });
+	return rows;
+}
+
+std::vector<int> NearestObjectsModel::LeavingRows() const
+{
+	std::vector<int> rows;
+	for (const auto sourceRow : SourceRows())
+	{
+		if (m_impl->distances[sourceRow] == NOT_NEAREST)
+			rows.push_back(sourceRow);
+	}
+	return rows;
+}
@@ -2,42 +2,75 @@
 
 #include <QGeoCoordinate>
 #include <QGeoPositionInfoSource>
-#include <QSortFilterProxyModel>
 #include <QVariant>
-#include <QtCore/qabstractitemmodel.h>
 
-#include "App/Utils/NonCopyMovable.h"
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
 
-class ScreenObjectsModel;
+#include "App/Models/RowSubsetProxyModel.h"
+#include "App/Models/ScreenObjectsModel.h"
+#include "App/Utils/NonCopyMovable.h"
 
-// Keep this proxy unsorted: sorting on top of another proxy model has caused
-// recursive create_mapping/sort_source_rows stack overflows in production.
+// The source rows closest to the user, nearest first, optionally only the maxCount
+// nearest. The circle only follows the user once they have moved far enough to matter,
+// and then only rows whose state or position changed are inserted/removed/moved, so
+// GPS jitter never reaches the views.
 class NearestObjectsModel
-	: public QSortFilterProxyModel
+	: public RowSubsetProxyModel
 {
 	Q_OBJECT
 
 public:
-	explicit NearestObjectsModel(QAbstractItemModel * sourceModel, QGeoPositionInfoSource * positionSource, QObject * parent = nullptr);
+	explicit NearestObjectsModel(QAbstractItemModel * sourceModel, QGeoPositionInfoSource * positionSource, size_t maxCount = std::numeric_limits<size_t>::max(), QObject * parent = nullptr);
 	NON_COPY_MOVABLE(NearestObjectsModel);
 
 	~NearestObjectsModel();
 
 	Q_PROPERTY(int count READ rowCount NOTIFY CountChanged)
 
+	static constexpr auto MAX_DISTANCE_METERS = 4000.0;
+	// The equirectangular estimate is only trusted away from the circle's edge
+	static constexpr auto BOUNDARY_TOLERANCE_METERS = MAX_DISTANCE_METERS * 0.01;
+	// Enough to fill the "History near you" strip many times over
+	static constexpr auto MAX_NEAREST_OBJECTS = 200;
+	// Moves shorter than this keep the current circle, well above GPS jitter
+	static constexpr auto RECOMPUTE_DISTANCE_METERS = MAX_DISTANCE_METERS * 0.025;
+
+	enum Roles
+	{
+		// Meters, measured from the position the list was last ordered for
+		Distance = ScreenObjectsModel::Roles::LastRole,
+	};
+
+	// Equirectangular near the center, QGeoCoordinate::distanceTo close to MAX_DISTANCE_METERS
+	static double DistanceMeters(const QGeoCoordinate & center, const QGeoCoordinate & coordinate);
+
 signals:
 	void CountChanged();
 
+public:
+	QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
 protected:
-	bool filterAcceptsRow(int source_row, const QModelIndex & source_parent) const override;
+	std::vector<int> SelectSourceRows() override;
+	std::vector<int> SelectInsertedSourceRows(int first, int last) override;
+	void UpdateAfterSourceRowsRemoved(int first, int last) override;
+	bool SourceRowLessThan(int left, int right) const override;
 
 private slots:
 	void OnPositionUpdated(const QGeoPositionInfo & info);
-	void OnSourceModelChanged();
-	void RebuildProxyModel();
 
 private:
-	void UpdateAcceptedRows();
+	void MoveFilterCenter(const QGeoCoordinate & center);
+	void ReloadCoordinates();
+	void UpdateSpatialIndex();
+	void UpdateDistances();
+	std::vector<int> NearestRows() const;
+	std::vector<int> EnteringRows() const;
+	std::vector<int> LeavingRows() const;
 
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
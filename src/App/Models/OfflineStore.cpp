@@ -0,0 +1,199 @@
+#include "OfflineStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+#include "glog/logging.h"
+
+namespace {
+
+// Until something is stored, roughly a tile of a European city centre
+constexpr auto DEFAULT_TILE_BYTES = 8 * 1024;
+
+QString FileName(const TileGrid::Tile & tile)
+{
+	return QString("%1_%2_%3.json").arg(tile.zoom).arg(tile.x).arg(tile.y);
+}
+
+std::optional<TileGrid::Tile> TileOfFile(const QString & fileName)
+{
+	const auto parts = QFileInfo(fileName).completeBaseName().split('_');
+	if (parts.size() != 3)
+		return std::nullopt;
+
+	auto valid = true;
+	const auto part = [&](int index) {
+		auto ok = false;
+		const auto value = parts[index].toInt(&ok);
+		valid &= ok;
+		return value;
+	};
+	const TileGrid::Tile tile { part(0), part(1), part(2) };
+	return valid && tile.zoom == OfflineStore::TILE_ZOOM ? std::optional(tile) : std::nullopt;
+}
+
+}
+
+struct OfflineStore::Impl
+{
+	explicit Impl(const QString & directory)
+		: dir(directory)
+	{
+		if (!dir.mkpath("."))
+			LOG(WARNING) << "Failed to create offline store at " << directory.toStdString();
+
+		for (const auto & file : dir.entryInfoList({ "*.json" }, QDir::Files))
+		{
+			if (const auto tile = TileOfFile(file.fileName()))
+			{
+				tileBytes[*tile] = file.size();
+				totalBytes += file.size();
+			}
+		}
+	}
+
+	std::optional<std::vector<QString>> FilesOf(const std::vector<TileGrid::Tile> & tiles) const
+	{
+		if (!std::ranges::all_of(tiles, [this](const TileGrid::Tile & tile) { return tileBytes.contains(tile); }))
+			return std::nullopt;
+
+		std::vector<QString> files;
+		files.reserve(tiles.size());
+		for (const auto & tile : tiles)
+			files.push_back(dir.filePath(FileName(tile)));
+		return files;
+	}
+
+	QDir dir;
+	std::map<TileGrid::Tile, qint64> tileBytes;
+	qint64 totalBytes { 0 };
+};
+
+OfflineStore::OfflineStore(const QString & directory)
+	: m_impl(std::make_unique<Impl>(directory))
+{
+}
+
+OfflineStore::~OfflineStore() = default;
+
+std::vector<TileGrid::Tile> OfflineStore::TilesCovering(const QGeoRectangle & region)
+{
+	return TileGrid::TilesCovering(region.topLeft().latitude(), region.topLeft().longitude(), region.bottomRight().latitude(), region.bottomRight().longitude(), TILE_ZOOM);
+}
+
+qint64 OfflineStore::CountTilesCovering(const QGeoRectangle & region)
+{
+	return TileGrid::CountCovering(region.topLeft().latitude(), region.topLeft().longitude(), region.bottomRight().latitude(), region.bottomRight().longitude(), TILE_ZOOM);
+}
+
+bool OfflineStore::Contains(const TileGrid::Tile & tile) const
+{
+	return m_impl->tileBytes.contains(tile);
+}
+
+std::optional<std::vector<QString>> OfflineStore::Files(const QGeoRectangle & area) const
+{
+	if (m_impl->tileBytes.empty() || !area.isValid() || CountTilesCovering(area) > MAX_AREA_TILES)
+		return std::nullopt;
+
+	return m_impl->FilesOf(TilesCovering(area));
+}
+
+std::optional<std::vector<QString>> OfflineStore::Files(const TileGrid::Tile & tile) const
+{
+	if (m_impl->tileBytes.empty())
+		return std::nullopt;
+
+	// A finer tile lies within a single stored one
+	if (tile.zoom >= TILE_ZOOM)
+	{
+		const auto shift = tile.zoom - TILE_ZOOM;
+		return m_impl->FilesOf({ { TILE_ZOOM, tile.x >> shift, tile.y >> shift } });
+	}
+
+	const auto span = 1 << (TILE_ZOOM - tile.zoom);
+	if (static_cast<qint64>(span) * span > MAX_AREA_TILES)
+		return std::nullopt;
+
+	std::vector<TileGrid::Tile> tiles;
+	tiles.reserve(static_cast<size_t>(span) * span);
+	for (auto y = tile.y * span; y < (tile.y + 1) * span; ++y)
+		for (auto x = tile.x * span; x < (tile.x + 1) * span; ++x)
+			tiles.push_back({ TILE_ZOOM, x, y });
+	return m_impl->FilesOf(tiles);
+}
+
+std::optional<QJsonArray> OfflineStore::ReadPhotos(const std::vector<QString> & files)
+{
+	QJsonArray photos;
+	for (const auto & fileName : files)
+	{
+		QFile file(fileName);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			LOG(WARNING) << "Failed to read offline tile " << fileName.toStdString();
+			return std::nullopt;
+		}
+
+		const auto document = QJsonDocument::fromJson(file.readAll());
+		if (!document.isArray())
+			return std::nullopt;
+		for (const auto & photo : document.array())
+			photos.append(photo);
+	}
+	return photos;
+}
+
+bool OfflineStore::Store(const TileGrid::Tile & tile, const QJsonArray & photos)
+{
+	assert(tile.zoom == TILE_ZOOM);
+
+	QSaveFile file(m_impl->dir.filePath(FileName(tile)));
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		LOG(WARNING) << "Failed to write offline tile " << file.fileName().toStdString();
+		return false;
+	}
+
+	const auto data = QJsonDocument(photos).toJson(QJsonDocument::Compact);
+	if (file.write(data) != data.size() || !file.commit())
+	{
+		LOG(WARNING) << "Failed to write offline tile " << file.fileName().toStdString();
+		return false;
+	}
+
+	auto & bytes = m_impl->tileBytes[tile];
+	m_impl->totalBytes += data.size() - bytes;
+	bytes = data.size();
+	return true;
+}
+
+void OfflineStore::Clear()
+{
+	for (const auto & [tile, bytes] : m_impl->tileBytes)
+		m_impl->dir.remove(FileName(tile));
+	m_impl->tileBytes.clear();
+	m_impl->totalBytes = 0;
+}
+
+qsizetype OfflineStore::TileCount() const
+{
+	return static_cast<qsizetype>(m_impl->tileBytes.size());
+}
+
+qint64 OfflineStore::SizeBytes() const
+{
+	return m_impl->totalBytes;
+}
+
+qint64 OfflineStore::AverageTileBytes() const
+{
+	return m_impl->tileBytes.empty() ? DEFAULT_TILE_BYTES : m_impl->totalBytes / static_cast<qint64>(m_impl->tileBytes.size());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <QGeoRectangle>
+#include <QJsonArray>
+#include <QString>
+
+#include "App/Models/TileGrid.h"
+#include "App/Utils/NonCopyMovable.h"
+
+// Photo metadata of downloaded regions, one file per tile of TILE_ZOOM. Tiles of any
+// zoom the model requests are answered from the stored tiles covering them
+class OfflineStore
+{
+public:
+	// A tile is about a kilometre across in mid latitudes, a city takes a few hundred
+	static constexpr auto TILE_ZOOM = 14;
+	// About a phone screen at the farthest zoom the map loads items at; larger areas are left to the network
+	static constexpr auto MAX_AREA_TILES = 1024;
+
+	explicit OfflineStore(const QString & directory);
+	~OfflineStore();
+	NON_COPY_MOVABLE(OfflineStore);
+
+	// Tiles of TILE_ZOOM covering the region, west > east crosses the antimeridian
+	static std::vector<TileGrid::Tile> TilesCovering(const QGeoRectangle & region);
+	static qint64 CountTilesCovering(const QGeoRectangle & region);
+
+	// Of TILE_ZOOM
+	bool Contains(const TileGrid::Tile & tile) const;
+	// Files of the stored tiles covering the area or the tile of any zoom, nullopt unless every one of them is stored
+	std::optional<std::vector<QString>> Files(const QGeoRectangle & area) const;
+	std::optional<std::vector<QString>> Files(const TileGrid::Tile & tile) const;
+	// Photos of the files, nullopt if one cannot be read. Touches no store, so it runs on any thread
+	static std::optional<QJsonArray> ReadPhotos(const std::vector<QString> & files);
+	// Replaces what a tile of TILE_ZOOM had, a write cut short leaves the previous file
+	bool Store(const TileGrid::Tile & tile, const QJsonArray & photos);
+	void Clear();
+
+	qsizetype TileCount() const;
+	qint64 SizeBytes() const;
+	// Of the stored tiles, a guess while nothing is stored yet
+	qint64 AverageTileBytes() const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
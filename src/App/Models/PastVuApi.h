@@ -0,0 +1,62 @@
+#pragma once
+
+#include <optional>
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include "App/Models/TileGrid.h"
+
+// Requests and responses of the PastVu API, shared by the live model and the offline downloader
+namespace PastVuApi {
+
+constexpr auto API_URL = "https://pastvu.com/api2";
+
+inline QString TileParams(const TileGrid::Tile & tile)
+{
+	// Fixed precision keeps the URL of a tile byte-identical between requests
+	const auto point = [](double lon, double lat) { return QString("[%1,%2]").arg(QString::number(lon, 'f', 6), QString::number(lat, 'f', 6)); };
+	const auto bounds = TileGrid::TileBounds(tile);
+
+	// Counter-clockwise and closed, as GeoJSON wants it
+	const QStringList ring {
+		point(bounds.west, bounds.north),
+		point(bounds.west, bounds.south),
+		point(bounds.east, bounds.south),
+		point(bounds.east, bounds.north),
+		point(bounds.west, bounds.north),
+	};
+	return QString(R"({"z":17,"geometry":{"type":"Polygon","coordinates":[[%1]]},"localWork":1})").arg(ring.join(','));
+}
+
+// photo.getByBounds for the photos within the tile
+inline QUrl TileUrl(QUrl apiUrl, const TileGrid::Tile & tile)
+{
+	QUrlQuery query;
+	query.addQueryItem("method", "photo.getByBounds");
+	query.addQueryItem("params", TileParams(tile));
+	apiUrl.setQuery(query);
+	return apiUrl;
+}
+
+// Photos of a photo.getByBounds response, nullopt with the parser's message if it is not JSON
+inline std::optional<QJsonArray> ParsePhotos(const QByteArray & response, QString & error)
+{
+	QJsonParseError parserError;
+	const auto jsonDoc = QJsonDocument::fromJson(response, &parserError);
+	if (parserError.error != QJsonParseError::NoError)
+	{
+		error = parserError.errorString();
+		return std::nullopt;
+	}
+
+	return jsonDoc.object().value("result").toObject().value("photos").toArray();
+}
+
+} // namespace PastVuApi
@@ -0,0 +1,365 @@
+#include "RowSubsetProxyModel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+#include "App/Utils/AllocationTracker.h"
+#include "App/Utils/Trace.h"
+
+struct RowSubsetProxyModel::Impl
+{
+	int ProxyRowOf(int sourceRow) const
+	{
+		RenumberStaleRows();
+		return proxyRowOfSource[sourceRow];
+	}
+
+	void RenumberStaleRows() const
+	{
+		for (auto row = staleFrom; row < static_cast<int>(sourceRows.size()); ++row)
+		{
+			assert(sourceRows[row] >= 0 && sourceRows[row] < static_cast<int>(proxyRowOfSource.size()));
+			proxyRowOfSource[sourceRows[row]] = row;
+		}
+		staleFrom = std::numeric_limits<int>::max();
+	}
+
+	// proxy row -> source row
+	std::vector<int> sourceRows;
+	// source row -> proxy row, -1 for rows outside the subset. Whether a row is in the subset is
+	// always current, the proxy rows shifted by a batch of runs are renumbered once on the next lookup
+	mutable std::vector<int> proxyRowOfSource;
+	mutable int staleFrom { std::numeric_limits<int>::max() };
+	std::vector<QMetaObject::Connection> sourceConnections;
+	bool suspended { false };
+};
+
+RowSubsetProxyModel::RowSubsetProxyModel(QObject * parent)
+	: QAbstractProxyModel(parent)
+	, m_impl(std::make_unique<Impl>())
+{
+}
+
+RowSubsetProxyModel::~RowSubsetProxyModel() = default;
+
+QModelIndex RowSubsetProxyModel::index(int row, int column, const QModelIndex & parent) const
+{
+	if (parent.isValid() || column != 0 || row < 0 || row >= static_cast<int>(m_impl->sourceRows.size()))
+		return {};
+
+	return createIndex(row, column);
+}
+
+QModelIndex RowSubsetProxyModel::parent(const QModelIndex & child) const
+{
+	return {};
+}
+
+int RowSubsetProxyModel::rowCount(const QModelIndex & parent) const
+{
+	return parent.isValid() ? 0 : static_cast<int>(m_impl->sourceRows.size());
+}
+
+int RowSubsetProxyModel::columnCount(const QModelIndex & parent) const
+{
+	return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex RowSubsetProxyModel::mapToSource(const QModelIndex & proxyIndex) const
+{
+	if (!sourceModel() || !proxyIndex.isValid() || proxyIndex.row() >= static_cast<int>(m_impl->sourceRows.size()))
+		return {};
+
+	return sourceModel()->index(m_impl->sourceRows[proxyIndex.row()], proxyIndex.column());
+}
+
+QModelIndex RowSubsetProxyModel::mapFromSource(const QModelIndex & sourceIndex) const
+{
+	if (!sourceIndex.isValid() || sourceIndex.row() >= static_cast<int>(m_impl->proxyRowOfSource.size()))
+		return {};
+
+	const auto proxyRow = m_impl->ProxyRowOf(sourceIndex.row());
+	return proxyRow < 0 ? QModelIndex() : index(proxyRow, sourceIndex.column());
+}
+
+void RowSubsetProxyModel::setSourceModel(QAbstractItemModel * newSourceModel)
+{
+	beginResetModel();
+
+	DisconnectSource();
+	QAbstractProxyModel::setSourceModel(newSourceModel);
+	m_impl->sourceRows.clear();
+	m_impl->proxyRowOfSource.clear();
+	if (!m_impl->suspended)
+		ConnectSource();
+
+	endResetModel();
+}
+
+void RowSubsetProxyModel::SetSuspended(bool suspended)
+{
+	if (std::exchange(m_impl->suspended, suspended) == suspended)
+		return;
+
+	if (!suspended)
+	{
+		ConnectSource();
+		ResetSourceRows();
+		return;
+	}
+
+	beginResetModel();
+	DisconnectSource();
+	m_impl->sourceRows = {};
+	m_impl->proxyRowOfSource = {};
+	endResetModel();
+}
+
+bool RowSubsetProxyModel::IsSuspended() const
+{
+	return m_impl->suspended;
+}
+
+void RowSubsetProxyModel::UpdateAfterSourceRowsRemoved(int first, int last)
+{
+}
+
+bool RowSubsetProxyModel::SourceRowLessThan(int left, int right) const
+{
+	return left < right;
+}
+
+void RowSubsetProxyModel::ResetSourceRows()
+{
+	beginResetModel();
+	OnSourceReset();
+}
+
+void RowSubsetProxyModel::RemoveSourceRows(std::span<const int> sourceRows)
+{
+	std::vector<int> proxyRows;
+	proxyRows.reserve(sourceRows.size());
+	for (const auto sourceRow : sourceRows)
+	{
+		if (ContainsSourceRow(sourceRow))
+			proxyRows.push_back(m_impl->ProxyRowOf(sourceRow));
+	}
+
+	if (proxyRows.empty())
+		return;
+
+	// Remove from the back so positions of the runs that are still pending stay valid
+	std::ranges::sort(proxyRows, std::greater {});
+	proxyRows.erase(std::unique(proxyRows.begin(), proxyRows.end()), proxyRows.end());
+	for (size_t runEnd = 0; runEnd < proxyRows.size();)
+	{
+		auto runStart = runEnd;
+		while (runStart + 1 < proxyRows.size() && proxyRows[runStart + 1] == proxyRows[runStart] - 1)
+			++runStart;
+
+		const auto first = proxyRows[runStart];
+		const auto last = proxyRows[runEnd];
+
+		beginRemoveRows({}, first, last);
+		for (auto row = first; row <= last; ++row)
+			m_impl->proxyRowOfSource[m_impl->sourceRows[row]] = -1;
+		m_impl->sourceRows.erase(m_impl->sourceRows.begin() + first, m_impl->sourceRows.begin() + last + 1);
+		InvalidateProxyRowsFrom(first);
+		endRemoveRows();
+
+		runEnd = runStart + 1;
+	}
+}
+
+void RowSubsetProxyModel::InsertSourceRows(std::span<const int> sourceRows)
+{
+	const auto less = [this](int left, int right) { return SourceRowLessThan(left, right); };
+	auto & rows = m_impl->sourceRows;
+	for (size_t runStart = 0; runStart < sourceRows.size();)
+	{
+		if (ContainsSourceRow(sourceRows[runStart]))
+		{
+			++runStart;
+			continue;
+		}
+
+		const auto position = static_cast<int>(std::ranges::lower_bound(rows, sourceRows[runStart], less) - rows.begin());
+
+		// Entering rows that fall before the same existing row form one contiguous proxy run
+		auto runEnd = runStart + 1;
+		while (runEnd < sourceRows.size()
+			   && !ContainsSourceRow(sourceRows[runEnd])
+			   && (position == static_cast<int>(rows.size()) || less(sourceRows[runEnd], rows[position])))
+			++runEnd;
+
+		const auto count = static_cast<int>(runEnd - runStart);
+		beginInsertRows({}, position, position + count - 1);
+		rows.insert(rows.begin() + position, sourceRows.begin() + runStart, sourceRows.begin() + runEnd);
+		for (auto row = position; row < position + count; ++row)
+			m_impl->proxyRowOfSource[rows[row]] = row;
+		InvalidateProxyRowsFrom(position + count);
+		endInsertRows();
+
+		runStart = runEnd;
+	}
+}
+
+void RowSubsetProxyModel::ReorderSourceRows()
+{
+	auto & rows = m_impl->sourceRows;
+	auto orderedRows = rows;
+	std::ranges::stable_sort(orderedRows, [this](int left, int right) { return SourceRowLessThan(left, right); });
+
+	for (int proxyRow = 0; proxyRow < static_cast<int>(rows.size()); ++proxyRow)
+	{
+		if (rows[proxyRow] == orderedRows[proxyRow])
+			continue;
+
+		// Rows before proxyRow are already in place, so the wanted row is always further down
+		const auto from = m_impl->ProxyRowOf(orderedRows[proxyRow]);
+		assert(from > proxyRow);
+
+		beginMoveRows({}, from, from, {}, proxyRow);
+		std::rotate(rows.begin() + proxyRow, rows.begin() + from, rows.begin() + from + 1);
+		// Only the rotated rows changed places
+		for (auto row = proxyRow; row <= from; ++row)
+			m_impl->proxyRowOfSource[rows[row]] = row;
+		endMoveRows();
+	}
+}
+
+bool RowSubsetProxyModel::ContainsSourceRow(int sourceRow) const
+{
+	return sourceRow >= 0
+		&& sourceRow < static_cast<int>(m_impl->proxyRowOfSource.size())
+		&& m_impl->proxyRowOfSource[sourceRow] >= 0;
+}
+
+std::span<const int> RowSubsetProxyModel::SourceRows() const
+{
+	return m_impl->sourceRows;
+}
+
+void RowSubsetProxyModel::OnSourceAboutToBeReset()
+{
+	beginResetModel();
+}
+
+void RowSubsetProxyModel::OnSourceReset()
+{
+	TRACE_SCOPE("RowSubsetProxyModel::OnSourceReset");
+	ALLOCATION_STAGE("RowSubsetProxyModel::OnSourceReset");
+	m_impl->sourceRows = SelectSourceRows();
+	m_impl->proxyRowOfSource.assign(sourceModel() ? sourceModel()->rowCount() : 0, -1);
+	InvalidateProxyRowsFrom(0);
+	m_impl->RenumberStaleRows();
+	endResetModel();
+}
+
+void RowSubsetProxyModel::OnSourceRowsInserted(const QModelIndex & parent, int first, int last)
+{
+	TRACE_SCOPE("RowSubsetProxyModel::OnSourceRowsInserted");
+	ALLOCATION_STAGE("RowSubsetProxyModel::OnSourceRowsInserted");
+	if (parent.isValid())
+		return;
+
+	const auto count = last - first + 1;
+	for (auto & sourceRow : m_impl->sourceRows)
+	{
+		if (sourceRow >= first)
+			sourceRow += count;
+	}
+	m_impl->proxyRowOfSource.insert(m_impl->proxyRowOfSource.begin() + first, count, -1);
+
+	InsertSourceRows(SelectInsertedSourceRows(first, last));
+}
+
+void RowSubsetProxyModel::OnSourceRowsAboutToBeRemoved(const QModelIndex & parent, int first, int last)
+{
+	if (parent.isValid())
+		return;
+
+	std::vector<int> leavingRows;
+	for (auto sourceRow = first; sourceRow <= last; ++sourceRow)
+	{
+		if (ContainsSourceRow(sourceRow))
+			leavingRows.push_back(sourceRow);
+	}
+
+	RemoveSourceRows(leavingRows);
+}
+
+void RowSubsetProxyModel::OnSourceRowsRemoved(const QModelIndex & parent, int first, int last)
+{
+	if (parent.isValid())
+		return;
+
+	const auto count = last - first + 1;
+	for (auto & sourceRow : m_impl->sourceRows)
+	{
+		assert(sourceRow < first || sourceRow > last);
+		if (sourceRow > last)
+			sourceRow -= count;
+	}
+	m_impl->proxyRowOfSource.erase(m_impl->proxyRowOfSource.begin() + first, m_impl->proxyRowOfSource.begin() + last + 1);
+
+	UpdateAfterSourceRowsRemoved(first, last);
+}
+
+void RowSubsetProxyModel::OnSourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles)
+{
+	if (!topLeft.isValid() || !bottomRight.isValid())
+		return;
+
+	std::vector<int> proxyRows;
+	for (auto sourceRow = topLeft.row(); sourceRow <= bottomRight.row(); ++sourceRow)
+	{
+		if (ContainsSourceRow(sourceRow))
+			proxyRows.push_back(m_impl->ProxyRowOf(sourceRow));
+	}
+	std::ranges::sort(proxyRows);
+
+	// One signal per run of proxy rows, the subset may order the rows differently
+	for (size_t first = 0; first < proxyRows.size();)
+	{
+		auto last = first;
+		while (last + 1 < proxyRows.size() && proxyRows[last + 1] == proxyRows[last] + 1)
+			++last;
+		emit dataChanged(index(proxyRows[first], 0), index(proxyRows[last], 0), roles);
+		first = last + 1;
+	}
+}
+
+void RowSubsetProxyModel::ConnectSource()
+{
+	auto * source = sourceModel();
+	if (!source)
+		return;
+
+	m_impl->sourceConnections = {
+		connect(source, &QAbstractItemModel::modelAboutToBeReset, this, &RowSubsetProxyModel::OnSourceAboutToBeReset),
+		connect(source, &QAbstractItemModel::modelReset, this, &RowSubsetProxyModel::OnSourceReset),
+		connect(source, &QAbstractItemModel::rowsInserted, this, &RowSubsetProxyModel::OnSourceRowsInserted),
+		connect(source, &QAbstractItemModel::rowsAboutToBeRemoved, this, &RowSubsetProxyModel::OnSourceRowsAboutToBeRemoved),
+		connect(source, &QAbstractItemModel::rowsRemoved, this, &RowSubsetProxyModel::OnSourceRowsRemoved),
+		connect(source, &QAbstractItemModel::layoutAboutToBeChanged, this, &RowSubsetProxyModel::OnSourceAboutToBeReset),
+		connect(source, &QAbstractItemModel::layoutChanged, this, &RowSubsetProxyModel::OnSourceReset),
+		connect(source, &QAbstractItemModel::dataChanged, this, &RowSubsetProxyModel::OnSourceDataChanged),
+	};
+}
+
+void RowSubsetProxyModel::DisconnectSource()
+{
+	for (const auto & connection : m_impl->sourceConnections)
+		disconnect(connection);
+	m_impl->sourceConnections.clear();
+}
+
+void RowSubsetProxyModel::InvalidateProxyRowsFrom(int proxyRow)
+{
+	m_impl->staleFrom = std::min(m_impl->staleFrom, proxyRow);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <QAbstractProxyModel>
+
+#include "App/Utils/NonCopyMovable.h"
+
+// Flat list proxy exposing a subset of source rows chosen and ordered by the subclass.
+// Unlike QSortFilterProxyModel it never re-evaluates the whole source on its own:
+// subclasses report the rows that enter or leave the subset and only those rows
+// are announced to views as inserts/removes. Source row inserts/removes are
+// passed through the same way; only source resets reset the proxy.
+class RowSubsetProxyModel
+	: public QAbstractProxyModel
+{
+	Q_OBJECT
+
+public:
+	explicit RowSubsetProxyModel(QObject * parent = nullptr);
+	NON_COPY_MOVABLE(RowSubsetProxyModel);
+
+	~RowSubsetProxyModel();
+
+public:
+	QModelIndex index(int row, int column, const QModelIndex & parent = QModelIndex()) const override;
+	QModelIndex parent(const QModelIndex & child) const override;
+	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+	QModelIndex mapToSource(const QModelIndex & proxyIndex) const override;
+	QModelIndex mapFromSource(const QModelIndex & sourceIndex) const override;
+	void setSourceModel(QAbstractItemModel * sourceModel) override;
+
+	// A suspended proxy is empty and ignores its source until resumed, then re-selects the subset
+	void SetSuspended(bool suspended);
+	bool IsSuspended() const;
+
+protected:
+	// Called inside a model reset whenever the source is reset or re-laid out
+	virtual std::vector<int> SelectSourceRows() = 0;
+
+	// Called once source rows [first, last] are inserted and the subset is renumbered.
+	// Returns the new rows entering the subset, ordered by SourceRowLessThan
+	virtual std::vector<int> SelectInsertedSourceRows(int first, int last) = 0;
+
+	// Called once source rows [first, last] are removed from both the source and the subset
+	virtual void UpdateAfterSourceRowsRemoved(int first, int last);
+
+	// Order of the subset, used to place entering rows
+	virtual bool SourceRowLessThan(int left, int right) const;
+
+	// Re-selects the whole subset, views get a model reset
+	void ResetSourceRows();
+
+	// Removes rows that left the subset, announcing each contiguous proxy run
+	void RemoveSourceRows(std::span<const int> sourceRows);
+
+	// Inserts rows that entered the subset, sourceRows have to be ordered by SourceRowLessThan
+	void InsertSourceRows(std::span<const int> sourceRows);
+
+	// Restores SourceRowLessThan order after it changed, moving only the displaced rows
+	void ReorderSourceRows();
+
+	bool ContainsSourceRow(int sourceRow) const;
+	std::span<const int> SourceRows() const;
+
+private slots:
+	void OnSourceAboutToBeReset();
+	void OnSourceReset();
+	void OnSourceRowsInserted(const QModelIndex & parent, int first, int last);
+	void OnSourceRowsAboutToBeRemoved(const QModelIndex & parent, int first, int last);
+	void OnSourceRowsRemoved(const QModelIndex & parent, int first, int last);
+	void OnSourceDataChanged(const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles);
+
+private:
+	void ConnectSource();
+	void DisconnectSource();
+	// Proxy rows from proxyRow on shifted, their mapping is renumbered on the next lookup
+	void InvalidateProxyRowsFrom(int proxyRow);
+
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
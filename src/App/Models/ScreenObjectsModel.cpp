@@ -14,27 +14,33 @@
 #include <QVariant>
 #include <QMetaObject>
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "glog/logging.h"
 
 #include "App/Models/BaseModel.h"
+#include "App/Models/YearIndex.h"
+#include "App/Utils/AllocationTracker.h"
 #include "App/Utils/Range.h"
+#include "App/Utils/SettingsKeys.h"
 
 struct ScreenObjectsModel::Impl
 {
-	std::unordered_set<int> belongsToTimeline;
+	YearIndex yearIndex;
 	QHash<int, int> cidToZoomToDecluster;
 	QSettings settings;
 	Range timeline {
-		settings.value("YEARS_FROM", 1800).toInt(),
-		settings.value("YEARS_TO", QDate::currentDate().year()).toInt()
+		settings.value(SettingsKeys::YEARS_FROM, SettingsKeys::YEAR_FROM_VALUE).toInt(),
+		settings.value(SettingsKeys::YEARS_TO, QDate::currentDate().year()).toInt()
 	};
 };
 
 ScreenObjectsModel::ScreenObjectsModel(QAbstractListModel * sourceModel, QObject * parent)
-	: QSortFilterProxyModel(parent)
+	: RowSubsetProxyModel(parent)
 	, m_impl(std::make_unique<Impl>())
 {
 	if (assert(sourceModel); !sourceModel)
@@ -45,28 +51,35 @@ ScreenObjectsModel::ScreenObjectsModel(QAbstractListModel * sourceModel, QObject
 
 	setSourceModel(sourceModel);
 
-	connect(sourceModel, &QAbstractListModel::rowsInserted, this, &ScreenObjectsModel::OnSourceModelChanged);
-	connect(sourceModel, &QAbstractListModel::rowsRemoved, this, &ScreenObjectsModel::OnSourceModelChanged);
-	connect(sourceModel, &QAbstractListModel::modelReset, this, &ScreenObjectsModel::OnSourceModelChanged);
+	connect(this, &QAbstractItemModel::rowsInserted, this, [this] { emit CountChanged(); });
+	connect(this, &QAbstractItemModel::rowsRemoved, this, [this] { emit CountChanged(); });
+	connect(this, &QAbstractItemModel::modelReset, this, [this] { emit CountChanged(); });
 
-	connect(this, &QSortFilterProxyModel::rowsInserted, this, [this] { emit CountChanged(); });
-	connect(this, &QSortFilterProxyModel::rowsRemoved, this, [this] { emit CountChanged(); });
-	connect(this, &QSortFilterProxyModel::modelReset, this, [this] { emit CountChanged(); });
-
-	OnSourceModelChanged();
+	ResetSourceRows();
 }
 
 ScreenObjectsModel::~ScreenObjectsModel() = default;
 
 void ScreenObjectsModel::OnUserSelectedTimelineRangeChanged(const Range & timeline)
 {
-	m_impl->timeline = timeline;
-	OnSourceModelChanged();
+	ALLOCATION_STAGE("ScreenObjectsModel::OnUserSelectedTimelineRangeChanged");
+	const auto previous = std::exchange(m_impl->timeline, timeline);
+
+	// Only rows in the difference of the two ranges can change state while dragging the slider
+	const auto leavingRows = m_impl->yearIndex.RowsInRangeExcept(previous.min, previous.max, timeline.min, timeline.max);
+	const auto enteringRows = m_impl->yearIndex.RowsInRangeExcept(timeline.min, timeline.max, previous.min, previous.max);
+
+	RemoveSourceRows(leavingRows);
+	InsertSourceRows(enteringRows);
 }
 
 void ScreenObjectsModel::UpdateZoomsToDecluster(const QHash<int, int> & cidsToZooms)
 {
-	m_impl->cidToZoomToDecluster = cidsToZooms;
+	if (std::exchange(m_impl->cidToZoomToDecluster, cidsToZooms) == cidsToZooms || rowCount() == 0)
+		return;
+
+	// One signal for all rows, finding the rows that changed costs more than views rereading two roles
+	emit dataChanged(index(0, 0), index(rowCount() - 1, 0), { IsClustered, ZoomToDecluster });
 }
 
 QVariant ScreenObjectsModel::data(const QModelIndex & index, int role) const
@@ -101,32 +114,48 @@ QHash<int, QByteArray> ScreenObjectsModel::roleNames() const
 	return roles;
 }
 
-bool ScreenObjectsModel::filterAcceptsRow(int source_row, const QModelIndex & source_parent) const
+void ScreenObjectsModel::OnPositionUpdated(const QGeoPositionInfo & info)
 {
-	if (source_parent.isValid())
-		return false;
-
-	return m_impl->belongsToTimeline.find(source_row) != m_impl->belongsToTimeline.cend();
 }
 
-void ScreenObjectsModel::OnPositionUpdated(const QGeoPositionInfo & info)
+std::vector<int> ScreenObjectsModel::SelectSourceRows()
 {
+	UpdateYearIndex();
+
+	std::vector<bool> belongsToTimeline;
+	m_impl->yearIndex.FillRowMask(m_impl->timeline.min, m_impl->timeline.max, belongsToTimeline);
+
+	std::vector<int> rows;
+	for (int i = 0; i < static_cast<int>(belongsToTimeline.size()); ++i)
+	{
+		if (belongsToTimeline[i])
+			rows.push_back(i);
+	}
+	return rows;
 }
 
-void ScreenObjectsModel::OnSourceModelChanged()
+std::vector<int> ScreenObjectsModel::SelectInsertedSourceRows(int first, int last)
 {
-	RebuildProxyModel();
+	UpdateYearIndex();
+
+	std::vector<int> rows;
+	for (const auto & entry : m_impl->yearIndex.InRange(m_impl->timeline.min, m_impl->timeline.max))
+	{
+		if (entry.row >= first && entry.row <= last)
+			rows.push_back(entry.row);
+	}
+	std::ranges::sort(rows);
+	return rows;
 }
 
-void ScreenObjectsModel::RebuildProxyModel()
+void ScreenObjectsModel::UpdateAfterSourceRowsRemoved(int, int)
 {
-	UpdateAcceptedRows();
-	invalidateFilter();
+	UpdateYearIndex();
 }
 
-void ScreenObjectsModel::UpdateAcceptedRows()
+void ScreenObjectsModel::UpdateYearIndex()
 {
-	m_impl->belongsToTimeline.clear();
+	m_impl->yearIndex.Clear();
 
 	const auto * sourceModel = this->sourceModel();
 	if (!sourceModel || sourceModel->rowCount() == 0)
@@ -134,12 +163,13 @@ void ScreenObjectsModel::UpdateAcceptedRows()
 
 	const auto sourceRowCount = sourceModel->rowCount();
 
+	std::vector<YearIndex::Entry> entries;
+	entries.reserve(sourceRowCount);
 	for (int i = 0; i < sourceRowCount; ++i)
 	{
 		const auto sourceIndex = sourceModel->index(i, 0);
-		const auto year = sourceModel->data(sourceIndex, BaseModel::Roles::Year).toInt();
-
-		if (year > m_impl->timeline.min && year <= m_impl->timeline.max)
-			m_impl->belongsToTimeline.insert(i);
+		entries.push_back({ sourceModel->data(sourceIndex, BaseModel::Roles::Year).toInt(), i });
 	}
+
+	m_impl->yearIndex.Rebuild(std::move(entries));
 }
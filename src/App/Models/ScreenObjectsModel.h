@@ -4,12 +4,13 @@
 #include <QGeoCoordinate>
 #include <QGeoPositionInfoSource>
 #include <QGeoRectangle>
-#include <QSortFilterProxyModel>
 #include <QVariant>
 
 #include <memory>
+#include <vector>
 
 #include "App/Models/BaseModel.h"
+#include "App/Models/RowSubsetProxyModel.h"
 #include "App/Utils/NonCopyMovable.h"
 #include "App/Utils/Range.h"
 
@@ -17,7 +18,7 @@ class QNetworkAccessManager;
 class QNetworkReply;
 
 class ScreenObjectsModel
-	: public QSortFilterProxyModel
+	: public RowSubsetProxyModel
 {
 	Q_OBJECT
 
@@ -49,15 +50,15 @@ public:
 	QHash<int, QByteArray> roleNames() const override;
 
 protected:
-	bool filterAcceptsRow(int source_row, const QModelIndex & source_parent) const override;
+	std::vector<int> SelectSourceRows() override;
+	std::vector<int> SelectInsertedSourceRows(int first, int last) override;
+	void UpdateAfterSourceRowsRemoved(int first, int last) override;
 
 private slots:
 	void OnPositionUpdated(const QGeoPositionInfo & info);
-	void OnSourceModelChanged();
-	void RebuildProxyModel();
 
 private:
-	void UpdateAcceptedRows();
+	void UpdateYearIndex();
 
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
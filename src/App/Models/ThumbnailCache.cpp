@@ -0,0 +1,239 @@
+#include "ThumbnailCache.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QImageReader>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "App/Utils/LruCache.h"
+#include "App/Utils/Trace.h"
+
+namespace {
+
+// Shared with the pool threads decoding into it, which may outlive the cache
+struct Memory
+{
+	std::optional<QImage> Find(const QString & key)
+	{
+		const std::lock_guard lock(mutex);
+		const auto * image = images.Find(key);
+		return image ? std::optional(*image) : std::nullopt;
+	}
+
+	bool Contains(const QString & key) const
+	{
+		const std::lock_guard lock(mutex);
+		return images.Contains(key);
+	}
+
+	void Insert(const QString & key, const QImage & image)
+	{
+		const std::lock_guard lock(mutex);
+		images.Insert(key, image, static_cast<size_t>(image.sizeInBytes()));
+	}
+
+	qint64 Bytes() const
+	{
+		const std::lock_guard lock(mutex);
+		return static_cast<qint64>(images.Cost());
+	}
+
+	mutable std::mutex mutex;
+	LruCache<QString, QImage> images { ThumbnailCache::MAX_MEMORY_BYTES };
+};
+
+QString FileName(const QString & key)
+{
+	return QString::fromLatin1(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+// Also marks the file as used, so the order survives restarts
+QByteArray ReadFile(const QString & path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		LOG(WARNING) << "Failed to read thumbnail " << path.toStdString();
+		return {};
+	}
+	file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+	return file.readAll();
+}
+
+void Decode(const std::shared_ptr<Memory> & memory, const QString & key, std::function<QByteArray()> read, std::vector<ThumbnailCache::Callback> callbacks)
+{
+	QThreadPool::globalInstance()->start([memory, key, read = std::move(read), callbacks = std::move(callbacks)] {
+		TRACE_SCOPE("ThumbnailCache::Decode");
+		const auto image = QImage::fromData(read());
+		if (!image.isNull())
+			memory->Insert(key, image);
+		for (const auto & callback : callbacks)
+			callback(image);
+	});
+}
+
+}
+
+struct ThumbnailCache::Impl
+{
+	Impl(const QString & directory, std::unique_ptr<QNetworkAccessManager> networkManager)
+		: dir(directory)
+		, networkManager(std::move(networkManager))
+	{
+		if (!dir.mkpath("."))
+			LOG(WARNING) << "Failed to create thumbnail cache at " << directory.toStdString();
+
+		// Oldest first, so the most recently used end up the last to be evicted
+		for (const auto & file : dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed))
+			for (const auto & evicted : files.Insert(file.fileName(), file.size(), static_cast<size_t>(file.size())))
+				dir.remove(evicted);
+	}
+
+	QDir dir;
+	std::unique_ptr<QNetworkAccessManager> networkManager;
+	std::shared_ptr<Memory> memory { std::make_shared<Memory>() };
+	// File name to its size
+	LruCache<QString, qint64> files { MAX_DISK_BYTES };
+	// Callbacks waiting for a download or a read by URL, none for prefetches
+	std::unordered_map<QString, std::vector<Callback>> waiting;
+};
+
+ThumbnailCache::ThumbnailCache(const QString & directory, std::unique_ptr<QNetworkAccessManager> networkManager, QObject * parent)
+	: QObject(parent)
+	, m_impl(std::make_unique<Impl>(directory, std::move(networkManager)))
+{
+	connect(m_impl->networkManager.get(), &QNetworkAccessManager::finished, this, &ThumbnailCache::OnNetworkReplyFinished);
+}
+
+ThumbnailCache::~ThumbnailCache() = default;
+
+void ThumbnailCache::Request(const QUrl & url, Callback callback)
+{
+	if (const auto image = m_impl->memory->Find(url.toString()))
+	{
+		QThreadPool::globalInstance()->start([callback = std::move(callback), image = *image] { callback(image); });
+		return;
+	}
+
+	if (!url.isValid() || url.isRelative())
+	{
+		QThreadPool::globalInstance()->start([callback = std::move(callback)] { callback({}); });
+		return;
+	}
+
+	// Downloads and the disk index belong to the thread of the cache
+	QMetaObject::invokeMethod(this, [this, url, callback = std::move(callback)]() mutable { Fetch(url, std::move(callback)); }, Qt::QueuedConnection);
+}
+
+void ThumbnailCache::Prefetch(QAbstractItemModel * model, int first, int last)
+{
+	if (!model || first < 0 || last < first)
+		return;
+
+	const auto role = model->roleNames().key("Thumbnail", -1);
+	if (role < 0)
+		return;
+
+	const auto end = std::min(model->rowCount(), last + PREFETCH_AHEAD + 1);
+	for (auto row = std::max(0, first - PREFETCH_AHEAD); row < end; ++row)
+	{
+		const QUrl url(model->data(model->index(row, 0), role).toString());
+		if (url.isValid() && !url.isRelative() && !m_impl->memory->Contains(url.toString()))
+			Fetch(url, {});
+	}
+}
+
+qint64 ThumbnailCache::MemoryBytes() const
+{
+	return m_impl->memory->Bytes();
+}
+
+qint64 ThumbnailCache::DiskBytes() const
+{
+	return static_cast<qint64>(m_impl->files.Cost());
+}
+
+void ThumbnailCache::Fetch(const QUrl & url, Callback callback)
+{
+	const auto key = url.toString();
+
+	// Decoded by a prefetch in the meantime
+	if (const auto image = m_impl->memory->Find(key))
+	{
+		if (callback)
+			QThreadPool::globalInstance()->start([callback = std::move(callback), image = *image] { callback(image); });
+		return;
+	}
+
+	const auto [it, isFirst] = m_impl->waiting.try_emplace(key);
+	if (callback)
+		it->second.push_back(std::move(callback));
+	if (!isFirst)
+		return;
+
+	const auto fileName = FileName(key);
+	if (m_impl->files.Find(fileName))
+	{
+		auto callbacks = std::move(it->second);
+		m_impl->waiting.erase(it);
+		Decode(m_impl->memory, key, [path = m_impl->dir.filePath(fileName)] { return ReadFile(path); }, std::move(callbacks));
+		return;
+	}
+
+	QNetworkRequest request(url);
+	request.setPriority(it->second.empty() ? QNetworkRequest::LowPriority : QNetworkRequest::NormalPriority);
+	auto * reply = m_impl->networkManager->get(request);
+	Trace::AsyncBegin("Thumbnail", reinterpret_cast<std::uintptr_t>(reply));
+}
+
+void ThumbnailCache::OnNetworkReplyFinished(QNetworkReply * reply)
+{
+	reply->deleteLater();
+	Trace::AsyncEnd("Thumbnail", reinterpret_cast<std::uintptr_t>(reply));
+
+	const auto key = reply->request().url().toString();
+	auto node = m_impl->waiting.extract(key);
+	if (node.empty())
+		return;
+
+	QByteArray data;
+	if (reply->error())
+		LOG(INFO) << "Thumbnail error: " << reply->errorString().toStdString();
+	else
+		data = reply->readAll();
+
+	// An error page answered with success is not kept
+	QBuffer buffer(&data);
+	if (QImageReader(&buffer).canRead())
+		Store(FileName(key), data);
+
+	Decode(m_impl->memory, key, [data] { return data; }, std::move(node.mapped()));
+}
+
+void ThumbnailCache::Store(const QString & fileName, const QByteArray & data)
+{
+	QSaveFile file(m_impl->dir.filePath(fileName));
+	if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+	{
+		LOG(WARNING) << "Failed to write thumbnail " << file.fileName().toStdString();
+		return;
+	}
+
+	for (const auto & evicted : m_impl->files.Insert(fileName, data.size(), static_cast<size_t>(data.size())))
+		m_impl->dir.remove(evicted);
+}
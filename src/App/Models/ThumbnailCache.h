@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <QAbstractItemModel>
+#include <QImage>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+
+class QNetworkReply;
+
+// Thumbnails decoded in memory and their downloaded files on disk, each bounded in
+// bytes with the least recently used dropped first. Concurrent requests of a
+// thumbnail share one download, decoding runs on the global thread pool
+class ThumbnailCache
+	: public QObject
+{
+	Q_OBJECT
+
+public:
+	// A couple of hundred strip thumbnails decoded
+	static constexpr qint64 MAX_MEMORY_BYTES = 32 * 1024 * 1024;
+	// Several thousand files, a few visits of a city
+	static constexpr qint64 MAX_DISK_BYTES = 64 * 1024 * 1024;
+	// Rows loaded ahead of each end of the rows shown, about two strip widths
+	static constexpr auto PREFETCH_AHEAD = 8;
+
+	// Given a null image on failure; called on a pool thread
+	using Callback = std::function<void(const QImage & image)>;
+
+	ThumbnailCache(const QString & directory, std::unique_ptr<QNetworkAccessManager> networkManager, QObject * parent = nullptr);
+	~ThumbnailCache();
+
+	// Callable from any thread
+	void Request(const QUrl & url, Callback callback);
+	// Loads thumbnails of the Thumbnail role around the shown rows into memory
+	Q_INVOKABLE void Prefetch(QAbstractItemModel * model, int first, int last);
+
+	qint64 MemoryBytes() const;
+	qint64 DiskBytes() const;
+
+private slots:
+	void OnNetworkReplyFinished(QNetworkReply * reply);
+
+private:
+	void Fetch(const QUrl & url, Callback callback);
+	void Store(const QString & fileName, const QByteArray & data);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <compare>
+#include <numbers>
+#include <vector>
+
+// Slippy map (XYZ) tiles used as the canonical unit of API requests: the same
+// tile always yields the same bounds and so the same request URL, whatever
+// viewport asked for it.
+namespace TileGrid {
+
+// Web Mercator stops short of the poles
+constexpr auto MAX_LATITUDE = 85.0511287798066;
+
+struct Tile
+{
+	int zoom;
+	int x;
+	int y;
+
+	auto operator<=>(const Tile &) const = default;
+};
+
+struct Bounds
+{
+	double north;
+	double west;
+	double south;
+	double east;
+};
+
+inline int TileCount(int zoom) noexcept
+{
+	return 1 << zoom;
+}
+
+inline Tile TileAt(double lat, double lon, int zoom) noexcept
+{
+	const auto count = TileCount(zoom);
+	const auto latRad = std::clamp(lat, -MAX_LATITUDE, MAX_LATITUDE) * std::numbers::pi / 180.0;
+	const auto x = static_cast<int>(std::floor((lon + 180.0) / 360.0 * count));
+	const auto y = static_cast<int>(std::floor((1.0 - std::asinh(std::tan(latRad)) / std::numbers::pi) / 2.0 * count));
+	return { zoom, ((x % count) + count) % count, std::clamp(y, 0, count - 1) };
+}
+
+inline Bounds TileBounds(const Tile & tile) noexcept
+{
+	const auto count = TileCount(tile.zoom);
+	const auto lonAt = [count](int x) { return x * 360.0 / count - 180.0; };
+	const auto latAt = [count](int y) { return std::atan(std::sinh(std::numbers::pi * (1.0 - 2.0 * y / count))) * 180.0 / std::numbers::pi; };
+	return { latAt(tile.y), lonAt(tile.x), latAt(tile.y + 1), lonAt(tile.x + 1) };
+}
+
+// How many tiles TilesCovering returns, without listing them
+inline long long CountCovering(double north, double west, double south, double east, int zoom) noexcept
+{
+	const auto count = TileCount(zoom);
+	const auto northWest = TileAt(north, west, zoom);
+	const auto southEast = TileAt(south, east, zoom);
+	return static_cast<long long>((southEast.x - northWest.x + count) % count + 1) * (southEast.y - northWest.y + 1);
+}
+
+// Tiles covering the box, row by row from the north-west; west > east means the box crosses the antimeridian
+inline std::vector<Tile> TilesCovering(double north, double west, double south, double east, int zoom)
+{
+	const auto count = TileCount(zoom);
+	const auto northWest = TileAt(north, west, zoom);
+	const auto southEast = TileAt(south, east, zoom);
+	const auto columns = (southEast.x - northWest.x + count) % count + 1;
+
+	std::vector<Tile> tiles;
+	tiles.reserve(static_cast<size_t>(columns) * (southEast.y - northWest.y + 1));
+	for (int y = northWest.y; y <= southEast.y; ++y)
+		for (int column = 0; column < columns; ++column)
+			tiles.push_back({ zoom, (northWest.x + column) % count, y });
+	return tiles;
+}
+
+} // namespace TileGrid
@@ -47,11 +47,13 @@ public:
 		if (m_keys.contains(id))
 			return;
 
-		m_data[m_head++ % CAPACITY] = item;
+		if (m_size == CAPACITY)
+			(void)Pop();
+
+		m_data[m_head % CAPACITY] = item;
+		++m_head;
 		m_keys.insert(id);
 		++m_size;
-		if (m_size > CAPACITY)
-			(void)Pop();
 	}
 
 	void Push(T && item)
@@ -88,6 +90,11 @@ public:
 		return res;
 	}
 
+	bool Contains(const ID & id) const
+	{
+		return m_keys.contains(id);
+	}
+
 	bool IsFull() const
 	{
 		return m_size == CAPACITY;
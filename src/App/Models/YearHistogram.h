@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cassert>
+#include <map>
+#include <vector>
+
+// Item counts per year, maintained per added/evicted item so readers never rescan the items
+class YearHistogram
+{
+public:
+	void Add(int year)
+	{
+		++m_countPerYear[year];
+	}
+
+	void Remove(int year)
+	{
+		const auto it = m_countPerYear.find(year);
+		if (assert(it != m_countPerYear.end()); it == m_countPerYear.end())
+			return;
+
+		if (--it->second == 0)
+			m_countPerYear.erase(it);
+	}
+
+	void Clear()
+	{
+		m_countPerYear.clear();
+	}
+
+	int CountAt(int year) const
+	{
+		const auto it = m_countPerYear.find(year);
+		return it == m_countPerYear.end() ? 0 : it->second;
+	}
+
+	// Counts aggregated into buckets of bucketYears starting at firstYear; years outside [firstYear, lastYear] are skipped
+	std::vector<int> Buckets(int firstYear, int lastYear, int bucketYears) const
+	{
+		if (lastYear < firstYear || bucketYears <= 0)
+			return {};
+
+		std::vector<int> buckets((lastYear - firstYear) / bucketYears + 1, 0);
+		for (auto it = m_countPerYear.lower_bound(firstYear); it != m_countPerYear.end() && it->first <= lastYear; ++it)
+			buckets[(it->first - firstYear) / bucketYears] += it->second;
+
+		return buckets;
+	}
+
+private:
+	// Only a couple of hundred distinct years, ordered so bucket queries walk a contiguous span
+	std::map<int, int> m_countPerYear;
+};
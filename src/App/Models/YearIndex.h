@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Source rows ordered by year, so a timeline range maps to one contiguous slice
+// found with two binary searches instead of a scan through the source model.
+class YearIndex
+{
+public:
+	struct Entry
+	{
+		int year;
+		int row;
+	};
+
+	// Expects one entry per source row
+	void Rebuild(std::vector<Entry> entries)
+	{
+		std::ranges::stable_sort(entries, {}, &Entry::year);
+		m_entries = std::move(entries);
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+	}
+
+	size_t Size() const
+	{
+		return m_entries.size();
+	}
+
+	// Timeline ranges are open on the left: (yearFrom, yearTo]
+	std::span<const Entry> InRange(int yearFrom, int yearTo) const
+	{
+		if (yearTo <= yearFrom)
+			return {};
+
+		const auto first = std::ranges::upper_bound(m_entries, yearFrom, {}, &Entry::year);
+		const auto last = std::ranges::upper_bound(first, m_entries.end(), yearTo, {}, &Entry::year);
+		return { first, last };
+	}
+
+	// Rows in (yearFrom, yearTo] that are not in (exceptFrom, exceptTo], ordered by row.
+	// Only the two slices of the range difference are visited
+	std::vector<int> RowsInRangeExcept(int yearFrom, int yearTo, int exceptFrom, int exceptTo) const
+	{
+		auto rows = exceptTo <= exceptFrom
+					  ? RowsOf(InRange(yearFrom, yearTo))
+					  : RowsOf(InRange(yearFrom, std::min(yearTo, exceptFrom)));
+		if (exceptTo > exceptFrom)
+		{
+			const auto above = RowsOf(InRange(std::max(yearFrom, exceptTo), yearTo));
+			rows.insert(rows.end(), above.begin(), above.end());
+		}
+		std::ranges::sort(rows);
+		return rows;
+	}
+
+	// Per-row membership bitmap for the range, sized to the number of source rows
+	void FillRowMask(int yearFrom, int yearTo, std::vector<bool> & mask) const
+	{
+		mask.assign(m_entries.size(), false);
+		for (const auto & entry : InRange(yearFrom, yearTo))
+			mask[entry.row] = true;
+	}
+
+private:
+	static std::vector<int> RowsOf(std::span<const Entry> slice)
+	{
+		std::vector<int> rows;
+		rows.reserve(slice.size());
+		for (const auto & entry : slice)
+			rows.push_back(entry.row);
+		return rows;
+	}
+
+private:
+	std::vector<Entry> m_entries;
+};
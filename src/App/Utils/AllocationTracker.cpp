@@ -0,0 +1,239 @@
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "App/Utils/Trace.h"
+
+namespace {
+
+// Distinct stages kept, further ones are not recorded
+constexpr auto MAX_STAGES = 64;
+
+std::atomic<std::uint64_t> g_allocations { 0 };
+std::atomic<std::uint64_t> g_allocatedBytes { 0 };
+std::atomic<std::int64_t> g_liveBytes { 0 };
+std::atomic<std::int64_t> g_peakLiveBytes { 0 };
+
+// Plain thread locals, so the hook itself never allocates
+thread_local std::uint64_t t_allocations { 0 };
+thread_local std::uint64_t t_allocatedBytes { 0 };
+thread_local std::int64_t t_netBytes { 0 };
+thread_local std::int64_t t_highWater { 0 };
+
+// Recording a stage must not allocate either, or it would count against the stage around it
+struct StageRegistry
+{
+	std::mutex mutex;
+	std::array<AllocationTracker::StageStats, MAX_STAGES> stages {};
+	std::size_t size { 0 };
+};
+
+StageRegistry & GetRegistry()
+{
+	static StageRegistry registry;
+	return registry;
+}
+
+[[maybe_unused]] void OnAllocated(std::size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	const auto live = g_liveBytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed) + static_cast<std::int64_t>(size);
+	auto peak = g_peakLiveBytes.load(std::memory_order_relaxed);
+	while (live > peak && !g_peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+
+	++t_allocations;
+	t_allocatedBytes += size;
+	t_netBytes += static_cast<std::int64_t>(size);
+	t_highWater = std::max(t_highWater, t_netBytes);
+}
+
+[[maybe_unused]] void OnFreed(std::size_t size)
+{
+	g_liveBytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+	t_netBytes -= static_cast<std::int64_t>(size);
+}
+
+}
+
+#ifdef PASTVIEWER_ALLOCATION_TRACKING
+
+namespace {
+
+// Sizes are kept in front of every block, unsized deletes need them. Over-aligned
+// allocations are left to the library and not counted
+constexpr auto HEADER_SIZE = alignof(std::max_align_t);
+
+void * TrackedAllocate(std::size_t size) noexcept
+{
+	auto * block = static_cast<unsigned char *>(std::malloc(HEADER_SIZE + size));
+	if (!block)
+		return nullptr;
+
+	std::memcpy(block, &size, sizeof(size));
+	OnAllocated(size);
+	return block + HEADER_SIZE;
+}
+
+void TrackedFree(void * memory) noexcept
+{
+	if (!memory)
+		return;
+
+	auto * block = static_cast<unsigned char *>(memory) - HEADER_SIZE;
+	std::size_t size = 0;
+	std::memcpy(&size, block, sizeof(size));
+	OnFreed(size);
+	std::free(block);
+}
+
+}
+
+void * operator new(std::size_t size)
+{
+	if (auto * memory = TrackedAllocate(size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void operator delete(void * memory) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void * memory, std::size_t) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete(void * memory, const std::nothrow_t &) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void * memory, const std::nothrow_t &) noexcept
+{
+	TrackedFree(memory);
+}
+
+#endif
+
+namespace AllocationTracker {
+
+Counters Total()
+{
+	return { g_allocations.load(std::memory_order_relaxed), g_allocatedBytes.load(std::memory_order_relaxed) };
+}
+
+Counters ThreadTotal()
+{
+	return { t_allocations, t_allocatedBytes };
+}
+
+std::uint64_t LiveBytes()
+{
+	return static_cast<std::uint64_t>(std::max<std::int64_t>(0, g_liveBytes.load(std::memory_order_relaxed)));
+}
+
+std::uint64_t PeakLiveBytes()
+{
+	return static_cast<std::uint64_t>(g_peakLiveBytes.load(std::memory_order_relaxed));
+}
+
+std::vector<StageStats> Stages()
+{
+	auto & registry = GetRegistry();
+	std::lock_guard lock(registry.mutex);
+	return { registry.stages.data(), registry.stages.data() + registry.size };
+}
+
+void ResetStages()
+{
+	auto & registry = GetRegistry();
+	std::lock_guard lock(registry.mutex);
+	registry.size = 0;
+}
+
+Stage::Stage(const char * name) noexcept
+	: m_name(name)
+	, m_start(ThreadTotal())
+	, m_startNetBytes(t_netBytes)
+	, m_outerHighWater(t_highWater)
+{
+	t_highWater = t_netBytes;
+}
+
+Stage::~Stage()
+{
+	const auto current = Current();
+	const auto peakBytes = PeakBytes();
+	t_highWater = std::max(m_outerHighWater, t_highWater);
+
+	Trace::Counter(m_name, "allocations", static_cast<std::int64_t>(current.allocations));
+
+	auto & registry = GetRegistry();
+	std::lock_guard lock(registry.mutex);
+	auto * const end = registry.stages.data() + registry.size;
+	auto * stats = std::find_if(registry.stages.data(), end, [this](const StageStats & stats) {
+		return stats.name == m_name || std::strcmp(stats.name, m_name) == 0;
+	});
+	if (stats == end)
+	{
+		if (registry.size == registry.stages.size())
+			return;
+		*stats = { m_name };
+		++registry.size;
+	}
+
+	++stats->calls;
+	stats->allocations += current.allocations;
+	stats->bytes += current.bytes;
+	stats->peakBytes = std::max(stats->peakBytes, peakBytes);
+}
+
+Counters Stage::Current() const
+{
+	const auto now = ThreadTotal();
+	return { now.allocations - m_start.allocations, now.bytes - m_start.bytes };
+}
+
+std::uint64_t Stage::PeakBytes() const
+{
+	return static_cast<std::uint64_t>(std::max<std::int64_t>(0, t_highWater - m_startNetBytes));
+}
+
+} // namespace AllocationTracker
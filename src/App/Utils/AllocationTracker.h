@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "App/Utils/NonCopyMovable.h"
+
+// Counts heap allocations made through operator new, overall and per named stage.
+// Only builds configured with -DALLOCATION_TRACKING=ON define PASTVIEWER_ALLOCATION_TRACKING
+// and replace operator new; elsewhere stages compile to nothing and counters stay zero.
+// Stage names are not copied and have to be string literals.
+namespace AllocationTracker {
+
+struct Counters
+{
+	std::uint64_t allocations { 0 };
+	std::uint64_t bytes { 0 };
+};
+
+struct StageStats
+{
+	const char * name { nullptr };
+	std::uint64_t calls { 0 };
+	// Inclusive of nested stages
+	std::uint64_t allocations { 0 };
+	std::uint64_t bytes { 0 };
+	// Most memory a single call held at once on top of what was live when it started
+	std::uint64_t peakBytes { 0 };
+};
+
+constexpr bool IsEnabled()
+{
+#ifdef PASTVIEWER_ALLOCATION_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Whole process since start
+Counters Total();
+// Made by the calling thread since it started
+Counters ThreadTotal();
+std::uint64_t LiveBytes();
+// High-water mark of LiveBytes
+std::uint64_t PeakLiveBytes();
+
+// Stages seen since the last reset, in order of first use
+std::vector<StageStats> Stages();
+void ResetStages();
+
+// Accounts allocations the calling thread makes during its lifetime to a stage; while
+// tracing, every call is also recorded as a counter of the stage's allocations
+class Stage
+{
+public:
+	explicit Stage(const char * name) noexcept;
+	~Stage();
+	NON_COPY_MOVABLE(Stage);
+
+	// So far in this call
+	Counters Current() const;
+	std::uint64_t PeakBytes() const;
+
+private:
+	const char * m_name;
+	Counters m_start;
+	std::int64_t m_startNetBytes;
+	std::int64_t m_outerHighWater;
+};
+
+} // namespace AllocationTracker
+
+#ifdef PASTVIEWER_ALLOCATION_TRACKING
+#define ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_IMPL(a, b)
+
+// Accounts the enclosing scope's allocations to a stage
+#define ALLOCATION_STAGE(name) const AllocationTracker::Stage ALLOCATION_CONCAT(allocationStage, __LINE__)(name)
+#else
+#define ALLOCATION_STAGE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Entries with a cost, the least recently used are evicted once the total cost
+// exceeds the capacity. Not thread safe
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+public:
+	explicit LruCache(size_t capacity)
+		: m_capacity(capacity)
+	{
+	}
+
+	// Marks the entry as the most recently used, nullptr when missing
+	const Value * Find(const Key & key)
+	{
+		const auto it = m_index.find(key);
+		if (it == m_index.end())
+			return nullptr;
+
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return &it->second->value;
+	}
+
+	bool Contains(const Key & key) const
+	{
+		return m_index.contains(key);
+	}
+
+	// Replaces an entry of the same key, returns the evicted keys least recently used first.
+	// An entry costing more than the capacity is evicted right away
+	std::vector<Key> Insert(const Key & key, Value value, size_t cost)
+	{
+		Erase(key);
+		m_entries.push_front({ key, std::move(value), cost });
+		m_index.emplace(key, m_entries.begin());
+		m_cost += cost;
+
+		std::vector<Key> evicted;
+		while (m_cost > m_capacity)
+		{
+			auto & last = m_entries.back();
+			evicted.push_back(last.key);
+			m_cost -= last.cost;
+			m_index.erase(last.key);
+			m_entries.pop_back();
+		}
+		return evicted;
+	}
+
+	bool Erase(const Key & key)
+	{
+		const auto it = m_index.find(key);
+		if (it == m_index.end())
+			return false;
+
+		m_cost -= it->second->cost;
+		m_entries.erase(it->second);
+		m_index.erase(it);
+		return true;
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+		m_index.clear();
+		m_cost = 0;
+	}
+
+	size_t Size() const
+	{
+		return m_index.size();
+	}
+
+	size_t Cost() const
+	{
+		return m_cost;
+	}
+
+	size_t Capacity() const
+	{
+		return m_capacity;
+	}
+
+private:
+	struct Entry
+	{
+		Key key;
+		Value value;
+		size_t cost;
+	};
+
+	// Most recently used first
+	std::list<Entry> m_entries;
+	std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_index;
+	size_t m_capacity;
+	size_t m_cost { 0 };
+};
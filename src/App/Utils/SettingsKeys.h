@@ -0,0 +1,14 @@
+#pragma once
+
+// Settings written by the controller and read back by the models it owns
+namespace SettingsKeys {
+
+constexpr auto NEAREST_OBJECTS_ONLY = "NearestObjectsOnly";
+constexpr auto HISTORY_NEAR_MODEL_TYPE = "HistoryNearModelType";
+constexpr auto FUSED_PIPELINE = "FusedPipeline";
+constexpr auto YEARS_FROM = "YEARS_FROM";
+constexpr auto YEARS_TO = "YEARS_TO";
+// Lower end of the timeline, YEARS_TO defaults to the current year
+constexpr auto YEAR_FROM_VALUE = 1800;
+
+}
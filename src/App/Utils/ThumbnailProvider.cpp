@@ -0,0 +1,56 @@
+#include "ThumbnailProvider.h"
+
+#include <QImage>
+#include <QQuickTextureFactory>
+#include <QUrl>
+
+#include "App/Models/ThumbnailCache.h"
+
+namespace {
+
+class ThumbnailResponse
+	: public QQuickImageResponse
+{
+public:
+	explicit ThumbnailResponse(const QSize & requestedSize)
+		: m_requestedSize(requestedSize)
+	{
+	}
+
+	// On a pool thread, the engine keeps the response until finished is emitted
+	void Finish(const QImage & image)
+	{
+		m_image = m_requestedSize.isEmpty() || image.isNull()
+			? image
+			: image.scaled(m_requestedSize, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+		emit finished();
+	}
+
+	QQuickTextureFactory * textureFactory() const override
+	{
+		return QQuickTextureFactory::textureFactoryForImage(m_image);
+	}
+
+	QString errorString() const override
+	{
+		return m_image.isNull() ? QStringLiteral("Failed to load thumbnail") : QString();
+	}
+
+private:
+	QSize m_requestedSize;
+	QImage m_image;
+};
+
+}
+
+ThumbnailProvider::ThumbnailProvider(ThumbnailCache & cache)
+	: m_cache(cache)
+{
+}
+
+QQuickImageResponse * ThumbnailProvider::requestImageResponse(const QString & id, const QSize & requestedSize)
+{
+	auto * response = new ThumbnailResponse(requestedSize);
+	m_cache.Request(QUrl(QUrl::fromPercentEncoding(id.toUtf8())), [response](const QImage & image) { response->Finish(image); });
+	return response;
+}
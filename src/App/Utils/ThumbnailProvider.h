@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QQuickAsyncImageProvider>
+
+class ThumbnailCache;
+
+// Serves image://thumbnails/<percent encoded URL> from the thumbnail cache
+class ThumbnailProvider
+	: public QQuickAsyncImageProvider
+{
+public:
+	static constexpr auto ID = "thumbnails";
+
+	explicit ThumbnailProvider(ThumbnailCache & cache);
+
+	QQuickImageResponse * requestImageResponse(const QString & id, const QSize & requestedSize) override;
+
+private:
+	ThumbnailCache & m_cache;
+};
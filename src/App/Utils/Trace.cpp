@@ -0,0 +1,185 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+	const char * name;
+	char phase;
+	std::int64_t timestampUs;
+	std::int64_t durationUs;
+	std::uint64_t id;
+	std::size_t threadId;
+	const char * series;
+	std::int64_t value;
+};
+
+struct Buffer
+{
+	std::mutex mutex;
+	std::array<Event, Trace::CAPACITY> events {};
+	std::size_t next { 0 };
+	std::size_t size { 0 };
+	const Clock::time_point epoch { Clock::now() };
+};
+
+std::atomic<bool> g_enabled { false };
+
+Buffer & GetBuffer()
+{
+	static Buffer buffer;
+	return buffer;
+}
+
+std::int64_t MicrosecondsSinceEpoch(Clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time - GetBuffer().epoch).count();
+}
+
+void Record(const char * name, char phase, Clock::time_point start, Clock::duration duration = {}, std::uint64_t id = 0, const char * series = nullptr, std::int64_t value = 0)
+{
+	auto & buffer = GetBuffer();
+	const Event event {
+		name,
+		phase,
+		MicrosecondsSinceEpoch(start),
+		std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+		id,
+		std::hash<std::thread::id> {}(std::this_thread::get_id()),
+		series,
+		value,
+	};
+
+	std::lock_guard lock(buffer.mutex);
+	buffer.events[buffer.next] = event;
+	buffer.next = (buffer.next + 1) % buffer.events.size();
+	buffer.size = std::min(buffer.size + 1, buffer.events.size());
+}
+
+std::string EscapeJson(const char * text)
+{
+	std::string escaped;
+	for (; *text; ++text)
+	{
+		if (*text == '"' || *text == '\\')
+			escaped += '\\';
+		escaped += *text;
+	}
+	return escaped;
+}
+
+}
+
+namespace Trace {
+
+void SetEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsEnabled()
+{
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Instant(const char * name)
+{
+	if (IsEnabled())
+		Record(name, 'i', Clock::now());
+}
+
+void AsyncBegin(const char * name, std::uint64_t id)
+{
+	if (IsEnabled())
+		Record(name, 'b', Clock::now(), {}, id);
+}
+
+void AsyncEnd(const char * name, std::uint64_t id)
+{
+	if (IsEnabled())
+		Record(name, 'e', Clock::now(), {}, id);
+}
+
+void Counter(const char * name, const char * series, std::int64_t value)
+{
+	if (IsEnabled())
+		Record(name, 'C', Clock::now(), {}, 0, series, value);
+}
+
+std::string ExportChromeJson()
+{
+	auto & buffer = GetBuffer();
+	std::lock_guard lock(buffer.mutex);
+
+	std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+	const auto first = (buffer.next + buffer.events.size() - buffer.size) % buffer.events.size();
+	for (std::size_t i = 0; i < buffer.size; ++i)
+	{
+		const auto & event = buffer.events[(first + i) % buffer.events.size()];
+		if (i > 0)
+			json += ',';
+
+		json += R"({"name":")" + EscapeJson(event.name) + R"(","ph":")" + event.phase
+			  + R"(","ts":)" + std::to_string(event.timestampUs)
+			  + R"(,"pid":1,"tid":)" + std::to_string(event.threadId);
+		switch (event.phase)
+		{
+			case 'X':
+				json += R"(,"dur":)" + std::to_string(event.durationUs);
+				break;
+			case 'i':
+				json += R"(,"s":"g")";
+				break;
+			case 'C':
+				json += R"(,"args":{")" + EscapeJson(event.series) + R"(":)" + std::to_string(event.value) + '}';
+				break;
+			case 'b':
+			case 'e':
+			{
+				std::array<char, 24> id {};
+				std::snprintf(id.data(), id.size(), "0x%llx", static_cast<unsigned long long>(event.id));
+				json += R"(,"cat":"async","id":")" + std::string(id.data()) + '"';
+				break;
+			}
+			default:
+				break;
+		}
+		json += '}';
+	}
+	json += "]}";
+	return json;
+}
+
+void Clear()
+{
+	auto & buffer = GetBuffer();
+	std::lock_guard lock(buffer.mutex);
+	buffer.next = 0;
+	buffer.size = 0;
+}
+
+Scope::Scope(const char * name) noexcept
+	: m_name(name)
+	, m_enabled(IsEnabled())
+{
+	if (m_enabled)
+		m_start = Clock::now();
+}
+
+Scope::~Scope()
+{
+	if (m_enabled)
+		Record(m_name, 'X', m_start, Clock::now() - m_start);
+}
+
+} // namespace Trace
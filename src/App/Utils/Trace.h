@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "App/Utils/NonCopyMovable.h"
+
+// In-memory tracing of named spans into a fixed size ring buffer, exported in the
+// Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Off by default; a disabled span costs one atomic load.
+// Names are not copied and have to be string literals.
+namespace Trace {
+
+// Events kept, the oldest are overwritten first
+constexpr auto CAPACITY = 16384;
+
+void SetEnabled(bool enabled);
+bool IsEnabled();
+
+// A moment rather than a span, e.g. a frame being presented
+void Instant(const char * name);
+
+// A span that starts and finishes in different calls, e.g. a network request; paired by id
+void AsyncBegin(const char * name, std::uint64_t id);
+void AsyncEnd(const char * name, std::uint64_t id);
+
+// A sampled value shown as a graph, e.g. allocations made by a stage; series is the args key
+void Counter(const char * name, const char * series, std::int64_t value);
+
+// {"traceEvents":[...]}, oldest event first
+std::string ExportChromeJson();
+void Clear();
+
+class Scope
+{
+public:
+	explicit Scope(const char * name) noexcept;
+	~Scope();
+	NON_COPY_MOVABLE(Scope);
+
+private:
+	const char * m_name;
+	std::chrono::steady_clock::time_point m_start;
+	bool m_enabled;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+// Traces the enclosing scope as a span
+#define TRACE_SCOPE(name) const Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -1,7 +1,9 @@
 import QtQuick
+import QtQuick.Effects
 import QtQuick.Shapes
 
 import "../Helpers/colors.js" as Colors
+import "../Helpers/utils.js" as Utils
 
 Rectangle {
     id: rootID
@@ -10,6 +12,12 @@ Rectangle {
     required property int clusterCount
 
     property bool selected: false
+    // Aggregates over the members, see ClusterModel
+    property int yearFrom: 0
+    property int yearTo: 0
+    property string thumbnail: ""
+    property real bearing: 361 // degrees, 0=N, 90=E (clockwise), 361 when no member has one
+    property real mapBearing: 0 // subtracted from bearing
 
     signal clicked()
 
@@ -26,6 +34,77 @@ Rectangle {
         onTapped: rootID.clicked()
     }
 
+    Rectangle {
+        id: maskID
+
+        anchors.fill: parent
+        radius: width / 2
+        visible: false
+        layer.enabled: true
+    }
+
+    // The member closest to the middle, tinted so the count stays readable
+    Image {
+        id: thumbnailID
+
+        anchors.fill: parent
+        anchors.margins: rootID.border.width
+
+        source: Utils.thumbnailSource(rootID.thumbnail)
+        sourceSize: Qt.size(rootID.size * 2, rootID.size * 2)
+        fillMode: Image.PreserveAspectCrop
+        asynchronous: true
+        opacity: 0.45
+
+        layer.enabled: status === Image.Ready
+        layer.effect: MultiEffect {
+            maskEnabled: true
+            maskSource: maskID
+        }
+    }
+
+    // Notch on the rim towards the direction most members were taken in
+    Item {
+        id: bearingID
+
+        anchors.fill: parent
+        visible: rootID.bearing >= 0 && rootID.bearing < 360
+
+        transform: Rotation {
+            origin.x: bearingID.width / 2
+            origin.y: bearingID.height / 2
+            angle: ((rootID.bearing - rootID.mapBearing) % 360 + 360) % 360
+        }
+
+        Shape {
+            id: notchID
+
+            width: rootID.size * 0.35
+            height: width * 0.6
+
+            anchors.horizontalCenter: parent.horizontalCenter
+            anchors.bottom: parent.top
+            anchors.bottomMargin: -rootID.border.width
+
+            ShapePath {
+                fillColor: Colors.palette.border
+                strokeColor: "transparent"
+                PathMove {
+                    x: notchID.width / 2
+                    y: 0
+                }
+                PathLine {
+                    x: 0
+                    y: notchID.height
+                }
+                PathLine {
+                    x: notchID.width
+                    y: notchID.height
+                }
+            }
+        }
+    }
+
     Text {
         id: countTextID
 
@@ -37,5 +116,19 @@ Rectangle {
         horizontalAlignment: Text.AlignHCenter
         verticalAlignment: Text.AlignVCenter
     }
-}
 
+    Text {
+        id: yearsTextID
+
+        anchors.top: parent.bottom
+        anchors.topMargin: 2
+        anchors.horizontalCenter: parent.horizontalCenter
+
+        visible: rootID.yearFrom > 0
+        text: rootID.yearFrom === rootID.yearTo ? rootID.yearFrom : rootID.yearFrom + "–" + rootID.yearTo
+        color: Colors.palette.text
+        style: Text.Outline
+        styleColor: Colors.palette.bg
+        font.pixelSize: Math.max(8, rootID.size * 0.4)
+    }
+}
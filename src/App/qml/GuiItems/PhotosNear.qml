@@ -130,15 +130,33 @@ Rectangle {
         ListView {
             id: listViewID
 
+            property int prefetchedFromIndex: -1
+
             Layout.fillWidth: true
             Layout.fillHeight: true
 
 
-            model: pastVuModelController.GetModel(ModelType.Raw)
+            model: pastVuModelController.rawModel
             orientation: ListView.Horizontal
             spacing: 10
 
-            onCountChanged: Utils.setTimeout(positionViewAtEnd, 300)
+            // The nearest objects model is ordered by distance, closest first
+            onCountChanged: {
+                Utils.setTimeout(pastVuModelController.historyNearModelType ? positionViewAtEnd : positionViewAtBeginning, 300)
+                prefetchThumbnails()
+            }
+            onContentXChanged: {
+                if (indexAt(contentX, contentY) !== prefetchedFromIndex)
+                    prefetchThumbnails()
+            }
+
+            // Thumbnails of the cards either side of the shown ones are loaded ahead of scrolling
+            function prefetchThumbnails() {
+                const first = indexAt(contentX, contentY)
+                const last = indexAt(contentX + width - 1, contentY)
+                prefetchedFromIndex = first
+                thumbnailCache.Prefetch(model, Math.max(first, 0), Math.max(first, last, 0))
+            }
 
             delegate: Item {
                 width: 100
@@ -175,7 +193,7 @@ Rectangle {
                         Layout.fillWidth: true
                         Layout.preferredHeight: 100
 
-                        source: Thumbnail
+                        source: Utils.thumbnailSource(Thumbnail)
                         fillMode: Image.PreserveAspectCrop
 
                         layer.enabled: true
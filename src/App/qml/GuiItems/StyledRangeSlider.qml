@@ -14,12 +14,46 @@ ColumnLayout {
     property real rangeMax: 100
     property real selectedMin: 0
     property real selectedMax: 100
+    property var histogram: []
+    property int histogramBucketSize: 1
 
     Text {
         text: qsTr("Timeline: ") + Math.floor(timelineSliderID.first.value) + " - " + Math.floor(timelineSliderID.second.value)
         font.family: "monospace"
     }
 
+    Item {
+        id: histogramID
+
+        readonly property int maxCount: Math.max(1, Math.max.apply(null, timelineSettingID.histogram))
+        readonly property real yearsSpan: Math.max(1, rangeMax - rangeMin)
+
+        Layout.fillWidth: true
+        Layout.preferredHeight: 24
+
+        visible: timelineSettingID.histogram.length > 0
+
+        // Bars only depend on the histogram; dragging the handles just recolors them
+        Repeater {
+            model: timelineSettingID.histogram
+
+            Rectangle {
+                readonly property real bucketFrom: rangeMin + index * histogramBucketSize
+                readonly property real bucketTo: Math.min(rangeMax, bucketFrom + histogramBucketSize)
+
+                anchors.bottom: parent.bottom
+                x: (bucketFrom - rangeMin) / histogramID.yearsSpan * histogramID.width
+                width: Math.max(1, (bucketTo - bucketFrom) / histogramID.yearsSpan * histogramID.width - 1)
+                height: modelData / histogramID.maxCount * histogramID.height
+
+                radius: 1
+                color: bucketTo > timelineSliderID.first.value && bucketFrom <= timelineSliderID.second.value
+                    ? Colors.palette.slider
+                    : Colors.palette.sliderAlt
+            }
+        }
+    }
+
     RangeSlider {
         id: timelineSliderID
 
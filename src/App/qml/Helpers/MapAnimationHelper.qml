@@ -163,10 +163,7 @@ Item {
         if (!pendingClusterCheck)
             return
 
-        const mapObj = pendingClusterCheck.map
-        const topLeftCoord = mapObj.toCoordinate(Qt.point(0, 0), false)
-        const bottomRightCoord = mapObj.toCoordinate(Qt.point(mapObj.width, mapObj.height), false)
-        pastVuModelController.SetViewportCoordinates(QtPositioning.rectangle(topLeftCoord, bottomRightCoord))
+        pendingClusterCheck.map.updateViewCoordinates()
 
         pendingClusterCheck = null
     }
@@ -17,4 +17,15 @@ function setTimeout(callback, delayMs) { // @TODO: replace with Qt.callLater()
     })
 
     timer.start()
-}
\ No newline at end of file
+}
+
+function formatBytes(bytes) {
+    if (bytes < 1024 * 1024)
+        return qsTr("%1 KB").arg(Math.max(1, Math.round(bytes / 1024)))
+    return qsTr("%1 MB").arg((bytes / (1024 * 1024)).toFixed(1))
+}
+
+function thumbnailSource(url) {
+    // Served from the app's thumbnail cache, which keeps them on disk between runs
+    return url ? "image://thumbnails/" + encodeURIComponent(url) : ""
+}
@@ -168,9 +168,13 @@ Item {
                     if (mapID.width <= 0 || mapID.height <= 0)
                         return
 
-                    const topLeftCoord = mapID.toCoordinate(Qt.point(0, 0), false)
-                    const bottomRightCoord = mapID.toCoordinate(Qt.point(mapID.width, mapID.height), false)
-                    pastVuModelController.SetViewportCoordinates(QtPositioning.rectangle(topLeftCoord, bottomRightCoord))
+                    // Screen corners counter-clockwise, on a rotated map they are not axis aligned
+                    pastVuModelController.SetViewportArea(QtPositioning.polygon([
+                        mapID.toCoordinate(Qt.point(0, 0), false),
+                        mapID.toCoordinate(Qt.point(0, mapID.height), false),
+                        mapID.toCoordinate(Qt.point(mapID.width, mapID.height), false),
+                        mapID.toCoordinate(Qt.point(mapID.width, 0), false)
+                    ]))
                 }
 
                 anchors.fill: parent
@@ -228,7 +232,7 @@ Item {
                 MapItemView {
                     id: mapItemViewID
 
-                    model: pastVuModelController.GetModel(ModelType.Clustered)
+                    model: pastVuModelController.clusteredModel
                     delegate: delegateID
                 }
 
@@ -286,6 +290,11 @@ Item {
                                     size: mapItemID.itemSize
                                     clusterCount: model.ClusterCount
                                     selected: model.Selected
+                                    yearFrom: model.ClusterYearFrom
+                                    yearTo: model.ClusterYearTo
+                                    thumbnail: model.ClusterThumbnail
+                                    bearing: model.ClusterBearing
+                                    mapBearing: mapID.bearing + compassID.bearing
 
                                     onClicked: {
                                         mapAnimationHelperID.animateMapCenterAndZoom(
@@ -4,6 +4,7 @@ import QtQuick.Layouts
 import QtCore
 
 import "../Helpers/colors.js" as Colors
+import "../Helpers/utils.js" as Utils
 import "../Helpers"
 import "Helpers"
 
@@ -48,7 +49,7 @@ BasePage {
                     anchors.fill: parent
                     anchors.centerIn: parent
 
-                    source: photoDetailsPageID.thumbnailSource
+                    source: Utils.thumbnailSource(photoDetailsPageID.thumbnailSource)
                     fillMode: Image.PreserveAspectFit
                     smooth: true
                     antialiasing: true
@@ -3,6 +3,7 @@ import QtQuick.Controls
 import QtQuick.Layouts
 
 import "../Helpers/colors.js" as Colors
+import "../Helpers/utils.js" as Utils
 import "../GuiItems"
 import "Helpers"
 
@@ -160,6 +161,17 @@ BasePage {
                 }
             }
 
+            SettingWithHint {
+                Layout.leftMargin: -7
+
+                description: qsTr("Experimental. Filters and clusters map items in a single pass instead of a chain of models.")
+
+                StyledCheckBox {
+                    checked: pastVuModelController.fusedPipeline
+                    text: qsTr("Fused map pipeline")
+                    onClicked: pastVuModelController.ToggleFusedPipeline();
+                }
+            }
 
             StyledRangeSlider {
                 id: timelineSettingID
@@ -170,11 +182,45 @@ BasePage {
                 rangeMax: pastVuModelController.timelineRange.max
                 selectedMin: pastVuModelController.userSelectedTimelineRange.min
                 selectedMax: pastVuModelController.userSelectedTimelineRange.max
+                histogram: pastVuModelController.yearHistogram
+                histogramBucketSize: pastVuModelController.yearHistogramBucketSize
 
                 onSelectedMinChanged: pastVuModelController.userSelectedTimelineRange.min = selectedMin
                 onSelectedMaxChanged: pastVuModelController.userSelectedTimelineRange.max = selectedMax
             }
 
+            SettingWithHint {
+                Layout.leftMargin: -7
+
+                visible: guiController.IsDebug()
+                description: qsTr("Records timings from viewport changes to rendered frames in memory.")
+
+                StyledCheckBox {
+                    checked: guiController.tracing
+                    text: qsTr("Record performance trace")
+                    onClicked: guiController.tracing = !guiController.tracing
+                }
+            }
+
+            SettingWithHint {
+                visible: guiController.IsDebug()
+                description: qsTr("Saves the recorded trace as Chrome trace JSON, open it in ui.perfetto.dev.")
+
+                StyledButton {
+                    text: qsTr("Export trace")
+                    onClicked: exportTraceResultID.text = guiController.ExportTrace() || qsTr("Export failed")
+                }
+            }
+
+            Text {
+                id: exportTraceResultID
+
+                Layout.fillWidth: true
+                visible: guiController.IsDebug() && text.length > 0
+                wrapMode: Text.WrapAnywhere
+                font.pixelSize: 12
+            }
+
             SettingWithHint {
                 description: qsTr("Show the introductory tips on the map and photo screens again.")
 
@@ -196,6 +242,97 @@ BasePage {
                     onClicked: pastVuModelController.ReloadItems()
                 }
             }
+
+            ColumnLayout {
+                id: offlineBlockID
+
+                readonly property var downloader: pastVuModelController.offlineRegions
+                property string status: ""
+
+                Layout.fillWidth: true
+                spacing: 8
+
+                Connections {
+                    target: offlineBlockID.downloader
+                    function onDownloadFinished() {
+                        offlineBlockID.status = qsTr("Area downloaded, it can be browsed without a connection.")
+                    }
+                    function onDownloadFailed(failedTiles) {
+                        offlineBlockID.status = qsTr("%1 parts could not be downloaded, resume to try again.").arg(failedTiles)
+                    }
+                    function onRegionTooLarge() {
+                        offlineBlockID.status = qsTr("The area is too large, zoom in and try again.")
+                    }
+                }
+
+                SettingWithHint {
+                    description: qsTr("Downloads the photo list for the current map area, so it can be browsed without a connection. Photos themselves are still loaded when opened.")
+
+                    StyledButton {
+                        text: offlineBlockID.downloader.downloading
+                              ? qsTr("Pause download")
+                              : offlineBlockID.downloader.resumable ? qsTr("Resume download") : qsTr("Download current area")
+                        onClicked: {
+                            offlineBlockID.status = ""
+                            if (offlineBlockID.downloader.downloading)
+                                offlineBlockID.downloader.Pause()
+                            else if (offlineBlockID.downloader.resumable)
+                                offlineBlockID.downloader.Resume()
+                            else
+                                offlineBlockID.downloader.Download(pastVuModelController.GetViewport())
+                        }
+                    }
+                }
+
+                Text {
+                    Layout.fillWidth: true
+                    visible: !offlineBlockID.downloader.downloading && !offlineBlockID.downloader.resumable
+                    text: {
+                        // Re-evaluated whenever stored tiles change, the invokables alone notify nothing
+                        const downloader = offlineBlockID.downloader
+                        void downloader.storedBytes
+                        void downloader.tilesDone
+                        const viewport = pastVuModelController.GetViewport()
+                        if (downloader.CountMissingTiles(viewport) === 0)
+                            return qsTr("Current area: already downloaded")
+                        return qsTr("Current area: about %1 to download").arg(Utils.formatBytes(downloader.EstimateBytes(viewport)))
+                    }
+                    color: Colors.palette.text
+                    wrapMode: Text.Wrap
+                    font.pixelSize: 12
+                }
+
+                ProgressBar {
+                    Layout.fillWidth: true
+                    visible: offlineBlockID.downloader.tilesTotal > 0 && (offlineBlockID.downloader.downloading || offlineBlockID.downloader.resumable)
+                    from: 0
+                    to: offlineBlockID.downloader.tilesTotal
+                    value: offlineBlockID.downloader.tilesDone
+                }
+
+                Text {
+                    Layout.fillWidth: true
+                    visible: text.length > 0
+                    text: offlineBlockID.status.length > 0
+                          ? offlineBlockID.status
+                          : offlineBlockID.downloader.storedBytes > 0 ? qsTr("Stored offline: %1").arg(Utils.formatBytes(offlineBlockID.downloader.storedBytes)) : ""
+                    color: Colors.palette.text
+                    wrapMode: Text.Wrap
+                    font.pixelSize: 12
+                }
+
+                SettingWithHint {
+                    visible: offlineBlockID.downloader.storedBytes > 0
+
+                    StyledButton {
+                        text: qsTr("Delete offline data")
+                        onClicked: {
+                            offlineBlockID.status = ""
+                            offlineBlockID.downloader.ClearOfflineData()
+                        }
+                    }
+                }
+            }
         }
     }
 }
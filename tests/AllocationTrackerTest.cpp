@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "App/Utils/AllocationTracker.h"
+
+namespace {
+
+AllocationTracker::StageStats FindStage(const char * name)
+{
+	for (const auto & stage : AllocationTracker::Stages())
+	{
+		if (std::string_view(stage.name) == name)
+			return stage;
+	}
+	return {};
+}
+
+}
+
+class AllocationTrackerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!AllocationTracker::IsEnabled())
+			GTEST_SKIP() << "Configured without ALLOCATION_TRACKING";
+		AllocationTracker::ResetStages();
+	}
+};
+
+TEST_F(AllocationTrackerTest, StageCountsItsAllocations)
+{
+	{
+		const AllocationTracker::Stage stage("Stage");
+		const auto value = std::make_unique<int>(1);
+		const std::vector<int> values(100);
+		EXPECT_EQ(stage.Current().allocations, 2u);
+	}
+
+	const auto stats = FindStage("Stage");
+	EXPECT_EQ(stats.calls, 1u);
+	EXPECT_EQ(stats.allocations, 2u);
+	EXPECT_GE(stats.bytes, sizeof(int) + 100 * sizeof(int));
+	EXPECT_GE(stats.peakBytes, sizeof(int) + 100 * sizeof(int));
+}
+
+TEST_F(AllocationTrackerTest, NestedStagesAreInclusiveAndKeepOwnPeaks)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		const AllocationTracker::Stage outer("Outer");
+		std::vector<char> big(4096);
+		{
+			const AllocationTracker::Stage inner("Inner");
+			const std::vector<char> small(16);
+		}
+	}
+
+	const auto outer = FindStage("Outer");
+	const auto inner = FindStage("Inner");
+	EXPECT_EQ(outer.calls, 3u);
+	EXPECT_EQ(outer.allocations, 6u);
+	EXPECT_EQ(inner.allocations, 3u);
+	EXPECT_GE(outer.peakBytes, 4096u + 16u);
+	EXPECT_LT(inner.peakBytes, 4096u);
+}
+
+TEST_F(AllocationTrackerTest, SteadyStateStageAllocatesNothing)
+{
+	std::vector<int> values;
+	values.reserve(64);
+	{
+		const AllocationTracker::Stage stage("Steady");
+		for (int i = 0; i < 64; ++i)
+			values.push_back(i);
+	}
+
+	EXPECT_EQ(FindStage("Steady").allocations, 0u);
+}
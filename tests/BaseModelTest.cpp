@@ -0,0 +1,180 @@
+#include <memory>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QGeoCoordinate>
+#include <QGeoPolygon>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+
+#include "App/Models/BaseModel.h"
+#include "App/Models/OfflineStore.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+namespace {
+
+constexpr auto PHOTOS_RESPONSE = R"({"result":{"photos":[
+	{"cid":1,"geo":[55.751,37.611],"file":"a/b/1.jpg","title":"First","dir":"n","year":1900},
+	{"cid":2,"geo":[55.752,37.612],"file":"a/b/2.jpg","title":"Second","dir":"s","year":1950}
+]}})";
+
+// Within a single request tile
+const QGeoPolygon AREA({ { 55.76, 37.58 }, { 55.74, 37.58 }, { 55.74, 37.60 }, { 55.76, 37.60 } });
+
+}
+
+class BaseModelTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance())
+		{
+			static int argc = 1;
+			static char * argv[] = { const_cast<char *>("test") };
+			app = std::make_unique<QCoreApplication>(argc, argv);
+		}
+
+		auto networkManager = std::make_unique<FixtureNetworkAccessManager>([this](const QUrl &) {
+			++requestCount;
+			return QByteArray(PHOTOS_RESPONSE);
+		});
+		networkManager->SetLatency(std::chrono::milliseconds(5));
+		model = std::make_unique<BaseModel>(nullptr, QUrl("http://localhost/api2"), std::move(networkManager));
+	}
+
+	void TearDown() override
+	{
+		model.reset();
+		app.reset();
+	}
+
+	// Spins the event loop until the model reports loaded items or the timeout hits
+	void WaitForItems()
+	{
+		QEventLoop loop;
+		QObject::connect(model.get(), &BaseModel::ItemsLoaded, &loop, &QEventLoop::quit);
+		QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+		loop.exec();
+	}
+
+	// Whether LoadingFinished came before the timeout
+	bool WaitForLoadingFinished()
+	{
+		auto finished = false;
+		QEventLoop loop;
+		QObject::connect(model.get(), &BaseModel::LoadingFinished, &loop, [&] {
+			finished = true;
+			loop.quit();
+		});
+		QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+		loop.exec();
+		return finished;
+	}
+
+	std::unique_ptr<QCoreApplication> app;
+	std::unique_ptr<BaseModel> model;
+	int requestCount { 0 };
+};
+
+TEST_F(BaseModelTest, LoadsItemsFromFixture)
+{
+	emit model->UpdateCoords(AREA);
+	WaitForItems();
+
+	ASSERT_EQ(model->rowCount(), 2);
+	EXPECT_EQ(model->data(model->index(0), BaseModel::Cid).toInt(), 1);
+	EXPECT_TRUE(model->IsAreaLoaded(AREA));
+}
+
+TEST_F(BaseModelTest, LoadedAreaIsNotRequestedAgain)
+{
+	emit model->UpdateCoords(AREA);
+	WaitForItems();
+	const auto requestsAfterFirstLoad = requestCount;
+	ASSERT_GT(requestsAfterFirstLoad, 0);
+
+	emit model->UpdateCoords(AREA);
+	EXPECT_EQ(requestCount, requestsAfterFirstLoad);
+	EXPECT_EQ(model->GetRequestStats().loadedHits, static_cast<quint64>(requestsAfterFirstLoad));
+}
+
+TEST_F(BaseModelTest, LoadingFinishesWhenNoRowsChange)
+{
+	emit model->UpdateCoords(AREA);
+	ASSERT_TRUE(WaitForLoadingFinished());
+	ASSERT_EQ(model->rowCount(), 2);
+
+	// Answered with the same items, nothing to add
+	emit model->UpdateCoords(QGeoPolygon({ { 48.87, 2.33 }, { 48.85, 2.33 }, { 48.85, 2.35 }, { 48.87, 2.35 } }));
+	EXPECT_TRUE(WaitForLoadingFinished());
+	EXPECT_EQ(model->rowCount(), 2);
+}
+
+TEST_F(BaseModelTest, EvictedAreaIsNoLongerLoaded)
+{
+	// Every answer brings 600 new items, two of them overflow the buffer
+	auto cid = 0;
+	auto networkManager = std::make_unique<FixtureNetworkAccessManager>([&cid](const QUrl &) {
+		QJsonArray photos;
+		for (auto i = 0; i < 600; ++i)
+			photos.append(QJsonObject { { "cid", ++cid }, { "geo", QJsonArray { 55.75, 37.59 } }, { "file", "a/b/c.jpg" }, { "year", 1900 } });
+		return QJsonDocument(QJsonObject { { "result", QJsonObject { { "photos", photos } } } }).toJson();
+	});
+	model = std::make_unique<BaseModel>(nullptr, QUrl("http://localhost/api2"), std::move(networkManager));
+
+	emit model->UpdateCoords(AREA);
+	WaitForItems();
+	ASSERT_TRUE(model->IsAreaLoaded(AREA));
+
+	emit model->UpdateCoords(QGeoPolygon({ { 48.87, 2.33 }, { 48.85, 2.33 }, { 48.85, 2.35 }, { 48.87, 2.35 } }));
+	WaitForItems();
+	EXPECT_EQ(model->rowCount(), MAX_ITEMS);
+	EXPECT_FALSE(model->IsAreaLoaded(AREA));
+}
+
+TEST_F(BaseModelTest, ViewportJoiningPrefetchIsNotSuperseded)
+{
+	model->Prefetch(AREA);
+	emit model->UpdateCoords(AREA);
+	const auto requests = requestCount;
+	ASSERT_GT(requests, 0);
+
+	// Prefetching elsewhere drops earlier prefetches, but the joined one is on screen now
+	model->Prefetch(QGeoPolygon({ { 48.87, 2.33 }, { 48.85, 2.33 }, { 48.85, 2.35 }, { 48.87, 2.35 } }));
+	WaitForItems();
+
+	EXPECT_EQ(model->rowCount(), 2);
+	EXPECT_TRUE(model->IsAreaLoaded(AREA));
+	EXPECT_EQ(model->GetRequestStats().inFlightHits, static_cast<quint64>(requests));
+}
+
+TEST_F(BaseModelTest, DownloadedAreaIsServedOffline)
+{
+	QTemporaryDir dir;
+	OfflineStore store(dir.path());
+	const auto photos = QJsonDocument::fromJson(PHOTOS_RESPONSE).object().value("result").toObject().value("photos").toArray();
+	for (const auto & tile : OfflineStore::TilesCovering(AREA.boundingGeoRectangle()))
+		ASSERT_TRUE(store.Store(tile, photos));
+	model->SetOfflineStore(&store);
+	// Request tiles are then the stored ones
+	model->setData({}, OfflineStore::TILE_ZOOM + 2, BaseModel::ZoomLevel);
+
+	emit model->UpdateCoords(AREA);
+	ASSERT_TRUE(WaitForLoadingFinished());
+	EXPECT_EQ(requestCount, 0);
+	EXPECT_EQ(model->rowCount(), 2);
+	EXPECT_GT(model->GetRequestStats().offlineHits, 0u);
+
+	// Served tiles count as loaded, the store is not read again
+	EXPECT_TRUE(model->IsAreaLoaded(AREA));
+	const auto offlineHits = model->GetRequestStats().offlineHits;
+	emit model->UpdateCoords(AREA);
+	EXPECT_EQ(model->GetRequestStats().offlineHits, offlineHits);
+}
@@ -1,9 +1,13 @@
+#include <cmath>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <QAbstractListModel>
 #include <QByteArray>
 #include <QCoreApplication>
 #include <QGeoCoordinate>
+#include <QGeoPolygon>
 #include <QGeoRectangle>
 #include <QHash>
 #include <QModelIndex>
@@ -28,6 +32,7 @@ public:
 		QGeoCoordinate coord;
 		int year;
 		int zoomLevel;
+		int bearing;
 	};
 
 	explicit MockSourceModel(QObject * parent = nullptr)
@@ -63,6 +68,10 @@ public:
 				return item.year;
 			case BaseModel::ZoomLevel:
 				return item.zoomLevel;
+			case BaseModel::Bearing:
+				return item.bearing;
+			case BaseModel::Thumbnail:
+				return QString("thumbnail%1").arg(item.cid);
 			default:
 				return {};
 		}
@@ -78,13 +87,33 @@ public:
 		};
 	}
 
-	void addItem(int cid, const QGeoCoordinate & coord, int year = 2000, int zoomLevel = 13)
+	void addItem(int cid, const QGeoCoordinate & coord, int year = 2000, int zoomLevel = 13, int bearing = 0)
 	{
 		beginInsertRows({}, static_cast<int>(m_items.size()), static_cast<int>(m_items.size()));
-		m_items.push_back({ cid, coord, year, zoomLevel });
+		m_items.push_back({ cid, coord, year, zoomLevel, bearing });
 		endInsertRows();
 	}
 
+	void insertItem(int row, int cid, const QGeoCoordinate & coord, int year = 2000, int zoomLevel = 13)
+	{
+		beginInsertRows({}, row, row);
+		m_items.insert(m_items.begin() + row, { cid, coord, year, zoomLevel, 0 });
+		endInsertRows();
+	}
+
+	void removeItem(int row)
+	{
+		beginRemoveRows({}, row, row);
+		m_items.erase(m_items.begin() + row);
+		endRemoveRows();
+	}
+
+	void setYear(int row, int year)
+	{
+		m_items[row].year = year;
+		emit dataChanged(index(row), index(row), { BaseModel::Year });
+	}
+
 	void setZoomLevel(int zoomLevel)
 	{
 		m_zoomLevel = zoomLevel;
@@ -168,6 +197,21 @@ TEST_F(ClusterModelTest, TwoItemsFarApart)
 	EXPECT_FALSE(clusterModel->data(clusterModel->index(1, 0), ClusterModel::IsCluster).toBool());
 }
 
+// Test that items in the corners of a rotated viewport's bounding rectangle are culled
+TEST_F(ClusterModelTest, VisibleAreaCullsOutsideItems)
+{
+	const QGeoRectangle viewport(QGeoCoordinate(56.0, 37.0), QGeoCoordinate(55.0, 38.0));
+	mockModel->addItem(1, QGeoCoordinate(55.5, 37.5), 2000);
+	mockModel->addItem(2, QGeoCoordinate(55.95, 37.05), 2000);
+
+	// Viewport rotated by 45 degrees, its corners touch the middle of the bounding rectangle's edges
+	clusterModel->SetVisibleArea(QGeoPolygon({ QGeoCoordinate(56.0, 37.5), QGeoCoordinate(55.5, 37.0), QGeoCoordinate(55.0, 37.5), QGeoCoordinate(55.5, 38.0) }));
+	clusterModel->OnViewportChanged(viewport);
+
+	ASSERT_EQ(clusterModel->rowCount(), 1);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(0, 0), BaseModel::Cid).toInt(), 1);
+}
+
 // Test ClusterModel with duplicate CIDs (should deduplicate)
 TEST_F(ClusterModelTest, DuplicateCids)
 {
@@ -205,6 +249,118 @@ TEST_F(ClusterModelTest, IndividualNodeData)
 	EXPECT_EQ(clusterModel->data(index, BaseModel::Cid).toInt(), 1);
 }
 
+// Test that nodes keep reading their own item after source rows shift, until the next rebuild
+TEST_F(ClusterModelTest, NodesFollowItemsAcrossSourceChanges)
+{
+	const QGeoRectangle viewport(QGeoCoordinate(56.0, 37.0), QGeoCoordinate(55.0, 38.0));
+	mockModel->addItem(1, QGeoCoordinate(55.1, 37.1), 1900);
+	mockModel->addItem(2, QGeoCoordinate(55.9, 37.9), 2000);
+	clusterModel->OnViewportChanged(viewport);
+	ASSERT_EQ(clusterModel->rowCount(), 2);
+
+	mockModel->insertItem(0, 3, QGeoCoordinate(55.5, 37.5), 1950);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(0, 0), BaseModel::Cid).toInt(), 1);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(0, 0), BaseModel::Year).toInt(), 1900);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(1, 0), BaseModel::Year).toInt(), 2000);
+
+	mockModel->removeItem(1);
+	EXPECT_FALSE(clusterModel->data(clusterModel->index(0, 0), BaseModel::Cid).isValid());
+	EXPECT_EQ(clusterModel->data(clusterModel->index(1, 0), BaseModel::Cid).toInt(), 2);
+}
+
+// Test that a cluster's aggregates cover all its members
+TEST_F(ClusterModelTest, ClusterAggregates)
+{
+	const QGeoRectangle viewport(QGeoCoordinate(56.0, 37.0), QGeoCoordinate(55.0, 38.0));
+	mockModel->addItem(1, QGeoCoordinate(55.5000, 37.5000), 1950, 13, 90);
+	mockModel->addItem(2, QGeoCoordinate(55.5001, 37.5001), 1900, 13, 180);
+	mockModel->addItem(3, QGeoCoordinate(55.5002, 37.5002), 1920, 13, 90);
+	clusterModel->OnViewportChanged(viewport);
+
+	ASSERT_EQ(clusterModel->rowCount(), 1);
+	const auto index = clusterModel->index(0, 0);
+	ASSERT_TRUE(clusterModel->data(index, ClusterModel::IsCluster).toBool());
+	EXPECT_EQ(clusterModel->data(index, ClusterModel::CidsInCluster).toList(), QVariantList({ 1, 2, 3 }));
+	EXPECT_EQ(clusterModel->data(index, ClusterModel::ClusterYearFrom).toInt(), 1900);
+	EXPECT_EQ(clusterModel->data(index, ClusterModel::ClusterYearTo).toInt(), 1950);
+	EXPECT_EQ(clusterModel->data(index, ClusterModel::ClusterBearing).toInt(), 90);
+	EXPECT_EQ(clusterModel->data(index, ClusterModel::ClusterThumbnail).toString(), "thumbnail2");
+}
+
+// Test that a cluster straddling the antimeridian is centered on it, not on the other side of the globe
+TEST_F(ClusterModelTest, CentroidAcrossAntimeridian)
+{
+	const QGeoRectangle viewport(QGeoCoordinate(11.0, 179.5), QGeoCoordinate(9.0, -179.5));
+	mockModel->addItem(1, QGeoCoordinate(10.0, 179.9999), 2000);
+	mockModel->addItem(2, QGeoCoordinate(10.0, -179.9999), 2000);
+	clusterModel->OnViewportChanged(viewport);
+
+	ASSERT_EQ(clusterModel->rowCount(), 1);
+	const auto index = clusterModel->index(0, 0);
+	ASSERT_TRUE(clusterModel->data(index, ClusterModel::IsCluster).toBool());
+	const auto centroid = clusterModel->data(index, BaseModel::Coordinate).value<QGeoCoordinate>();
+	EXPECT_NEAR(centroid.latitude(), 10.0, 1e-6);
+	EXPECT_GT(std::abs(centroid.longitude()), 179.999);
+}
+
+// Test that panning keeps the rows and centroids of unchanged nodes and only appends arriving ones
+TEST_F(ClusterModelTest, PanningKeepsUnchangedNodes)
+{
+	mockModel->addItem(1, QGeoCoordinate(55.5000, 37.5000), 2000);
+	mockModel->addItem(2, QGeoCoordinate(55.5001, 37.5001), 2000);
+	mockModel->addItem(3, QGeoCoordinate(55.1, 37.1), 2000);
+	clusterModel->OnViewportChanged(QGeoRectangle(QGeoCoordinate(56.0, 37.0), QGeoCoordinate(55.0, 38.0)));
+	ASSERT_EQ(clusterModel->rowCount(), 2);
+	const auto centroid = clusterModel->data(clusterModel->index(0, 0), BaseModel::Coordinate);
+
+	auto resets = 0;
+	auto inserted = 0;
+	auto removed = 0;
+	QObject::connect(clusterModel, &ClusterModel::modelReset, [&] { ++resets; });
+	QObject::connect(clusterModel, &ClusterModel::rowsInserted, [&](const QModelIndex &, int first, int last) { inserted += last - first + 1; });
+	QObject::connect(clusterModel, &ClusterModel::rowsRemoved, [&](const QModelIndex &, int first, int last) { removed += last - first + 1; });
+
+	mockModel->addItem(4, QGeoCoordinate(55.9, 37.9), 2000);
+	clusterModel->OnViewportChanged(QGeoRectangle(QGeoCoordinate(56.05, 37.05), QGeoCoordinate(55.05, 38.05)));
+
+	EXPECT_EQ(resets, 0);
+	EXPECT_EQ(removed, 0);
+	EXPECT_EQ(inserted, 1);
+	ASSERT_EQ(clusterModel->rowCount(), 3);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(0, 0), BaseModel::Coordinate), centroid);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(1, 0), BaseModel::Cid).toInt(), 3);
+	EXPECT_EQ(clusterModel->data(clusterModel->index(2, 0), BaseModel::Cid).toInt(), 4);
+}
+
+// Test that a source item's changes reach the row of the node holding it, with the aggregates following
+TEST_F(ClusterModelTest, SourceDataChangedReachesNodeRows)
+{
+	mockModel->addItem(1, QGeoCoordinate(55.1, 37.1), 2000);
+	mockModel->addItem(2, QGeoCoordinate(55.5000, 37.5000), 2000);
+	mockModel->addItem(3, QGeoCoordinate(55.5001, 37.5001), 2000);
+	clusterModel->OnViewportChanged(QGeoRectangle(QGeoCoordinate(56.0, 37.0), QGeoCoordinate(55.0, 38.0)));
+	ASSERT_EQ(clusterModel->rowCount(), 2);
+	const auto clusterRow = clusterModel->data(clusterModel->index(0, 0), ClusterModel::IsCluster).toBool() ? 0 : 1;
+
+	std::vector<std::pair<int, int>> changedRows;
+	QList<int> changedRoles;
+	QObject::connect(clusterModel, &ClusterModel::dataChanged, [&](const QModelIndex & topLeft, const QModelIndex & bottomRight, const QList<int> & roles) {
+		changedRows.emplace_back(topLeft.row(), bottomRight.row());
+		changedRoles = roles;
+	});
+
+	mockModel->setYear(2, 1990);
+	ASSERT_EQ(changedRows.size(), 1);
+	EXPECT_EQ(changedRows.front(), std::pair(clusterRow, clusterRow));
+	EXPECT_TRUE(changedRoles.contains(BaseModel::Year));
+	EXPECT_TRUE(changedRoles.contains(ClusterModel::ClusterYearFrom));
+
+	changedRows.clear();
+	mockModel->setYear(0, 1990);
+	ASSERT_EQ(changedRows.size(), 1);
+	EXPECT_EQ(changedRows.front(), std::pair(1 - clusterRow, 1 - clusterRow));
+}
+
 // Test ClusterModel with viewport change
 TEST_F(ClusterModelTest, ViewportChange)
 {
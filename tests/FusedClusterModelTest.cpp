@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QGeoCoordinate>
+#include <QGeoPolygon>
+#include <QGeoRectangle>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+
+#include "App/Models/BaseModel.h"
+#include "App/Models/ClusterModel.h"
+#include "App/Models/FusedClusterModel.h"
+#include "App/Models/ScreenObjectsModel.h"
+#include "App/Utils/Range.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+namespace {
+
+struct Photo
+{
+	int cid;
+	double lat;
+	double lon;
+	int year;
+};
+
+// Two groups a few meters across and loose items around them, years on both ends of the timeline
+const std::vector<Photo> PHOTOS {
+	{ 1, 55.75000, 37.60000, 1900 },
+	{ 2, 55.75001, 37.60001, 1920 },
+	{ 3, 55.75002, 37.60000, 1950 },
+	{ 4, 55.75000, 37.60002, 1800 },
+	{ 5, 55.74000, 37.59000, 1880 },
+	{ 6, 55.74001, 37.59001, 2000 },
+	{ 7, 55.74001, 37.59000, 1930 },
+	{ 8, 55.76000, 37.61000, 1910 },
+	{ 9, 55.73000, 37.62000, 1851 },
+	{ 10, 55.75500, 37.58000, 1960 },
+};
+
+const QGeoPolygon AREA({ { 55.77, 37.57 }, { 55.72, 37.57 }, { 55.72, 37.63 }, { 55.77, 37.63 } });
+const QGeoRectangle VIEWPORT({ 55.77, 37.57 }, { 55.72, 37.63 });
+
+QByteArray PhotosResponse(const std::vector<Photo> & photos)
+{
+	QJsonArray array;
+	for (const auto & photo : photos)
+		array.append(QJsonObject { { "cid", photo.cid }, { "geo", QJsonArray { photo.lat, photo.lon } }, { "file", "a/b/c.jpg" }, { "year", photo.year } });
+	return QJsonDocument(QJsonObject { { "result", QJsonObject { { "photos", array } } } }).toJson();
+}
+
+// What the map shows of a node, independent of the order nodes and members were built in
+struct Marker
+{
+	std::vector<int> cids;
+	int yearFrom;
+	int yearTo;
+	double latitude;
+	double longitude;
+
+	auto operator<=>(const Marker &) const = default;
+};
+
+std::vector<Marker> Markers(const QAbstractItemModel & model)
+{
+	std::vector<Marker> markers;
+	for (int row = 0; row < model.rowCount(); ++row)
+	{
+		const auto index = model.index(row, 0);
+		std::vector<int> cids;
+		if (model.data(index, ClusterModel::IsCluster).toBool())
+		{
+			for (const auto & cid : model.data(index, ClusterModel::CidsInCluster).toList())
+				cids.push_back(cid.toInt());
+		}
+		else
+		{
+			cids.push_back(model.data(index, BaseModel::Cid).toInt());
+		}
+		std::ranges::sort(cids);
+		EXPECT_EQ(model.data(index, ClusterModel::ClusterCount).toInt(), static_cast<int>(cids.size()));
+
+		const auto coordinate = model.data(index, BaseModel::Coordinate).value<QGeoCoordinate>();
+		markers.push_back({
+			.cids = std::move(cids),
+			.yearFrom = model.data(index, ClusterModel::ClusterYearFrom).toInt(),
+			.yearTo = model.data(index, ClusterModel::ClusterYearTo).toInt(),
+			// Centroids are sums in a different order
+			.latitude = std::round(coordinate.latitude() * 1e7) / 1e7,
+			.longitude = std::round(coordinate.longitude() * 1e7) / 1e7,
+		});
+	}
+	std::ranges::sort(markers);
+	return markers;
+}
+
+}
+
+class FusedClusterModelTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance())
+		{
+			static int argc = 1;
+			static char * argv[] = { const_cast<char *>("test") };
+			app = std::make_unique<QCoreApplication>(argc, argv);
+		}
+
+		auto networkManager = std::make_unique<FixtureNetworkAccessManager>([this](const QUrl &) { return PhotosResponse(photos); });
+		baseModel = std::make_unique<BaseModel>(nullptr, QUrl("http://localhost/api2"), std::move(networkManager));
+		Load();
+
+		screenObjectsModel = std::make_unique<ScreenObjectsModel>(baseModel.get());
+		clusterModel = std::make_unique<ClusterModel>(screenObjectsModel.get());
+		fusedClusterModel = std::make_unique<FusedClusterModel>(baseModel.get(), nullptr);
+		fusedClusterModel->SetNearestObjectsOnly(false);
+		SetTimeline({ 1850, 1950 });
+	}
+
+	void TearDown() override
+	{
+		fusedClusterModel.reset();
+		clusterModel.reset();
+		screenObjectsModel.reset();
+		baseModel.reset();
+		app.reset();
+	}
+
+	// Spins the event loop until every reply for the area is in the base model
+	void Load(const QGeoPolygon & area = AREA)
+	{
+		QSignalSpy loadingFinished(baseModel.get(), &BaseModel::LoadingFinished);
+		emit baseModel->UpdateCoords(area);
+		ASSERT_TRUE(loadingFinished.wait(1000));
+	}
+
+	void SetTimeline(const Range & timeline)
+	{
+		screenObjectsModel->OnUserSelectedTimelineRangeChanged(timeline);
+		fusedClusterModel->OnUserSelectedTimelineRangeChanged(timeline);
+	}
+
+	// What the controller's scheduler does for both pipelines
+	void Rebuild()
+	{
+		clusterModel->OnViewportChanged(VIEWPORT);
+		fusedClusterModel->OnViewportChanged(VIEWPORT);
+	}
+
+	std::unique_ptr<QCoreApplication> app;
+	std::vector<Photo> photos { PHOTOS };
+	std::unique_ptr<BaseModel> baseModel;
+	std::unique_ptr<ScreenObjectsModel> screenObjectsModel;
+	std::unique_ptr<ClusterModel> clusterModel;
+	std::unique_ptr<FusedClusterModel> fusedClusterModel;
+};
+
+TEST_F(FusedClusterModelTest, MatchesProxyChainAcrossZooms)
+{
+	ASSERT_EQ(baseModel->rowCount(), static_cast<int>(PHOTOS.size()));
+
+	for (const auto zoomLevel : { 10, 14, 18, 21 })
+	{
+		baseModel->setData({}, zoomLevel, BaseModel::ZoomLevel);
+		Rebuild();
+
+		const auto expected = Markers(*clusterModel);
+		ASSERT_FALSE(expected.empty());
+		EXPECT_EQ(Markers(*fusedClusterModel), expected) << "zoom " << zoomLevel;
+	}
+}
+
+TEST_F(FusedClusterModelTest, MatchesProxyChainAfterTimelineChange)
+{
+	baseModel->setData({}, 18, BaseModel::ZoomLevel);
+
+	// Ranges are (min, max], so 1800 and 1950 swap places with 1851 and 2000
+	for (const auto & timeline : { Range { 1800, 1900 }, Range { 1950, 2000 }, Range { 1700, 2100 } })
+	{
+		SetTimeline(timeline);
+		Rebuild();
+		EXPECT_EQ(Markers(*fusedClusterModel), Markers(*clusterModel)) << timeline.min << "-" << timeline.max;
+	}
+}
+
+TEST_F(FusedClusterModelTest, ReplyOnlyMarksNodesStale)
+{
+	baseModel->setData({}, 18, BaseModel::ZoomLevel);
+	Rebuild();
+	const auto before = Markers(*fusedClusterModel);
+
+	QSignalSpy sourceChanged(fusedClusterModel.get(), &FusedClusterModel::SourceChanged);
+	QSignalSpy resets(fusedClusterModel.get(), &QAbstractItemModel::modelReset);
+	photos.push_back({ 11, 55.76500, 37.59500, 1940 });
+	Load(QGeoPolygon({ { 48.87, 2.33 }, { 48.85, 2.33 }, { 48.85, 2.35 }, { 48.87, 2.35 } }));
+	ASSERT_EQ(baseModel->rowCount(), static_cast<int>(photos.size()));
+
+	// Left to the owner's next rebuild, the old nodes still read their own items
+	EXPECT_GE(sourceChanged.count(), 1);
+	EXPECT_EQ(resets.count(), 0);
+	EXPECT_EQ(Markers(*fusedClusterModel), before);
+
+	Rebuild();
+	EXPECT_EQ(resets.count(), 1);
+	EXPECT_EQ(Markers(*fusedClusterModel), Markers(*clusterModel));
+	EXPECT_EQ(fusedClusterModel->rowCount(), static_cast<int>(before.size()) + 1);
+}
+
+TEST_F(FusedClusterModelTest, AnnouncesSameZoomsAsProxyChain)
+{
+	baseModel->setData({}, 14, BaseModel::ZoomLevel);
+	QSignalSpy chainZooms(clusterModel.get(), &ClusterModel::ZoomsToDecluster);
+	QSignalSpy fusedZooms(fusedClusterModel.get(), &FusedClusterModel::ZoomsToDecluster);
+	Rebuild();
+
+	ASSERT_EQ(chainZooms.count(), 1);
+	ASSERT_EQ(fusedZooms.count(), 1);
+	const auto expected = chainZooms.front().front().value<QHash<int, int>>();
+	ASSERT_FALSE(expected.isEmpty());
+	EXPECT_EQ(fusedZooms.front().front().value<QHash<int, int>>(), expected);
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "App/Models/GeoGrid.h"
+
+namespace {
+
+constexpr auto RADIUS_METERS = 4000.0;
+
+double HaversineMeters(double lat1, double lon1, double lat2, double lon2)
+{
+	constexpr auto toRad = std::numbers::pi / 180.0;
+	const auto dLat = (lat2 - lat1) * toRad;
+	const auto dLon = (lon2 - lon1) * toRad;
+	const auto a = std::sin(dLat / 2) * std::sin(dLat / 2)
+				 + std::cos(lat1 * toRad) * std::cos(lat2 * toRad) * std::sin(dLon / 2) * std::sin(dLon / 2);
+	return 2 * GeoMath::EARTH_RADIUS_METERS * std::asin(std::sqrt(a));
+}
+
+std::set<int> Candidates(const GeoGrid & grid, double lat, double lon, double radius)
+{
+	std::set<int> rows;
+	grid.ForEachCandidate(lat, lon, radius, [&](const GeoGrid::Point & point) { rows.insert(point.row); });
+	return rows;
+}
+
+struct TestPoint
+{
+	double lat;
+	double lon;
+};
+
+// Every point within the radius has to be among the candidates
+void ExpectNoMissedPoints(const std::vector<TestPoint> & points, double lat, double lon)
+{
+	GeoGrid grid(RADIUS_METERS);
+	for (int i = 0; i < static_cast<int>(points.size()); ++i)
+		grid.Insert(i, points[i].lat, points[i].lon);
+
+	const auto candidates = Candidates(grid, lat, lon, RADIUS_METERS);
+	for (int i = 0; i < static_cast<int>(points.size()); ++i)
+	{
+		if (HaversineMeters(lat, lon, points[i].lat, points[i].lon) <= RADIUS_METERS)
+			EXPECT_TRUE(candidates.contains(i)) << "missed point " << i;
+	}
+}
+
+std::vector<TestPoint> RandomPointsAround(double lat, double lon, double spreadDegrees, int count)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<double> offset(-spreadDegrees, spreadDegrees);
+	std::vector<TestPoint> points;
+	for (int i = 0; i < count; ++i)
+	{
+		auto pointLon = lon + offset(rng);
+		if (pointLon >= 180.0)
+			pointLon -= 360.0;
+		if (pointLon < -180.0)
+			pointLon += 360.0;
+		points.push_back({ std::clamp(lat + offset(rng), -89.9, 89.9), pointLon });
+	}
+	return points;
+}
+
+}
+
+class GeoGridTest : public ::testing::Test
+{
+};
+
+TEST_F(GeoGridTest, EmptyGrid)
+{
+	GeoGrid grid(RADIUS_METERS);
+	EXPECT_EQ(grid.Size(), 0);
+	EXPECT_TRUE(Candidates(grid, 55.75, 37.61, RADIUS_METERS).empty());
+}
+
+TEST_F(GeoGridTest, FarPointsAreNotCandidates)
+{
+	GeoGrid grid(RADIUS_METERS);
+	grid.Insert(0, 55.75, 37.61);
+	grid.Insert(1, 59.93, 30.33);
+	EXPECT_EQ(grid.Size(), 2);
+
+	EXPECT_EQ(Candidates(grid, 55.751, 37.612, RADIUS_METERS), (std::set<int> { 0 }));
+}
+
+TEST_F(GeoGridTest, NoMissedPointsMidLatitude)
+{
+	ExpectNoMissedPoints(RandomPointsAround(55.75, 37.61, 0.2, 2000), 55.75, 37.61);
+}
+
+TEST_F(GeoGridTest, NoMissedPointsHighLatitude)
+{
+	ExpectNoMissedPoints(RandomPointsAround(78.22, 15.65, 0.5, 2000), 78.22, 15.65);
+}
+
+TEST_F(GeoGridTest, NoMissedPointsAcrossAntimeridian)
+{
+	ExpectNoMissedPoints(RandomPointsAround(-16.5, 179.99, 0.2, 2000), -16.5, 179.99);
+	ExpectNoMissedPoints(RandomPointsAround(-16.5, -179.99, 0.2, 2000), -16.5, -179.99);
+}
+
+TEST_F(GeoGridTest, ClearRemovesPoints)
+{
+	GeoGrid grid(RADIUS_METERS);
+	grid.Insert(0, 55.75, 37.61);
+	grid.Clear();
+	EXPECT_EQ(grid.Size(), 0);
+	EXPECT_TRUE(Candidates(grid, 55.75, 37.61, RADIUS_METERS).empty());
+}
+
+TEST_F(GeoGridTest, RowsFollowInsertsAndRemoves)
+{
+	GeoGrid grid(RADIUS_METERS);
+	grid.Insert(0, 55.750, 37.610);
+	grid.Insert(1, 55.751, 37.611);
+	grid.Insert(2, 59.930, 30.330);
+
+	// A row inserted in front of row 1
+	grid.InsertRows(1, 1);
+	grid.Insert(1, 55.752, 37.612);
+	EXPECT_EQ(grid.Size(), 4);
+	EXPECT_EQ(Candidates(grid, 55.75, 37.61, RADIUS_METERS), (std::set<int> { 0, 1, 2 }));
+	EXPECT_EQ(Candidates(grid, 59.93, 30.33, RADIUS_METERS), (std::set<int> { 3 }));
+
+	grid.RemoveRows(0, 1);
+	EXPECT_EQ(grid.Size(), 2);
+	EXPECT_EQ(Candidates(grid, 55.75, 37.61, RADIUS_METERS), (std::set<int> { 0 }));
+	EXPECT_EQ(Candidates(grid, 59.93, 30.33, RADIUS_METERS), (std::set<int> { 1 }));
+}
+
+TEST_F(GeoGridTest, EquirectangularMatchesHaversineAtCityScale)
+{
+	const auto haversine = HaversineMeters(55.75, 37.61, 55.78, 37.65);
+	const auto equirectangular = GeoMath::EquirectangularDistanceMeters(55.75, 37.61, 55.78, 37.65);
+	EXPECT_NEAR(equirectangular, haversine, 1.0);
+
+	// Across the antimeridian
+	EXPECT_NEAR(GeoMath::EquirectangularDistanceMeters(0.0, 179.99, 0.0, -179.99), HaversineMeters(0.0, 179.99, 0.0, -179.99), 1.0);
+}
+
+TEST_F(GeoGridTest, NearestMatchesBruteForce)
+{
+	const auto points = RandomPointsAround(55.75, 37.61, 0.1, 2000);
+	GeoGrid grid(RADIUS_METERS);
+	for (int i = 0; i < static_cast<int>(points.size()); ++i)
+		grid.Insert(i, points[i].lat, points[i].lon);
+
+	std::vector<std::pair<double, int>> expected;
+	for (int i = 0; i < static_cast<int>(points.size()); ++i)
+	{
+		const auto distance = HaversineMeters(55.75, 37.61, points[i].lat, points[i].lon);
+		if (distance <= RADIUS_METERS - 1.0)
+			expected.emplace_back(distance, i);
+	}
+	std::ranges::sort(expected);
+	ASSERT_GT(expected.size(), 20);
+
+	const auto nearest = grid.Nearest(55.75, 37.61, RADIUS_METERS, 20);
+	ASSERT_EQ(nearest.size(), 20);
+	for (size_t i = 0; i < nearest.size(); ++i)
+	{
+		EXPECT_EQ(nearest[i].row, expected[i].second);
+		EXPECT_NEAR(nearest[i].distanceMeters, expected[i].first, 1.0);
+	}
+
+	EXPECT_TRUE(std::ranges::is_sorted(grid.Nearest(55.75, 37.61, RADIUS_METERS), {}, &GeoGrid::Neighbor::distanceMeters));
+}
+
+TEST_F(GeoGridTest, NearestStaysWithinRadius)
+{
+	GeoGrid grid(RADIUS_METERS);
+	grid.Insert(0, 0.0, 179.99);
+	grid.Insert(1, 0.0, -179.99);
+	grid.Insert(2, 1.0, 179.99);
+
+	const auto nearest = grid.Nearest(0.0, 179.995, RADIUS_METERS);
+	ASSERT_EQ(nearest.size(), 2);
+	EXPECT_EQ(nearest[0].row, 0);
+	EXPECT_EQ(nearest[1].row, 1);
+}
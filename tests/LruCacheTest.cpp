@@ -0,0 +1,57 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "App/Utils/LruCache.h"
+
+TEST(LruCacheTest, EvictsLeastRecentlyUsed)
+{
+	LruCache<std::string, int> cache(3);
+	cache.Insert("a", 1, 1);
+	cache.Insert("b", 2, 1);
+	cache.Insert("c", 3, 1);
+
+	// Using "a" leaves "b" as the oldest
+	ASSERT_NE(cache.Find("a"), nullptr);
+	EXPECT_EQ(cache.Insert("d", 4, 1), std::vector<std::string> { "b" });
+
+	EXPECT_FALSE(cache.Contains("b"));
+	EXPECT_EQ(*cache.Find("a"), 1);
+	EXPECT_EQ(cache.Size(), 3);
+}
+
+TEST(LruCacheTest, CostBoundsTheCache)
+{
+	LruCache<std::string, int> cache(10);
+	cache.Insert("small", 1, 2);
+	cache.Insert("medium", 2, 5);
+	EXPECT_EQ(cache.Cost(), 7);
+
+	// Replacing an entry drops its previous cost
+	cache.Insert("medium", 3, 6);
+	EXPECT_EQ(cache.Cost(), 8);
+	EXPECT_EQ(*cache.Find("medium"), 3);
+
+	EXPECT_EQ(cache.Insert("large", 4, 5), (std::vector<std::string> { "small", "medium" }));
+	EXPECT_EQ(cache.Cost(), 5);
+
+	EXPECT_EQ(cache.Insert("huge", 5, 11), (std::vector<std::string> { "large", "huge" }));
+	EXPECT_EQ(cache.Size(), 0);
+	EXPECT_EQ(cache.Cost(), 0);
+}
+
+TEST(LruCacheTest, EraseAndClear)
+{
+	LruCache<int, int> cache(10);
+	cache.Insert(1, 1, 4);
+	cache.Insert(2, 2, 4);
+
+	EXPECT_TRUE(cache.Erase(1));
+	EXPECT_FALSE(cache.Erase(1));
+	EXPECT_EQ(cache.Cost(), 4);
+
+	cache.Clear();
+	EXPECT_EQ(cache.Find(2), nullptr);
+	EXPECT_EQ(cache.Cost(), 0);
+}
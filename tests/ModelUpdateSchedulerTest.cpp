@@ -0,0 +1,110 @@
+#include <memory>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QObject>
+
+#include <gtest/gtest.h>
+
+#include "App/Controllers/ModelController/ModelUpdateScheduler.h"
+
+class ModelUpdateSchedulerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance())
+		{
+			static int argc = 1;
+			static char * argv[] = { const_cast<char *>("test") };
+			app = std::make_unique<QCoreApplication>(argc, argv);
+		}
+
+		scheduler = std::make_unique<ModelUpdateScheduler>();
+		scheduler->Register(&first, [this] { rebuilt.push_back(&first); }, [this] { return firstActive; });
+		scheduler->Register(&second, [this] { rebuilt.push_back(&second); }, [this] { return secondActive; });
+	}
+
+	void TearDown() override
+	{
+		scheduler.reset();
+		app.reset();
+	}
+
+	// Returns control to the event loop for one turn, as after a slot returns
+	void Spin()
+	{
+		QCoreApplication::processEvents();
+	}
+
+	std::unique_ptr<QCoreApplication> app;
+	QObject first;
+	QObject second;
+	bool firstActive { true };
+	bool secondActive { true };
+	std::vector<const QObject *> rebuilt;
+	std::unique_ptr<ModelUpdateScheduler> scheduler;
+};
+
+TEST_F(ModelUpdateSchedulerTest, MarksInOneTurnCoalesceIntoOneRebuild)
+{
+	scheduler->MarkDirty(&second);
+	scheduler->MarkDirty(&first);
+	scheduler->MarkDirty(&second);
+	scheduler->MarkAllDirty();
+
+	// Nothing runs before control returns to the loop
+	EXPECT_TRUE(rebuilt.empty());
+
+	Spin();
+	// Once each, in registration order
+	EXPECT_EQ(rebuilt, (std::vector<const QObject *> { &first, &second }));
+
+	Spin();
+	EXPECT_EQ(rebuilt.size(), 2);
+}
+
+TEST_F(ModelUpdateSchedulerTest, OnlyDirtyModelsAreRebuilt)
+{
+	scheduler->MarkDirty(&second);
+	Spin();
+
+	EXPECT_EQ(rebuilt, (std::vector<const QObject *> { &second }));
+}
+
+TEST_F(ModelUpdateSchedulerTest, InactiveModelIsSkippedUntilActivated)
+{
+	secondActive = false;
+	scheduler->MarkAllDirty();
+	Spin();
+	EXPECT_EQ(rebuilt, (std::vector<const QObject *> { &first }));
+
+	// Still dirty, caught up once active again
+	secondActive = true;
+	scheduler->OnActiveModelsChanged();
+	EXPECT_EQ(rebuilt.size(), 1);
+	Spin();
+	EXPECT_EQ(rebuilt, (std::vector<const QObject *> { &first, &second }));
+
+	// Activating without changes rebuilds nothing
+	scheduler->OnActiveModelsChanged();
+	Spin();
+	EXPECT_EQ(rebuilt.size(), 2);
+}
+
+TEST_F(ModelUpdateSchedulerTest, RebuildMarkingItselfDirtyRunsNextTurn)
+{
+	QObject model;
+	auto rebuilds = 0;
+	scheduler->Register(&model, [&] {
+		if (++rebuilds == 1)
+			scheduler->MarkDirty(&model);
+	}, [] { return true; });
+
+	scheduler->MarkDirty(&model);
+	Spin();
+	EXPECT_EQ(rebuilds, 1);
+
+	Spin();
+	EXPECT_EQ(rebuilds, 2);
+}
@@ -0,0 +1,93 @@
+#include <QGeoCoordinate>
+#include <QGeoRectangle>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <gtest/gtest.h>
+
+#include "App/Models/OfflineStore.h"
+
+namespace {
+
+QJsonArray PhotosAt(int cid, double lat, double lon)
+{
+	return { QJsonObject { { "cid", cid }, { "geo", QJsonArray { lat, lon } } } };
+}
+
+// Within a single stored tile
+const QGeoRectangle SMALL_AREA(QGeoCoordinate(55.7520, 37.6150), QGeoCoordinate(55.7510, 37.6160));
+
+}
+
+class OfflineStoreTest : public ::testing::Test
+{
+protected:
+	QTemporaryDir dir;
+};
+
+TEST_F(OfflineStoreTest, StoredTilesSurviveReopening)
+{
+	const auto tile = TileGrid::TileAt(55.7515, 37.6155, OfflineStore::TILE_ZOOM);
+	{
+		OfflineStore store(dir.path());
+		ASSERT_TRUE(store.Store(tile, PhotosAt(1, 55.7515, 37.6155)));
+	}
+
+	const OfflineStore store(dir.path());
+	EXPECT_TRUE(store.Contains(tile));
+	EXPECT_EQ(store.TileCount(), 1);
+	EXPECT_GT(store.SizeBytes(), 0);
+	EXPECT_EQ(store.AverageTileBytes(), store.SizeBytes());
+}
+
+TEST_F(OfflineStoreTest, AreaNeedsEveryCoveringTile)
+{
+	OfflineStore store(dir.path());
+	const QGeoRectangle region(QGeoCoordinate(55.76, 37.60), QGeoCoordinate(55.74, 37.64));
+	const auto tiles = OfflineStore::TilesCovering(region);
+	ASSERT_GT(tiles.size(), 1);
+
+	for (size_t i = 0; i + 1 < tiles.size(); ++i)
+		ASSERT_TRUE(store.Store(tiles[i], {}));
+	EXPECT_FALSE(store.Files(region).has_value());
+
+	ASSERT_TRUE(store.Store(tiles.back(), PhotosAt(7, 55.75, 37.62)));
+	const auto files = store.Files(region);
+	ASSERT_TRUE(files.has_value());
+	const auto photos = OfflineStore::ReadPhotos(*files);
+	ASSERT_TRUE(photos.has_value());
+	ASSERT_EQ(photos->size(), 1);
+	EXPECT_EQ(photos->at(0).toObject().value("cid").toInt(), 7);
+}
+
+TEST_F(OfflineStoreTest, TileOfAnyZoomNeedsEveryStoredTileWithin)
+{
+	OfflineStore store(dir.path());
+	const auto coarse = TileGrid::TileAt(55.75, 37.62, OfflineStore::TILE_ZOOM - 1);
+	const TileGrid::Tile fine { OfflineStore::TILE_ZOOM + 2, coarse.x * 8 + 1, coarse.y * 8 + 1 };
+
+	ASSERT_TRUE(store.Store({ OfflineStore::TILE_ZOOM, coarse.x * 2, coarse.y * 2 }, {}));
+	EXPECT_TRUE(store.Files(fine).has_value());
+	EXPECT_FALSE(store.Files(coarse).has_value());
+
+	for (const auto dy : { 0, 1 })
+		for (const auto dx : { 0, 1 })
+			ASSERT_TRUE(store.Store({ OfflineStore::TILE_ZOOM, coarse.x * 2 + dx, coarse.y * 2 + dy }, {}));
+	const auto files = store.Files(coarse);
+	ASSERT_TRUE(files.has_value());
+	EXPECT_EQ(files->size(), 4);
+}
+
+TEST_F(OfflineStoreTest, ClearRemovesEverything)
+{
+	OfflineStore store(dir.path());
+	for (const auto & tile : OfflineStore::TilesCovering(SMALL_AREA))
+		ASSERT_TRUE(store.Store(tile, PhotosAt(1, 55.7515, 37.6155)));
+	ASSERT_TRUE(store.Files(SMALL_AREA).has_value());
+
+	store.Clear();
+	EXPECT_FALSE(store.Files(SMALL_AREA).has_value());
+	EXPECT_EQ(store.SizeBytes(), 0);
+	EXPECT_EQ(OfflineStore(dir.path()).TileCount(), 0);
+}
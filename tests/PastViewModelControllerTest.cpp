@@ -0,0 +1,157 @@
+#include <memory>
+
+#include <QCoreApplication>
+#include <QGeoPolygon>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+
+#include "App/Controllers/ModelController/PastViewModelController.h"
+#include "App/Models/BaseModel.h"
+#include "App/Models/ClusterModel.h"
+#include "Support/FakePositionSource.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+namespace {
+
+constexpr auto PHOTOS_RESPONSE = R"({"result":{"photos":[
+	{"cid":1,"geo":[55.751,37.611],"file":"a/b/1.jpg","title":"First","dir":"n","year":1900},
+	{"cid":2,"geo":[55.752,37.612],"file":"a/b/2.jpg","title":"Second","dir":"s","year":1950}
+]}})";
+
+constexpr auto ZOOM_LEVEL = 14;
+// Longer than the controller's fetch debounce
+constexpr auto SETTLE_MS = 400;
+
+QGeoPolygon Area(const QGeoCoordinate & center, double halfSpanDegrees)
+{
+	const auto north = center.latitude() + halfSpanDegrees;
+	const auto south = center.latitude() - halfSpanDegrees;
+	const auto west = center.longitude() - halfSpanDegrees;
+	const auto east = center.longitude() + halfSpanDegrees;
+	return QGeoPolygon({ { north, west }, { south, west }, { south, east }, { north, east } });
+}
+
+const QGeoCoordinate CENTER(55.751, 37.611);
+
+}
+
+class PastViewModelControllerTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance())
+		{
+			static int argc = 1;
+			static char * argv[] = { const_cast<char *>("test") };
+			app = std::make_unique<QCoreApplication>(argc, argv);
+		}
+
+		settings = std::make_unique<QSettings>(dir.filePath("settings.ini"), QSettings::IniFormat);
+
+		auto source = std::make_unique<FakePositionSource>();
+		auto networkManager = std::make_unique<FixtureNetworkAccessManager>([](const QUrl &) { return QByteArray(PHOTOS_RESPONSE); });
+		auto model = std::make_unique<BaseModel>(source.get(), QUrl("http://localhost/api2"), std::move(networkManager));
+		baseModel = model.get();
+		controller = std::make_unique<PastVuModelController>(std::move(source), std::move(model), *settings);
+		controller->setProperty("zoomLevel", ZOOM_LEVEL);
+
+		// Every rebuild of the screen cluster model announces the zooms of its items
+		const auto * clusterModel = qobject_cast<const ClusterModel *>(controller->property("clusteredModel").value<QAbstractItemModel *>());
+		ASSERT_NE(clusterModel, nullptr);
+		rebuilds = std::make_unique<QSignalSpy>(clusterModel, &ClusterModel::ZoomsToDecluster);
+		fetches = std::make_unique<QSignalSpy>(baseModel, &BaseModel::UpdateCoords);
+		loadings = std::make_unique<QSignalSpy>(baseModel, &BaseModel::LoadingItems);
+	}
+
+	void TearDown() override
+	{
+		loadings.reset();
+		fetches.reset();
+		rebuilds.reset();
+		controller.reset();
+		settings.reset();
+		app.reset();
+	}
+
+	// Shows the area and waits for its items
+	void Load(const QGeoPolygon & area)
+	{
+		QSignalSpy loadingFinished(baseModel, &BaseModel::LoadingFinished);
+		controller->SetViewportArea(area);
+		ASSERT_TRUE(loadingFinished.wait(2000));
+		QTest::qWait(50);
+		ASSERT_TRUE(baseModel->IsAreaLoaded(area));
+		rebuilds->clear();
+		fetches->clear();
+		loadings->clear();
+	}
+
+	std::unique_ptr<QCoreApplication> app;
+	QTemporaryDir dir;
+	std::unique_ptr<QSettings> settings;
+	BaseModel * baseModel { nullptr };
+	std::unique_ptr<PastVuModelController> controller;
+	std::unique_ptr<QSignalSpy> rebuilds;
+	std::unique_ptr<QSignalSpy> fetches;
+	std::unique_ptr<QSignalSpy> loadings;
+};
+
+TEST_F(PastViewModelControllerTest, ViewportBurstIsClusteredOnceAndFetchedOnce)
+{
+	const auto area = Area(CENTER, 0.01);
+	for (auto i = 0; i < 10; ++i)
+		controller->SetViewportArea(area);
+
+	// Throttled to the next frame, not once per call
+	EXPECT_EQ(rebuilds->count(), 0);
+	QTest::qWait(50);
+	EXPECT_EQ(rebuilds->count(), 1);
+	EXPECT_EQ(fetches->count(), 0);
+
+	// Fetched once the viewport settled
+	QTest::qWait(SETTLE_MS);
+	ASSERT_EQ(fetches->count(), 1);
+	EXPECT_EQ(fetches->front().front().value<QGeoPolygon>(), area);
+}
+
+TEST_F(PastViewModelControllerTest, ContinuousPanKeepsClusteringAndFetchesWhereItStops)
+{
+	// Slow enough not to prefetch ahead, faster than the debounce
+	QGeoPolygon area;
+	for (auto i = 0; i < 6; ++i)
+	{
+		area = Area({ CENTER.latitude(), CENTER.longitude() + 0.0002 * i }, 0.01);
+		controller->SetViewportArea(area);
+		QTest::qWait(40);
+	}
+
+	// Clusters follow the pan while requests wait for it to end
+	EXPECT_GE(rebuilds->count(), 2);
+	EXPECT_EQ(fetches->count(), 0);
+
+	QTest::qWait(SETTLE_MS);
+	ASSERT_EQ(fetches->count(), 1);
+	EXPECT_EQ(fetches->front().front().value<QGeoPolygon>(), area);
+}
+
+TEST_F(PastViewModelControllerTest, ZoomingInsideLoadedAreaOnlyReclusters)
+{
+	Load(Area(CENTER, 0.01));
+
+	controller->setProperty("zoomLevel", ZOOM_LEVEL + 2);
+	const auto area = Area(CENTER, 0.0025);
+	controller->SetViewportArea(area);
+	QTest::qWait(SETTLE_MS);
+
+	EXPECT_GE(rebuilds->count(), 1);
+	// The area still reaches the base model for reloads, its tiles are not requested again
+	ASSERT_EQ(fetches->count(), 1);
+	EXPECT_EQ(fetches->front().front().value<QGeoPolygon>(), area);
+	EXPECT_EQ(loadings->count(), 0);
+}
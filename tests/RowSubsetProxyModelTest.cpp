@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <QAbstractItemModelTester>
+#include <QAbstractListModel>
+
+#include <gtest/gtest.h>
+
+#include "App/Models/RowSubsetProxyModel.h"
+
+namespace {
+
+class ValuesModel : public QAbstractListModel
+{
+public:
+	explicit ValuesModel(std::vector<int> values)
+		: m_values(std::move(values))
+	{
+	}
+
+	int rowCount(const QModelIndex & parent = QModelIndex()) const override
+	{
+		return parent.isValid() ? 0 : static_cast<int>(m_values.size());
+	}
+
+	QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override
+	{
+		if (!index.isValid() || role != Qt::DisplayRole)
+			return {};
+		return m_values[index.row()];
+	}
+
+	int Value(int row) const
+	{
+		return m_values[row];
+	}
+
+	void Insert(int row, const std::vector<int> & values)
+	{
+		beginInsertRows({}, row, row + static_cast<int>(values.size()) - 1);
+		m_values.insert(m_values.begin() + row, values.begin(), values.end());
+		endInsertRows();
+	}
+
+	void Remove(int first, int last)
+	{
+		beginRemoveRows({}, first, last);
+		m_values.erase(m_values.begin() + first, m_values.begin() + last + 1);
+		endRemoveRows();
+	}
+
+private:
+	std::vector<int> m_values;
+};
+
+// Source rows whose value is accepted, ordered by value
+class ValueSubsetModel : public RowSubsetProxyModel
+{
+public:
+	explicit ValueSubsetModel(ValuesModel * source)
+	{
+		setSourceModel(source);
+		ResetSourceRows();
+	}
+
+	bool Accepts(int sourceRow) const
+	{
+		return m_accepts(Source().Value(sourceRow));
+	}
+
+	// Announces only the rows entering or leaving the subset
+	void SetAccepts(std::function<bool(int value)> accepts)
+	{
+		m_accepts = std::move(accepts);
+
+		std::vector<int> leaving;
+		std::vector<int> entering;
+		for (int row = 0; row < Source().rowCount(); ++row)
+		{
+			if (ContainsSourceRow(row) && !Accepts(row))
+				leaving.push_back(row);
+			else if (!ContainsSourceRow(row) && Accepts(row))
+				entering.push_back(row);
+		}
+		std::ranges::sort(entering, [this](int left, int right) { return SourceRowLessThan(left, right); });
+
+		RemoveSourceRows(leaving);
+		InsertSourceRows(entering);
+	}
+
+	void SetDescending(bool descending)
+	{
+		m_descending = descending;
+		ReorderSourceRows();
+	}
+
+protected:
+	std::vector<int> SelectSourceRows() override
+	{
+		return SelectInsertedSourceRows(0, Source().rowCount() - 1);
+	}
+
+	std::vector<int> SelectInsertedSourceRows(int first, int last) override
+	{
+		std::vector<int> rows;
+		for (auto row = first; row <= last; ++row)
+		{
+			if (Accepts(row))
+				rows.push_back(row);
+		}
+		std::ranges::sort(rows, [this](int left, int right) { return SourceRowLessThan(left, right); });
+		return rows;
+	}
+
+	bool SourceRowLessThan(int left, int right) const override
+	{
+		const auto leftValue = Source().Value(left);
+		const auto rightValue = Source().Value(right);
+		return m_descending ? std::tie(rightValue, left) < std::tie(leftValue, right) : std::tie(leftValue, left) < std::tie(rightValue, right);
+	}
+
+private:
+	const ValuesModel & Source() const
+	{
+		return static_cast<const ValuesModel &>(*sourceModel());
+	}
+
+	std::function<bool(int value)> m_accepts = [](int value) { return value % 2 == 0; };
+	bool m_descending { false };
+};
+
+std::vector<int> ProxyValues(const ValueSubsetModel & proxy)
+{
+	std::vector<int> values;
+	for (int row = 0; row < proxy.rowCount(); ++row)
+		values.push_back(proxy.data(proxy.index(row, 0)).toInt());
+	return values;
+}
+
+void ExpectRoundTrip(const ValueSubsetModel & proxy)
+{
+	for (int row = 0; row < proxy.rowCount(); ++row)
+	{
+		const auto sourceIndex = proxy.mapToSource(proxy.index(row, 0));
+		ASSERT_TRUE(sourceIndex.isValid());
+		EXPECT_EQ(proxy.mapFromSource(sourceIndex).row(), row);
+	}
+}
+
+// Both directions agree and every accepted source row, only those, is in the subset
+void ExpectConsistentMapping(const ValueSubsetModel & proxy, const ValuesModel & source)
+{
+	ExpectRoundTrip(proxy);
+	for (int row = 0; row < source.rowCount(); ++row)
+		EXPECT_EQ(proxy.mapFromSource(source.index(row, 0)).isValid(), proxy.Accepts(row)) << "source row " << row;
+}
+
+}
+
+class RowSubsetProxyModelTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		// Every signal is checked against the model's state by Qt's tester and, in between the runs of a batch, by the mapping
+		tester = std::make_unique<QAbstractItemModelTester>(&proxy, QAbstractItemModelTester::FailureReportingMode::Fatal);
+		QObject::connect(&proxy, &QAbstractItemModel::rowsInserted, [this] {
+			++insertedRuns;
+			ExpectRoundTrip(proxy);
+		});
+		QObject::connect(&proxy, &QAbstractItemModel::rowsRemoved, [this] {
+			++removedRuns;
+			ExpectRoundTrip(proxy);
+		});
+		QObject::connect(&proxy, &QAbstractItemModel::rowsMoved, [this] {
+			++moves;
+			ExpectRoundTrip(proxy);
+		});
+		QObject::connect(&proxy, &QAbstractItemModel::modelReset, [this] { ++resets; });
+	}
+
+	ValuesModel source { { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 } };
+	ValueSubsetModel proxy { &source };
+	std::unique_ptr<QAbstractItemModelTester> tester;
+	int insertedRuns { 0 };
+	int removedRuns { 0 };
+	int moves { 0 };
+	int resets { 0 };
+};
+
+TEST_F(RowSubsetProxyModelTest, SelectsAndOrdersSubset)
+{
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 0, 2, 4, 6, 8 }));
+	ExpectConsistentMapping(proxy, source);
+}
+
+TEST_F(RowSubsetProxyModelTest, SubsetChangeAnnouncesOnlyRunsThatChanged)
+{
+	// Leaving 2, 4 and 8, entering 3 and 9
+	proxy.SetAccepts([](int value) { return value % 3 == 0; });
+
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 0, 3, 6, 9 }));
+	EXPECT_EQ(removedRuns, 2);
+	EXPECT_EQ(insertedRuns, 2);
+	EXPECT_EQ(resets, 0);
+	ExpectConsistentMapping(proxy, source);
+}
+
+TEST_F(RowSubsetProxyModelTest, SourceInsertsAndRemovesKeepMapping)
+{
+	source.Insert(3, { 10, 11, 12 });
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 0, 2, 4, 6, 8, 10, 12 }));
+	ExpectConsistentMapping(proxy, source);
+
+	// Rows 1 to 5 hold 1, 2, 10, 11 and 12
+	source.Remove(1, 5);
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 0, 4, 6, 8 }));
+	ExpectConsistentMapping(proxy, source);
+
+	source.Insert(0, { 1, 3 });
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 0, 4, 6, 8 }));
+	EXPECT_EQ(resets, 0);
+	ExpectConsistentMapping(proxy, source);
+}
+
+TEST_F(RowSubsetProxyModelTest, ReorderMovesRowsAndKeepsMapping)
+{
+	proxy.SetDescending(true);
+
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 8, 6, 4, 2, 0 }));
+	EXPECT_EQ(moves, 4);
+	EXPECT_EQ(resets, 0);
+	ExpectConsistentMapping(proxy, source);
+
+	// Entering rows are placed in the current order
+	proxy.SetAccepts([](int value) { return value % 2 == 1 || value == 4; });
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 9, 7, 5, 4, 3, 1 }));
+	ExpectConsistentMapping(proxy, source);
+}
+
+TEST_F(RowSubsetProxyModelTest, SuspendedProxyIsEmptyUntilResumed)
+{
+	proxy.SetSuspended(true);
+	EXPECT_EQ(proxy.rowCount(), 0);
+
+	// Not followed while suspended
+	source.Remove(0, 1);
+	proxy.SetSuspended(false);
+	EXPECT_EQ(ProxyValues(proxy), (std::vector<int> { 2, 4, 6, 8 }));
+	ExpectConsistentMapping(proxy, source);
+}
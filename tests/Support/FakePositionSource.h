@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include <QGeoPositionInfo>
+#include <QGeoPositionInfoSource>
+
+// Position source driven by the caller instead of a GPS
+class FakePositionSource
+	: public QGeoPositionInfoSource
+{
+public:
+	explicit FakePositionSource(QObject * parent = nullptr)
+		: QGeoPositionInfoSource(parent)
+	{
+	}
+
+	void MoveTo(const QGeoCoordinate & coordinate)
+	{
+		m_position = QGeoPositionInfo(coordinate, QDateTime::currentDateTime());
+		emit positionUpdated(m_position);
+	}
+
+	QGeoPositionInfo lastKnownPosition(bool = false) const override
+	{
+		return m_position;
+	}
+
+	PositioningMethods supportedPositioningMethods() const override
+	{
+		return AllPositioningMethods;
+	}
+
+	int minimumUpdateInterval() const override
+	{
+		return 0;
+	}
+
+	Error error() const override
+	{
+		return NoError;
+	}
+
+	void startUpdates() override
+	{
+	}
+
+	void stopUpdates() override
+	{
+	}
+
+	void requestUpdate(int = 0) override
+	{
+	}
+
+private:
+	QGeoPositionInfo m_position;
+};
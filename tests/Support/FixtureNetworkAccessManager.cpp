@@ -0,0 +1,137 @@
+#include "FixtureNetworkAccessManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrlQuery>
+
+#include "glog/logging.h"
+
+namespace {
+
+constexpr auto EMPTY_RESPONSE = R"({"result":{"photos":[]}})";
+
+class FixtureReply
+	: public QNetworkReply
+{
+public:
+	FixtureReply(QNetworkAccessManager::Operation op, const QNetworkRequest & request, QByteArray body, std::chrono::milliseconds delay, QObject * parent)
+		: QNetworkReply(parent)
+		, m_body(std::move(body))
+	{
+		setRequest(request);
+		setUrl(request.url());
+		setOperation(op);
+		open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+		m_timer.setSingleShot(true);
+		connect(&m_timer, &QTimer::timeout, this, &FixtureReply::Deliver);
+		m_timer.start(delay);
+	}
+
+	void abort() override
+	{
+		if (isFinished())
+			return;
+
+		m_timer.stop();
+		setError(OperationCanceledError, "Operation canceled");
+		setFinished(true);
+		emit errorOccurred(OperationCanceledError);
+		emit finished();
+	}
+
+	bool isSequential() const override
+	{
+		return true;
+	}
+
+	qint64 bytesAvailable() const override
+	{
+		return (m_delivered ? m_body.size() - m_offset : 0) + QNetworkReply::bytesAvailable();
+	}
+
+protected:
+	qint64 readData(char * data, qint64 maxSize) override
+	{
+		if (!m_delivered)
+			return 0;
+
+		const auto count = std::min(maxSize, m_body.size() - m_offset);
+		if (count <= 0)
+			return -1;
+
+		std::memcpy(data, m_body.constData() + m_offset, count);
+		m_offset += count;
+		return count;
+	}
+
+private:
+	void Deliver()
+	{
+		m_delivered = true;
+		setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+		setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+		setHeader(QNetworkRequest::ContentLengthHeader, m_body.size());
+		setFinished(true);
+		emit metaDataChanged();
+		emit downloadProgress(m_body.size(), m_body.size());
+		emit readyRead();
+		emit finished();
+	}
+
+	QByteArray m_body;
+	qint64 m_offset { 0 };
+	bool m_delivered { false };
+	QTimer m_timer;
+};
+
+}
+
+FixtureNetworkAccessManager::FixtureNetworkAccessManager(Responder responder, QObject * parent)
+	: QNetworkAccessManager(parent)
+	, m_responder(std::move(responder))
+{
+}
+
+void FixtureNetworkAccessManager::SetLatency(std::chrono::milliseconds latency)
+{
+	m_latency = latency;
+}
+
+void FixtureNetworkAccessManager::SetBandwidth(qint64 bytesPerSecond)
+{
+	m_bytesPerSecond = bytesPerSecond;
+}
+
+FixtureNetworkAccessManager::Responder FixtureNetworkAccessManager::FromDirectory(const QString & dir)
+{
+	return [dir](const QUrl & url) -> QByteArray {
+		QFile file(QDir(dir).filePath(FixtureName(url)));
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			LOG(WARNING) << "No fixture " << file.fileName().toStdString();
+			return EMPTY_RESPONSE;
+		}
+		return file.readAll();
+	};
+}
+
+QString FixtureNetworkAccessManager::FixtureName(const QUrl & url)
+{
+	const QUrlQuery query(url);
+	const auto params = QCryptographicHash::hash(query.queryItemValue("params", QUrl::FullyDecoded).toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+	return QString("%1-%2.json").arg(query.queryItemValue("method"), QString::fromLatin1(params));
+}
+
+QNetworkReply * FixtureNetworkAccessManager::createRequest(Operation op, const QNetworkRequest & request, QIODevice *)
+{
+	auto body = m_responder(request.url());
+	const auto transfer = std::chrono::milliseconds(m_bytesPerSecond > 0 ? body.size() * 1000 / m_bytesPerSecond : 0);
+	return new FixtureReply(op, request, std::move(body), m_latency + transfer, this);
+}
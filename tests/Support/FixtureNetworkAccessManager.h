@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+#include <QByteArray>
+#include <QNetworkAccessManager>
+#include <QString>
+#include <QUrl>
+
+// Stand-in for the PastVu API: every request is answered locally by the responder,
+// after a simulated latency plus the transfer time of the body at the given bandwidth.
+// Nothing touches the network, so runs are reproducible offline.
+class FixtureNetworkAccessManager
+	: public QNetworkAccessManager
+{
+	Q_OBJECT
+
+public:
+	using Responder = std::function<QByteArray(const QUrl & url)>;
+
+	explicit FixtureNetworkAccessManager(Responder responder, QObject * parent = nullptr);
+
+	void SetLatency(std::chrono::milliseconds latency);
+	// Bytes per second, 0 delivers instantly
+	void SetBandwidth(qint64 bytesPerSecond);
+
+	// Serves <dir>/<FixtureName(url)>, an empty photo list when the file is missing
+	static Responder FromDirectory(const QString & dir);
+	// Stable file name of a request, so a recorded live response can be saved under it
+	static QString FixtureName(const QUrl & url);
+
+protected:
+	QNetworkReply * createRequest(Operation op, const QNetworkRequest & request, QIODevice * outgoingData = nullptr) override;
+
+private:
+	Responder m_responder;
+	std::chrono::milliseconds m_latency { 0 };
+	qint64 m_bytesPerSecond { 0 };
+};
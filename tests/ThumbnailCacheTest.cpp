@@ -0,0 +1,134 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+
+#include "App/Models/ThumbnailCache.h"
+#include "Support/FixtureNetworkAccessManager.h"
+
+namespace {
+
+const QUrl THUMBNAIL_URL("http://localhost/_p/h/a/b/1.jpg");
+
+QByteArray PngBytes()
+{
+	QImage image(4, 3, QImage::Format_RGB32);
+	image.fill(Qt::darkRed);
+	QByteArray bytes;
+	QBuffer buffer(&bytes);
+	buffer.open(QIODevice::WriteOnly);
+	image.save(&buffer, "PNG");
+	return bytes;
+}
+
+}
+
+class ThumbnailCacheTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		if (!QCoreApplication::instance())
+		{
+			static int argc = 1;
+			static char * argv[] = { const_cast<char *>("test") };
+			app = std::make_unique<QCoreApplication>(argc, argv);
+		}
+	}
+
+	void TearDown() override
+	{
+		app.reset();
+	}
+
+	std::unique_ptr<ThumbnailCache> MakeCache(QByteArray response = PngBytes())
+	{
+		auto networkManager = std::make_unique<FixtureNetworkAccessManager>([this, response](const QUrl &) {
+			++requestCount;
+			return response;
+		});
+		networkManager->SetLatency(std::chrono::milliseconds(5));
+		return std::make_unique<ThumbnailCache>(dir.path(), std::move(networkManager));
+	}
+
+	// Requests the thumbnail count times at once and spins the event loop until every callback ran
+	std::vector<QImage> Request(ThumbnailCache & cache, int count = 1)
+	{
+		std::mutex mutex;
+		std::vector<QImage> images;
+		for (auto i = 0; i < count; ++i)
+		{
+			cache.Request(THUMBNAIL_URL, [&](const QImage & image) {
+				const std::lock_guard lock(mutex);
+				images.push_back(image);
+			});
+		}
+
+		const QDeadlineTimer deadline(1000);
+		while (!deadline.hasExpired())
+		{
+			QCoreApplication::processEvents();
+			const std::lock_guard lock(mutex);
+			if (images.size() == static_cast<size_t>(count))
+				break;
+			QThread::msleep(1);
+		}
+		const std::lock_guard lock(mutex);
+		return images;
+	}
+
+	std::unique_ptr<QCoreApplication> app;
+	QTemporaryDir dir;
+	std::atomic<int> requestCount { 0 };
+};
+
+TEST_F(ThumbnailCacheTest, ConcurrentRequestsShareOneDownload)
+{
+	auto cache = MakeCache();
+	const auto images = Request(*cache, 3);
+
+	ASSERT_EQ(images.size(), 3);
+	for (const auto & image : images)
+		EXPECT_EQ(image.size(), QSize(4, 3));
+	EXPECT_EQ(requestCount, 1);
+	EXPECT_GT(cache->MemoryBytes(), 0);
+
+	// Served from memory
+	ASSERT_EQ(Request(*cache).size(), 1);
+	EXPECT_EQ(requestCount, 1);
+}
+
+TEST_F(ThumbnailCacheTest, DownloadedThumbnailSurvivesReopening)
+{
+	ASSERT_EQ(Request(*MakeCache()).size(), 1);
+	ASSERT_EQ(requestCount, 1);
+
+	auto cache = MakeCache();
+	EXPECT_GT(cache->DiskBytes(), 0);
+	const auto images = Request(*cache);
+	ASSERT_EQ(images.size(), 1);
+	EXPECT_FALSE(images.front().isNull());
+	EXPECT_EQ(requestCount, 1);
+}
+
+TEST_F(ThumbnailCacheTest, ResponseThatIsNoImageIsNotKept)
+{
+	auto cache = MakeCache("<html>Not found</html>");
+	const auto images = Request(*cache);
+
+	ASSERT_EQ(images.size(), 1);
+	EXPECT_TRUE(images.front().isNull());
+	EXPECT_EQ(cache->DiskBytes(), 0);
+	EXPECT_EQ(cache->MemoryBytes(), 0);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "App/Models/TileGrid.h"
+
+class TileGridTest : public ::testing::Test
+{
+};
+
+TEST_F(TileGridTest, TileAtKnownValues)
+{
+	EXPECT_EQ(TileGrid::TileAt(0.0, 0.0, 0), (TileGrid::Tile { 0, 0, 0 }));
+	EXPECT_EQ(TileGrid::TileAt(0.1, 0.1, 1), (TileGrid::Tile { 1, 1, 0 }));
+	EXPECT_EQ(TileGrid::TileAt(-0.1, -0.1, 1), (TileGrid::Tile { 1, 0, 1 }));
+
+	// Moscow, Red Square
+	EXPECT_EQ(TileGrid::TileAt(55.7539, 37.6208, 13), (TileGrid::Tile { 13, 4952, 2560 }));
+}
+
+TEST_F(TileGridTest, NearbyPointsSnapToTheSameTile)
+{
+	const auto tile = TileGrid::TileAt(55.7539, 37.6208, 13);
+	const auto bounds = TileGrid::TileBounds(tile);
+	EXPECT_EQ(TileGrid::TileAt(bounds.north - 1e-6, bounds.west + 1e-6, 13), tile);
+	EXPECT_EQ(TileGrid::TileAt(bounds.south + 1e-6, bounds.east - 1e-6, 13), tile);
+	EXPECT_EQ(TileGrid::TileAt((bounds.north + bounds.south) / 2, (bounds.west + bounds.east) / 2, 13), tile);
+}
+
+TEST_F(TileGridTest, NeighbourTilesShareEdges)
+{
+	const TileGrid::Tile tile { 13, 4952, 2560 };
+	const auto bounds = TileGrid::TileBounds(tile);
+	const auto east = TileGrid::TileBounds({ 13, 4953, 2560 });
+	const auto south = TileGrid::TileBounds({ 13, 4952, 2561 });
+	EXPECT_DOUBLE_EQ(bounds.east, east.west);
+	EXPECT_DOUBLE_EQ(bounds.south, south.north);
+}
+
+TEST_F(TileGridTest, TilesCoveringBox)
+{
+	const auto tiles = TileGrid::TilesCovering(55.76, 37.60, 55.74, 37.64, 13);
+	const std::set<TileGrid::Tile> unique(tiles.cbegin(), tiles.cend());
+	EXPECT_EQ(unique.size(), tiles.size());
+	for (const auto & corner : { TileGrid::TileAt(55.76, 37.60, 13), TileGrid::TileAt(55.74, 37.64, 13), TileGrid::TileAt(55.75, 37.62, 13) })
+		EXPECT_TRUE(unique.contains(corner));
+}
+
+TEST_F(TileGridTest, TilesCoveringAcrossAntimeridian)
+{
+	const auto tiles = TileGrid::TilesCovering(-16.4, 179.9, -16.6, -179.9, 10);
+	ASSERT_EQ(tiles.size(), 2);
+	EXPECT_EQ(tiles[0].x, 1023);
+	EXPECT_EQ(tiles[1].x, 0);
+	EXPECT_EQ(tiles[0].y, tiles[1].y);
+}
+
+TEST_F(TileGridTest, CountCoveringMatchesTilesCovering)
+{
+	EXPECT_EQ(TileGrid::CountCovering(55.76, 37.60, 55.74, 37.64, 13), static_cast<long long>(TileGrid::TilesCovering(55.76, 37.60, 55.74, 37.64, 13).size()));
+	EXPECT_EQ(TileGrid::CountCovering(-16.4, 179.9, -16.6, -179.9, 10), 2);
+	// Far more than could be listed
+	EXPECT_GT(TileGrid::CountCovering(85.0, -180.0, -85.0, 179.999, 20), 1LL << 32);
+}
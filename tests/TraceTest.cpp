@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "App/Utils/Trace.h"
+
+namespace {
+
+size_t Count(const std::string & text, const std::string & pattern)
+{
+	size_t count = 0;
+	for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + pattern.size()))
+		++count;
+	return count;
+}
+
+}
+
+class TraceTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		Trace::Clear();
+	}
+
+	void TearDown() override
+	{
+		Trace::SetEnabled(false);
+		Trace::Clear();
+	}
+};
+
+TEST_F(TraceTest, DisabledRecordsNothing)
+{
+	{
+		TRACE_SCOPE("Disabled");
+	}
+	Trace::Instant("Disabled");
+
+	EXPECT_EQ(Trace::ExportChromeJson(), R"({"displayTimeUnit":"ms","traceEvents":[]})");
+}
+
+TEST_F(TraceTest, ExportsSpansInstantsAndAsyncSpans)
+{
+	Trace::SetEnabled(true);
+	{
+		TRACE_SCOPE("Span");
+	}
+	Trace::Instant("Frame");
+	Trace::AsyncBegin("Request", 42);
+	Trace::AsyncEnd("Request", 42);
+	Trace::Counter("Stage", "allocations", 3);
+
+	const auto json = Trace::ExportChromeJson();
+	EXPECT_NE(json.find(R"("name":"Span","ph":"X")"), std::string::npos);
+	EXPECT_NE(json.find(R"("name":"Frame","ph":"i")"), std::string::npos);
+	EXPECT_EQ(Count(json, R"("id":"0x2a")"), 2);
+	EXPECT_LT(json.find(R"("ph":"b")"), json.find(R"("ph":"e")"));
+	EXPECT_NE(json.find(R"("name":"Stage","ph":"C")"), std::string::npos);
+	EXPECT_NE(json.find(R"("args":{"allocations":3})"), std::string::npos);
+}
+
+TEST_F(TraceTest, RingBufferKeepsNewestEvents)
+{
+	Trace::SetEnabled(true);
+	Trace::Instant("Oldest");
+	for (int i = 0; i < Trace::CAPACITY; ++i)
+		Trace::Instant("Newer");
+
+	const auto json = Trace::ExportChromeJson();
+	EXPECT_EQ(Count(json, R"("name":"Oldest")"), 0);
+	EXPECT_EQ(Count(json, R"("name":"Newer")"), static_cast<size_t>(Trace::CAPACITY));
+}
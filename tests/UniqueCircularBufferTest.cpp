@@ -185,6 +185,42 @@ TEST_F(UniqueCircularBufferTest, CapacityLimit)
 	EXPECT_EQ(buffer.Size(), 3);
 }
 
+// Test that eviction through the lvalue overload keeps keys in sync with the content
+TEST_F(UniqueCircularBufferTest, LvalueEvictionUpdatesKeys)
+{
+	auto getKey = [](int value) { return value; };
+	UniqueCircularBuffer<int, int, 3, decltype(getKey)> buffer(getKey);
+
+	const std::vector<int> items { 1, 2, 3, 4 };
+	for (const auto & item : items)
+		buffer.Push(item);
+
+	EXPECT_EQ(buffer.Size(), 3);
+	EXPECT_EQ(buffer.At(0), 2);
+	EXPECT_EQ(buffer.At(2), 4);
+	EXPECT_FALSE(buffer.Contains(1));
+	EXPECT_TRUE(buffer.Contains(4));
+
+	// The evicted key can be pushed again
+	const auto evicted = 1;
+	buffer.Push(evicted);
+	EXPECT_TRUE(buffer.Contains(1));
+	EXPECT_FALSE(buffer.Contains(2));
+}
+
+// Test Contains
+TEST_F(UniqueCircularBufferTest, Contains)
+{
+	auto getKey = [](int value) { return value; };
+	UniqueCircularBuffer<int, int, 5, decltype(getKey)> buffer(getKey);
+
+	EXPECT_FALSE(buffer.Contains(1));
+	buffer.Push(1);
+	EXPECT_TRUE(buffer.Contains(1));
+	buffer.Clear();
+	EXPECT_FALSE(buffer.Contains(1));
+}
+
 // Test with different types
 TEST_F(UniqueCircularBufferTest, DifferentTypes)
 {
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "App/Models/YearHistogram.h"
+
+class YearHistogramTest : public ::testing::Test
+{
+protected:
+	YearHistogram histogram;
+};
+
+TEST_F(YearHistogramTest, EmptyHistogram)
+{
+	EXPECT_EQ(histogram.CountAt(1900), 0);
+	EXPECT_EQ(histogram.Buckets(1800, 1829, 10), (std::vector<int> { 0, 0, 0 }));
+}
+
+TEST_F(YearHistogramTest, AddAndRemove)
+{
+	histogram.Add(1900);
+	histogram.Add(1900);
+	histogram.Add(1905);
+	EXPECT_EQ(histogram.CountAt(1900), 2);
+
+	histogram.Remove(1900);
+	EXPECT_EQ(histogram.CountAt(1900), 1);
+	EXPECT_EQ(histogram.CountAt(1905), 1);
+}
+
+TEST_F(YearHistogramTest, DecadeBuckets)
+{
+	histogram.Add(1800);
+	histogram.Add(1809);
+	histogram.Add(1810);
+	histogram.Add(1825);
+	histogram.Add(1825);
+
+	EXPECT_EQ(histogram.Buckets(1800, 1825, 10), (std::vector<int> { 2, 1, 2 }));
+}
+
+TEST_F(YearHistogramTest, YearsOutsideRangeAreSkipped)
+{
+	histogram.Add(0);
+	histogram.Add(1750);
+	histogram.Add(1850);
+	histogram.Add(2100);
+
+	EXPECT_EQ(histogram.Buckets(1800, 1899, 50), (std::vector<int> { 0, 1 }));
+}
+
+TEST_F(YearHistogramTest, InvalidBuckets)
+{
+	histogram.Add(1900);
+	EXPECT_TRUE(histogram.Buckets(1900, 1800, 10).empty());
+	EXPECT_TRUE(histogram.Buckets(1800, 1900, 0).empty());
+}
+
+TEST_F(YearHistogramTest, Clear)
+{
+	histogram.Add(1900);
+	histogram.Clear();
+	EXPECT_EQ(histogram.CountAt(1900), 0);
+}
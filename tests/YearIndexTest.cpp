@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "App/Models/YearIndex.h"
+
+namespace {
+
+std::vector<int> RowsOf(std::span<const YearIndex::Entry> slice)
+{
+	std::vector<int> rows;
+	for (const auto & entry : slice)
+		rows.push_back(entry.row);
+	std::ranges::sort(rows);
+	return rows;
+}
+
+}
+
+class YearIndexTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		index.Rebuild({
+			{ 1900, 0 },
+			{ 1850, 1 },
+			{ 1950, 2 },
+			{ 1900, 3 },
+			{ 2000, 4 },
+		});
+	}
+
+	YearIndex index;
+};
+
+TEST_F(YearIndexTest, EmptyIndex)
+{
+	YearIndex empty;
+	EXPECT_EQ(empty.Size(), 0);
+	EXPECT_TRUE(empty.InRange(1800, 2025).empty());
+}
+
+TEST_F(YearIndexTest, FullRange)
+{
+	EXPECT_EQ(RowsOf(index.InRange(1800, 2025)), (std::vector<int> { 0, 1, 2, 3, 4 }));
+}
+
+TEST_F(YearIndexTest, LowerBoundIsExclusive)
+{
+	EXPECT_EQ(RowsOf(index.InRange(1900, 2000)), (std::vector<int> { 2, 4 }));
+}
+
+TEST_F(YearIndexTest, UpperBoundIsInclusive)
+{
+	EXPECT_EQ(RowsOf(index.InRange(1849, 1900)), (std::vector<int> { 0, 1, 3 }));
+}
+
+TEST_F(YearIndexTest, InvertedRangeIsEmpty)
+{
+	EXPECT_TRUE(index.InRange(2000, 1900).empty());
+	EXPECT_TRUE(index.InRange(1900, 1900).empty());
+}
+
+TEST_F(YearIndexTest, RangeDifference)
+{
+	// (1850, 2000] minus (1900, 1950]
+	EXPECT_EQ(index.RowsInRangeExcept(1850, 2000, 1900, 1950), (std::vector<int> { 0, 3, 4 }));
+	// Shrinking the range from below: rows leaving (1800, 2000] for (1900, 2000]
+	EXPECT_EQ(index.RowsInRangeExcept(1800, 2000, 1900, 2000), (std::vector<int> { 0, 1, 3 }));
+	// Disjoint ranges
+	EXPECT_EQ(index.RowsInRangeExcept(1949, 2000, 1800, 1900), (std::vector<int> { 2, 4 }));
+	// Nothing leaves when the range grows
+	EXPECT_TRUE(index.RowsInRangeExcept(1900, 1950, 1800, 2025).empty());
+	// Empty exception keeps the whole range
+	EXPECT_EQ(index.RowsInRangeExcept(1800, 1900, 1900, 1900), (std::vector<int> { 0, 1, 3 }));
+}
+
+TEST_F(YearIndexTest, RowMask)
+{
+	std::vector<bool> mask { true };
+	index.FillRowMask(1850, 1950, mask);
+	EXPECT_EQ(mask, (std::vector<bool> { true, false, true, true, false }));
+}
+
+TEST_F(YearIndexTest, ClearDropsEntries)
+{
+	index.Clear();
+	EXPECT_EQ(index.Size(), 0);
+
+	std::vector<bool> mask { true, true };
+	index.FillRowMask(1800, 2025, mask);
+	EXPECT_TRUE(mask.empty());
+}